@@ -69,6 +69,44 @@ namespace hpp {
             jacobian.middleCols (_int->first, _int->second).setZero ();
         }
 
+        virtual void impl_compute (LiegroupElement& result,
+                                   vectorIn_t argument,
+                                   EvaluationContext& context) const
+        {
+          function_->value(result, argument, context);
+        }
+
+        virtual void impl_jacobian (matrixOut_t jacobian,
+                                    vectorIn_t arg,
+                                    EvaluationContext& context) const
+        {
+          function_->jacobian(jacobian, arg, context);
+          for (segments_t::const_iterator _int = intervals_.begin ();
+              _int != intervals_.end (); ++_int)
+            jacobian.middleCols (_int->first, _int->second).setZero ();
+        }
+
+        virtual void impl_valueAndJacobian (LiegroupElement& result,
+                                            matrixOut_t jacobian,
+                                            vectorIn_t arg) const
+        {
+          function_->valueAndJacobian(result, jacobian, arg);
+          for (segments_t::const_iterator _int = intervals_.begin ();
+              _int != intervals_.end (); ++_int)
+            jacobian.middleCols (_int->first, _int->second).setZero ();
+        }
+
+        virtual void impl_valueAndJacobian (LiegroupElement& result,
+                                            matrixOut_t jacobian,
+                                            vectorIn_t arg,
+                                            EvaluationContext& context) const
+        {
+          function_->valueAndJacobian(result, jacobian, arg, context);
+          for (segments_t::const_iterator _int = intervals_.begin ();
+              _int != intervals_.end (); ++_int)
+            jacobian.middleCols (_int->first, _int->second).setZero ();
+        }
+
         DifferentiableFunctionPtr_t function_;
         segments_t intervals_;
     }; // class ActiveSetDifferentiableFunction
@@ -56,7 +56,8 @@ namespace hpp {
         /// User implementation of function evaluation
         void impl_compute (LiegroupElement& y, vectorIn_t x) const
         {
-          y.vector ().noalias() = J_ * x + b_;
+          y.vector () = b_;
+          y.vector ().noalias() += J_ * x;
         }
 
         void impl_jacobian (matrixOut_t jacobian, vectorIn_t) const
@@ -64,15 +65,43 @@ namespace hpp {
           jacobian = J_;
         }
 
+        /// The function does not depend on any shared state.
+        void impl_compute (LiegroupElement& y, vectorIn_t x,
+                           EvaluationContext&) const
+        {
+          impl_compute (y, x);
+        }
+
+        void impl_jacobian (matrixOut_t jacobian, vectorIn_t x,
+                            EvaluationContext&) const
+        {
+          impl_jacobian (jacobian, x);
+        }
+
+        void impl_jacobianCompressed (matrixOut_t jacobian, vectorIn_t) const
+        {
+          jacobian = Jc_;
+        }
+
+        void impl_jacobianCompressed (matrixOut_t jacobian, vectorIn_t,
+                                      EvaluationContext&) const
+        {
+          jacobian = Jc_;
+        }
+
         void init ()
         {
           assert(J_.rows() == b_.rows());
           activeParameters_ = (J_.array() != 0).colwise().any();
           activeDerivativeParameters_ = activeParameters_;
+          Jc_.resize (J_.rows(), activeDerivativeSize());
+          compressJacobian (J_, Jc_);
         }
 
         const matrix_t J_;
         const vector_t b_;
+        /// Active columns of J_
+        matrix_t Jc_;
     }; // class AffineFunction
 
     /// Constant function
@@ -103,6 +132,12 @@ namespace hpp {
 
         void impl_jacobian (matrixOut_t J, vectorIn_t) const { J.setZero(); }
 
+        void impl_compute (LiegroupElement& r, vectorIn_t,
+                           EvaluationContext&) const { r = c_; }
+
+        void impl_jacobian (matrixOut_t J, vectorIn_t,
+                            EvaluationContext&) const { J.setZero(); }
+
         const LiegroupElement c_;
     }; // class ConstantFunction
 
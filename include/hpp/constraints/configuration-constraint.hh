@@ -57,12 +57,21 @@ namespace hpp {
 
         virtual void impl_jacobian (matrixOut_t jacobian,
             ConfigurationIn_t arg) const throw ();
+
+        virtual void impl_compute (LiegroupElement& result,
+                                   ConfigurationIn_t argument,
+                                   EvaluationContext& context) const;
+
+        virtual void impl_jacobian (matrixOut_t jacobian,
+            ConfigurationIn_t arg, EvaluationContext& context) const;
       private:
         typedef Eigen::Array <bool, Eigen::Dynamic, 1> EigenBoolVector_t;
         DevicePtr_t robot_;
         Configuration_t goal_;
         EigenBoolVector_t mask_;
         mutable vector_t diff_;
+        /// Identifier of diff_ in an EvaluationContext.
+        std::size_t diffScratch_;
     }; // class ComBetweenFeet
   } // namespace constraints
 } // namespace hpp
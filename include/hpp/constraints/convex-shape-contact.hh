@@ -151,7 +151,34 @@ namespace hpp {
           const;
 
         void impl_jacobian (matrixOut_t jacobian, ConfigurationIn_t argument) const;
+        /// Compute the value and the jacobian with a single selection of
+        /// the convex shapes.
+        void impl_valueAndJacobian (LiegroupElement& result,
+            matrixOut_t jacobian, ConfigurationIn_t argument) const;
+        /// Keep the evaluations in a context and of the active columns fused.
+        void impl_valueAndJacobian (LiegroupElement& result,
+            matrixOut_t jacobian, ConfigurationIn_t argument,
+            EvaluationContext& context) const
+        {
+          legacyValueAndJacobian (result, jacobian, argument, &context);
+        }
+        void impl_valueAndJacobianCompressed (LiegroupElement& result,
+            matrixOut_t jacobian, ConfigurationIn_t argument) const
+        {
+          legacyValueAndJacobian (result, jacobian, argument, NULL);
+        }
+        void impl_valueAndJacobianCompressed (LiegroupElement& result,
+            matrixOut_t jacobian, ConfigurationIn_t argument,
+            EvaluationContext& context) const
+        {
+          legacyValueAndJacobian (result, jacobian, argument, &context);
+        }
+        void computeInternalValue (ConfigurationIn_t argument) const;
         void computeInternalJacobian (ConfigurationIn_t argument) const;
+        void computeInternalValueAndJacobian (ConfigurationIn_t argument) const;
+        /// Copy the relevant rows of the relative transformation.
+        void copyInternalValue (LiegroupElement& result) const;
+        void copyInternalJacobian (matrixOut_t jacobian) const;
 
         void selectConvexShapes () const;
         ContactType contactType (const ConvexShape& object,
@@ -216,6 +243,32 @@ namespace hpp {
       void impl_jacobian (matrixOut_t jacobian, ConfigurationIn_t argument)
 	const;
 
+      void impl_valueAndJacobian (LiegroupElement& result,
+          matrixOut_t jacobian, ConfigurationIn_t argument) const;
+      /// Keep the evaluations in a context and of the active columns fused.
+      void impl_valueAndJacobian (LiegroupElement& result,
+          matrixOut_t jacobian, ConfigurationIn_t argument,
+          EvaluationContext& context) const
+      {
+        legacyValueAndJacobian (result, jacobian, argument, &context);
+      }
+      void impl_valueAndJacobianCompressed (LiegroupElement& result,
+          matrixOut_t jacobian, ConfigurationIn_t argument) const
+      {
+        legacyValueAndJacobian (result, jacobian, argument, NULL);
+      }
+      void impl_valueAndJacobianCompressed (LiegroupElement& result,
+          matrixOut_t jacobian, ConfigurationIn_t argument,
+          EvaluationContext& context) const
+      {
+        legacyValueAndJacobian (result, jacobian, argument, &context);
+      }
+
+      /// Copy the relevant rows of the relative transformation of the
+      /// sibling.
+      void copyInternalValue (LiegroupElement& result) const;
+      void copyInternalJacobian (matrixOut_t jacobian) const;
+
       ConvexShapeContactPtr_t sibling_;
     }; // class ConvexShapeContactComplement
     /// \}
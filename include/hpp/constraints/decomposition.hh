@@ -0,0 +1,179 @@
+// Copyright (c) 2018, Joseph Mirabel
+// Authors: Joseph Mirabel (joseph.mirabel@laas.fr)
+//
+// This file is part of hpp-constraints.
+// hpp-constraints is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-constraints is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-constraints. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HPP_CONSTRAINTS_DECOMPOSITION_HH
+# define HPP_CONSTRAINTS_DECOMPOSITION_HH
+
+# include <Eigen/SVD>
+# include <Eigen/QR>
+# include <Eigen/Cholesky>
+
+# include <hpp/constraints/fwd.hh>
+# include <hpp/constraints/config.hh>
+
+namespace hpp {
+  namespace constraints {
+    /// \addtogroup solvers
+    /// \{
+
+    /// Decomposition of a Jacobian used to compute the descent direction.
+    ///
+    /// For a Jacobian \f$ J \f$ of size \f$ m \times n \f$, the
+    /// decomposition provides
+    /// \li a solution of \f$ J x = b \f$, of minimal norm when the system is
+    ///     underdetermined,
+    /// \li the rank of \f$ J \f$ and its singular values,
+    /// \li the projector onto the span of \f$ J^T \f$,
+    /// \li optionally, an orthogonal matrix \f$ Q \f$, stored as
+    ///     Householder reflections, whose last columns span the kernel of
+    ///     \f$ J \f$.
+    ///
+    /// The singular values are exact only for the SVD types. For the
+    /// other types, they are estimated from the diagonal of the triangular
+    /// factor.
+    ///
+    /// Once allocated, the decomposition does not allocate memory, except
+    /// for types BDC_SVD and COMPLETE_ORTHOGONAL_DECOMPOSITION.
+    class HPP_CONSTRAINTS_DLLAPI Decomposition
+    {
+      public:
+        enum Type {
+          /// Eigen::JacobiSVD. This is the most accurate and the slowest.
+          JACOBI_SVD,
+          /// Eigen::BDCSVD. Requires Eigen >= 3.3.
+          BDC_SVD,
+          /// Eigen::CompleteOrthogonalDecomposition. Requires Eigen >= 3.3.
+          COMPLETE_ORTHOGONAL_DECOMPOSITION,
+          /// Eigen::ColPivHouseholderQR of \f$ J^T \f$.
+          COL_PIV_HOUSEHOLDER_QR,
+          /// Eigen::LLT of \f$ J J^T + \lambda I \f$ where \f$ \lambda \f$
+          /// is the damping. The rank is estimated.
+          DAMPED_LLT
+        };
+
+        Decomposition ();
+
+        /// Allocate memory for matrices of size rows x cols.
+        /// \param computeKernel whether the kernel will be used. Except
+        ///        for COL_PIV_HOUSEHOLDER_QR, it requires an additional
+        ///        ColPivHouseholderQR of \f$ J^T \f$.
+        /// \throw std::invalid_argument if type is not available with the
+        ///        version of Eigen.
+        void allocate (Type type, size_type rows, size_type cols,
+                       bool computeKernel = false);
+
+        Type type () const
+        {
+          return type_;
+        }
+
+        /// Set the threshold relative to the largest singular value under
+        /// which a singular value is considered to be zero.
+        void threshold (const value_type& threshold);
+
+        /// Set the damping of DAMPED_LLT.
+        void damping (const value_type& damping)
+        {
+          damping_ = damping;
+        }
+
+        value_type damping () const
+        {
+          return damping_;
+        }
+
+        /// Compute the decomposition of J.
+        /// \note memory is reallocated if the size of J differs from the
+        ///       allocated size.
+        void compute (const matrix_t& J);
+
+        /// Compute x such that \f$ J x = b \f$.
+        void solve (vectorIn_t b, vectorOut_t x) const;
+
+        /// Rank of the decomposed matrix
+        size_type rank () const;
+
+        /// Singular values, by decreasing order.
+        /// \note the values are estimates for the types that are not SVD.
+        const vector_t& singularValues () const;
+
+        /// Compute the projector onto the span of \f$ J^T \f$.
+        void projectorOnSpan (matrixOut_t projector) const;
+
+        /// Remove from x its projection onto the span of \f$ J^T \f$, so that
+        /// x lies in the kernel of J.
+        void projectOnKernel (vectorOut_t x) const;
+
+        /// \name Kernel
+        /// Let \f$ Q \f$ be an orthogonal matrix whose last
+        /// kernelDimension() columns span the kernel of J. The product by
+        /// \f$ Q \f$ costs \f$ O(n \times rank) \f$ per vector of size n.
+        /// \warning the decomposition must have been allocated with
+        ///          computeKernel set to true.
+        /// \{
+
+        /// Dimension of the kernel
+        size_type kernelDimension () const;
+
+        /// Compute \f$ M Q \f$ in place.
+        /// M must have as many columns as J.
+        void applyKernelQOnTheRight (matrixOut_t M) const;
+
+        /// Compute \f$ Q x \f$ in place.
+        /// x must have as many rows as J has columns.
+        void applyKernelQOnTheLeft (vectorOut_t x) const;
+
+        /// \}
+
+        /// Number of columns of the decomposed matrix.
+        size_type cols () const
+        {
+          return cols_;
+        }
+
+      private:
+        void estimateSingularValues ();
+
+        Type type_;
+        value_type threshold_, damping_;
+        size_type rank_;
+        size_type rows_, cols_;
+        bool computeKernel_;
+
+        Eigen::JacobiSVD <matrix_t> jacobiSvd_;
+# if EIGEN_VERSION_AT_LEAST(3,3,0)
+        Eigen::BDCSVD <matrix_t> bdcSvd_;
+        Eigen::CompleteOrthogonalDecomposition <matrix_t> cod_;
+# endif // EIGEN_VERSION_AT_LEAST(3,3,0)
+        /// Decomposition of \f$ J^T \f$ for COL_PIV_HOUSEHOLDER_QR. For the
+        /// other types, it is only computed for the kernel.
+        Eigen::ColPivHouseholderQR <matrix_t> qr_;
+        Eigen::LLT <matrix_t> llt_;
+
+        /// Copy of the decomposed matrix, for the types which need it.
+        matrix_t J_;
+        /// \f$ J J^T + \lambda I \f$, for DAMPED_LLT.
+        matrix_t JJt_;
+        /// Singular value estimates, for the types that are not SVD.
+        vector_t sv_;
+        mutable vector_t tmpRows_, tmpCols_, householderWs_, kernelWs_;
+        mutable matrix_t Q1_, tmpJ_;
+    }; // class Decomposition
+    /// \}
+  } // namespace constraints
+} // namespace hpp
+
+#endif // HPP_CONSTRAINTS_DECOMPOSITION_HH
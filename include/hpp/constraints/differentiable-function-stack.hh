@@ -21,6 +21,8 @@
 
 # include <hpp/constraints/fwd.hh>
 # include <hpp/constraints/differentiable-function.hh>
+# include <hpp/constraints/evaluation-context.hh>
+# include <hpp/constraints/work-stealing-pool.hh>
 
 namespace hpp {
   namespace constraints {
@@ -73,10 +75,16 @@ namespace hpp {
               activeDerivativeParameters_ || func->activeDerivativeParameters();
           }
           functions_.push_back(func);
+          valueRows_.push_back (outputSize ());
+          derivativeRows_.push_back (outputDerivativeSize ());
           result_.push_back (LiegroupElement (func->outputSpace ()));
           outputSpace_ = outputSpace_ * func->outputSpace ();
         }
 
+        /// Remove a function from the stack
+        /// \return whether the function was in the stack.
+        bool remove (const DifferentiableFunctionPtr_t& func);
+
         /// The output columns selection of other is not taken into account.
         void merge (const DifferentiableFunctionStackPtr_t& other)
         {
@@ -88,23 +96,59 @@ namespace hpp {
 
         /// \}
 
+        /// \name Parallel evaluation
+        /// \{
+
+        /// Evaluate the functions of the stack in parallel.
+        ///
+        /// \param pool the threads evaluating the functions, NULL to
+        ///        evaluate them sequentially,
+        /// \param minFunctions the minimal number of functions of the stack
+        ///        for the evaluation to be parallel.
+        ///
+        /// Each function is evaluated by a task writing directly into its
+        /// rows of the value and of the Jacobian, in an EvaluationContext
+        /// owned by the thread running the task. As each context computes
+        /// its own forward kinematics, stacks with less than minFunctions
+        /// functions are evaluated sequentially.
+        ///
+        /// \note The evaluation does not modify the state of the robot,
+        ///       even when no context is given, except for the functions
+        ///       which do not reimplement the evaluation in a context.
+        void parallel (WorkStealingPool* pool, std::size_t minFunctions = 16);
+
+        /// Pool evaluating the functions, NULL if the evaluation is
+        /// sequential.
+        WorkStealingPool* pool () const
+        {
+          return pool_;
+        }
+
+        /// \}
+
         std::ostream& print (std::ostream& os) const;
 
         /// Constructor
         ///
         /// \param name the name of the constraints,
         DifferentiableFunctionStack (const std::string& name)
-          : DifferentiableFunction (0, 0, 0, name)
+          : DifferentiableFunction (0, 0, 0, name), pool_ (NULL),
+          minParallelFunctions_ (0),
+          resultScratch_ (EvaluationContext::newScratchId ())
         {}
 
         DifferentiableFunctionStack ()
-          : DifferentiableFunction (0, 0, 0, "Stack")
+          : DifferentiableFunction (0, 0, 0, "Stack"), pool_ (NULL),
+          minParallelFunctions_ (0),
+          resultScratch_ (EvaluationContext::newScratchId ())
         {}
 
       protected:
         void impl_compute (LiegroupElement& result, ConfigurationIn_t arg)
           const throw ()
         {
+          if (isParallel ())
+            return evaluateInParallel (&result, NULL, arg);
           size_type row = 0;
           std::size_t i = 0;
           for (Functions_t::const_iterator _f = functions_.begin();
@@ -118,6 +162,8 @@ namespace hpp {
         }
         void impl_jacobian (matrixOut_t jacobian, ConfigurationIn_t arg) const throw ()
         {
+          if (isParallel ())
+            return evaluateInParallel (NULL, &jacobian, arg);
           size_type row = 0;
           for (Functions_t::const_iterator _f = functions_.begin();
               _f != functions_.end(); ++_f) {
@@ -126,9 +172,101 @@ namespace hpp {
             row += f.outputSize();
           }
         }
+        void impl_compute (LiegroupElement& result, ConfigurationIn_t arg,
+                           EvaluationContext& context) const
+        {
+          if (isParallel ())
+            return evaluateInParallel (&result, NULL, arg);
+          std::vector <LiegroupElement>& results =
+            context.scratch (resultScratch_, result_);
+          size_type row = 0;
+          std::size_t i = 0;
+          for (Functions_t::const_iterator _f = functions_.begin();
+              _f != functions_.end(); ++_f) {
+            const DifferentiableFunction& f = **_f;
+            f.impl_compute(results [i], arg, context);
+            result.vector ().segment(row, f.outputSize()) =
+              results [i].vector ();
+            row += f.outputSize(); ++i;
+          }
+        }
+        void impl_jacobian (matrixOut_t jacobian, ConfigurationIn_t arg,
+                            EvaluationContext& context) const
+        {
+          if (isParallel ())
+            return evaluateInParallel (NULL, &jacobian, arg);
+          size_type row = 0;
+          for (Functions_t::const_iterator _f = functions_.begin();
+              _f != functions_.end(); ++_f) {
+            const DifferentiableFunction& f = **_f;
+            f.impl_jacobian(jacobian.middleRows(row, f.outputSize()), arg,
+                            context);
+            row += f.outputSize();
+          }
+        }
+        void impl_valueAndJacobian (LiegroupElement& result,
+                                    matrixOut_t jacobian,
+                                    ConfigurationIn_t arg) const
+        {
+          if (isParallel ())
+            return evaluateInParallel (&result, &jacobian, arg);
+          size_type row = 0, derRow = 0;
+          std::size_t i = 0;
+          for (Functions_t::const_iterator _f = functions_.begin();
+              _f != functions_.end(); ++_f) {
+            const DifferentiableFunction& f = **_f;
+            f.impl_valueAndJacobian (result_ [i],
+                jacobian.middleRows(derRow, f.outputDerivativeSize()), arg);
+            result.vector ().segment(row, f.outputSize()) =
+              result_ [i].vector ();
+            row += f.outputSize(); derRow += f.outputDerivativeSize(); ++i;
+          }
+        }
+        void impl_valueAndJacobian (LiegroupElement& result,
+                                    matrixOut_t jacobian,
+                                    ConfigurationIn_t arg,
+                                    EvaluationContext& context) const
+        {
+          if (isParallel ())
+            return evaluateInParallel (&result, &jacobian, arg);
+          std::vector <LiegroupElement>& results =
+            context.scratch (resultScratch_, result_);
+          size_type row = 0, derRow = 0;
+          std::size_t i = 0;
+          for (Functions_t::const_iterator _f = functions_.begin();
+              _f != functions_.end(); ++_f) {
+            const DifferentiableFunction& f = **_f;
+            f.impl_valueAndJacobian (results [i],
+                jacobian.middleRows(derRow, f.outputDerivativeSize()), arg,
+                context);
+            result.vector ().segment(row, f.outputSize()) =
+              results [i].vector ();
+            row += f.outputSize(); derRow += f.outputDerivativeSize(); ++i;
+          }
+        }
       private:
+        bool isParallel () const
+        {
+          return pool_ != NULL && functions_.size () >= minParallelFunctions_;
+        }
+
+        /// Evaluate the functions in the threads of pool_.
+        /// \param result the value, or NULL if it is not required,
+        /// \param jacobian the Jacobian, or NULL if it is not required.
+        void evaluateInParallel (LiegroupElement* result,
+                                 matrixOut_t* jacobian,
+                                 ConfigurationIn_t arg) const;
+
         Functions_t functions_;
         mutable std::vector <LiegroupElement> result_;
+        /// First row of each function in the value and in the Jacobian.
+        std::vector <size_type> valueRows_, derivativeRows_;
+        WorkStealingPool* pool_;
+        std::size_t minParallelFunctions_;
+        /// Evaluation context of each thread of pool_.
+        std::vector <EvaluationContextPtr_t> workerContexts_;
+        /// Identifier of result_ in an EvaluationContext.
+        std::size_t resultScratch_;
     }; // class DifferentiableFunctionStack
     /// \}
   } // namespace constraints
@@ -66,6 +66,125 @@ namespace hpp {
 	impl_jacobian (jacobian, argument);
       }
 
+      /// Evaluate the function at a given parameter in a context.
+      ///
+      /// Contrary to value (LiegroupElement&, vectorIn_t) const, the state of
+      /// the robot is left unchanged: the kinematics and the scratch buffers
+      /// are stored in the context. The same function can be evaluated
+      /// concurrently in several threads using one context per thread.
+      ///
+      /// \note parameters should be of the correct size.
+      void value (LiegroupElement& result, vectorIn_t argument,
+                  EvaluationContext& context) const
+      {
+	assert (result.size () == outputSize ());
+	assert (argument.size () == inputSize ());
+	impl_compute (result, argument, context);
+      }
+      /// Computes the jacobian in a context.
+      ///
+      /// \sa value (LiegroupElement&, vectorIn_t, EvaluationContext&) const
+      void jacobian (matrixOut_t jacobian, vectorIn_t argument,
+                     EvaluationContext& context) const
+      {
+	assert (argument.size () == inputSize ());
+	assert (jacobian.rows () == outputDerivativeSize ());
+	assert (jacobian.cols () == inputDerivativeSize ());
+	impl_jacobian (jacobian, argument, context);
+      }
+
+      /// Computes the active columns of the jacobian.
+      ///
+      /// \retval jacobian matrix of size outputDerivativeSize () x
+      ///         activeDerivativeSize (). Its columns are the columns of the
+      ///         jacobian corresponding to the active derivative parameters
+      ///         (see activeDerivativeParameters), in increasing order.
+      /// \param argument point at which the jacobian will be computed
+      ///
+      /// The other columns of the jacobian are zero and are not computed.
+      void jacobianCompressed (matrixOut_t jacobian, vectorIn_t argument) const
+      {
+	assert (argument.size () == inputSize ());
+	assert (jacobian.rows () == outputDerivativeSize ());
+	assert (jacobian.cols () == activeDerivativeSize ());
+	impl_jacobianCompressed (jacobian, argument);
+      }
+
+      /// Computes the active columns of the jacobian in a context.
+      ///
+      /// \sa jacobianCompressed (matrixOut_t, vectorIn_t) const,
+      ///     value (LiegroupElement&, vectorIn_t, EvaluationContext&) const
+      void jacobianCompressed (matrixOut_t jacobian, vectorIn_t argument,
+                               EvaluationContext& context) const
+      {
+	assert (argument.size () == inputSize ());
+	assert (jacobian.rows () == outputDerivativeSize ());
+	assert (jacobian.cols () == activeDerivativeSize ());
+	impl_jacobianCompressed (jacobian, argument, context);
+      }
+
+      /// Evaluate the function and compute its jacobian.
+      ///
+      /// The result is the same as value (LiegroupElement&, vectorIn_t) const
+      /// followed by jacobian (matrixOut_t, vectorIn_t) const but the
+      /// computations common to the value and the jacobian are done once.
+      void valueAndJacobian (LiegroupElement& result, matrixOut_t jacobian,
+                             vectorIn_t argument) const
+      {
+	assert (result.size () == outputSize ());
+	assert (argument.size () == inputSize ());
+	assert (jacobian.rows () == outputDerivativeSize ());
+	assert (jacobian.cols () == inputDerivativeSize ());
+	impl_valueAndJacobian (result, jacobian, argument);
+      }
+
+      /// Evaluate the function and compute its jacobian in a context.
+      ///
+      /// \sa valueAndJacobian (LiegroupElement&, matrixOut_t, vectorIn_t) const,
+      ///     value (LiegroupElement&, vectorIn_t, EvaluationContext&) const
+      void valueAndJacobian (LiegroupElement& result, matrixOut_t jacobian,
+                             vectorIn_t argument,
+                             EvaluationContext& context) const
+      {
+	assert (result.size () == outputSize ());
+	assert (argument.size () == inputSize ());
+	assert (jacobian.rows () == outputDerivativeSize ());
+	assert (jacobian.cols () == inputDerivativeSize ());
+	impl_valueAndJacobian (result, jacobian, argument, context);
+      }
+
+      /// Evaluate the function and compute the active columns of its
+      /// jacobian.
+      ///
+      /// \sa valueAndJacobian (LiegroupElement&, matrixOut_t, vectorIn_t) const,
+      ///     jacobianCompressed (matrixOut_t, vectorIn_t) const
+      void valueAndJacobianCompressed (LiegroupElement& result,
+                                       matrixOut_t jacobian,
+                                       vectorIn_t argument) const
+      {
+	assert (result.size () == outputSize ());
+	assert (argument.size () == inputSize ());
+	assert (jacobian.rows () == outputDerivativeSize ());
+	assert (jacobian.cols () == activeDerivativeSize ());
+	impl_valueAndJacobianCompressed (result, jacobian, argument);
+      }
+
+      /// Evaluate the function and compute the active columns of its
+      /// jacobian in a context.
+      ///
+      /// \sa valueAndJacobianCompressed (LiegroupElement&, matrixOut_t, vectorIn_t) const
+      void valueAndJacobianCompressed (LiegroupElement& result,
+                                       matrixOut_t jacobian,
+                                       vectorIn_t argument,
+                                       EvaluationContext& context) const
+      {
+	assert (result.size () == outputSize ());
+	assert (argument.size () == inputSize ());
+	assert (jacobian.rows () == outputDerivativeSize ());
+	assert (jacobian.cols () == activeDerivativeSize ());
+	impl_valueAndJacobianCompressed (result, jacobian, argument, context);
+      }
+
       /// Returns a vector of booleans that indicates whether the corresponding
       /// configuration parameter influences this constraints.
       const ArrayXb& activeParameters () const
@@ -80,6 +199,14 @@ namespace hpp {
         return activeDerivativeParameters_;
       }
 
+      /// Number of active derivative parameters, i.e. the number of columns
+      /// of the compressed jacobian.
+      /// \sa jacobianCompressed
+      size_type activeDerivativeSize () const
+      {
+        return activeDerivativeParameters_.count ();
+      }
+
       /// Get dimension of input vector
       size_type inputSize () const
       {
@@ -183,6 +310,106 @@ namespace hpp {
       virtual void impl_jacobian (matrixOut_t jacobian,
 				  vectorIn_t arg) const = 0;
 
+      /// User implementation of function evaluation in a context
+      ///
+      /// The default implementation calls impl_compute (LiegroupElement&,
+      /// vectorIn_t) const while holding a lock shared by all the functions,
+      /// as it may modify the state of the robot. Functions that do not
+      /// modify any shared data should reimplement it.
+      virtual void impl_compute (LiegroupElement& result,
+				 vectorIn_t argument,
+                                 EvaluationContext& context) const;
+
+      /// User implementation of jacobian computation in a context
+      ///
+      /// \sa impl_compute (LiegroupElement&, vectorIn_t, EvaluationContext&) const
+      virtual void impl_jacobian (matrixOut_t jacobian,
+				  vectorIn_t arg,
+                                  EvaluationContext& context) const;
+
+      /// User implementation of the computation of the active columns of
+      /// the jacobian.
+      ///
+      /// The default implementation computes the jacobian with
+      /// impl_jacobian (matrixOut_t, vectorIn_t) const and copies its active
+      /// columns. Functions which depend on few parameters should
+      /// reimplement it to compute the active columns only.
+      virtual void impl_jacobianCompressed (matrixOut_t jacobian,
+                                            vectorIn_t arg) const;
+
+      /// User implementation of the computation of the active columns of
+      /// the jacobian in a context
+      ///
+      /// The default implementation computes the jacobian with
+      /// impl_jacobian (matrixOut_t, vectorIn_t, EvaluationContext&) const
+      /// and copies its active columns.
+      virtual void impl_jacobianCompressed (matrixOut_t jacobian,
+                                            vectorIn_t arg,
+                                            EvaluationContext& context) const;
+
+      /// User implementation of the evaluation of the value and of the
+      /// jacobian.
+      ///
+      /// The default implementation calls impl_compute (LiegroupElement&,
+      /// vectorIn_t) const and impl_jacobian (matrixOut_t, vectorIn_t) const.
+      /// Functions whose value and jacobian share intermediate results
+      /// should reimplement it.
+      virtual void impl_valueAndJacobian (LiegroupElement& result,
+                                          matrixOut_t jacobian,
+                                          vectorIn_t arg) const;
+
+      /// User implementation of the evaluation of the value and of the
+      /// jacobian in a context.
+      ///
+      /// The default implementation calls the context versions of
+      /// impl_compute and impl_jacobian.
+      virtual void impl_valueAndJacobian (LiegroupElement& result,
+                                          matrixOut_t jacobian,
+                                          vectorIn_t arg,
+                                          EvaluationContext& context) const;
+
+      /// User implementation of the evaluation of the value and of the
+      /// active columns of the jacobian.
+      ///
+      /// When all the derivative parameters are active, the default
+      /// implementation calls impl_valueAndJacobian (LiegroupElement&,
+      /// matrixOut_t, vectorIn_t) const. Otherwise, it calls impl_compute
+      /// and impl_jacobianCompressed.
+      virtual void impl_valueAndJacobianCompressed (LiegroupElement& result,
+                                                    matrixOut_t jacobian,
+                                                    vectorIn_t arg) const;
+
+      /// User implementation of the evaluation of the value and of the
+      /// active columns of the jacobian in a context.
+      ///
+      /// \sa impl_valueAndJacobianCompressed (LiegroupElement&, matrixOut_t, vectorIn_t) const
+      virtual void impl_valueAndJacobianCompressed (LiegroupElement& result,
+                                                    matrixOut_t jacobian,
+                                                    vectorIn_t arg,
+                                                    EvaluationContext& context) const;
+
+      /// Evaluate the value and the jacobian, or its active columns, with
+      /// impl_valueAndJacobian (LiegroupElement&, matrixOut_t, vectorIn_t) const.
+      ///
+      /// Functions that reimplement the fused evaluation without context
+      /// only should call it from the other versions of
+      /// impl_valueAndJacobian and impl_valueAndJacobianCompressed, that
+      /// otherwise evaluate the value and the jacobian separately.
+      /// \param jacobian the jacobian, or its active columns,
+      /// \param context if not NULL, the lock shared by the evaluations
+      ///        without context is held during the evaluation and the
+      ///        full jacobian is stored in the context.
+      void legacyValueAndJacobian (LiegroupElement& result,
+                                   matrixOut_t jacobian, vectorIn_t arg,
+                                   EvaluationContext* context) const;
+
+      /// Copy the active columns of a jacobian.
+      /// \param jacobian the jacobian, of size
+      ///        outputDerivativeSize () x inputDerivativeSize ()
+      /// \retval compressed the active columns
+      void compressJacobian (matrixIn_t jacobian,
+                             matrixOut_t compressed) const;
+
       /// Dimension of input vector.
       size_type inputSize_;
       /// Dimension of input derivative
@@ -203,6 +430,11 @@ namespace hpp {
       std::string name_;
       /// Context of creation of function
       std::string context_;
+      /// Jacobian used by the default implementation of
+      /// impl_jacobianCompressed.
+      mutable matrix_t jacobianBuffer_;
+      /// Identifier of jacobianBuffer_ in an EvaluationContext.
+      std::size_t jacobianScratch_;
 
       friend class DifferentiableFunctionStack;
     }; // class DifferentiableFunction
@@ -96,6 +96,12 @@ namespace hpp {
 				 ConfigurationIn_t argument) const throw ();
       virtual void impl_jacobian (matrixOut_t jacobian,
 				  ConfigurationIn_t arg) const throw ();
+      virtual void impl_compute (LiegroupElement& result,
+				 ConfigurationIn_t argument,
+                                 EvaluationContext& context) const;
+      virtual void impl_jacobian (matrixOut_t jacobian,
+				  ConfigurationIn_t arg,
+                                  EvaluationContext& context) const;
     private:
       DevicePtr_t robot_;
       JointPtr_t joint1_;
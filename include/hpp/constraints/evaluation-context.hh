@@ -0,0 +1,179 @@
+// Copyright (c) 2018, Joseph Mirabel
+// Authors: Joseph Mirabel (joseph.mirabel@laas.fr)
+//
+// This file is part of hpp-constraints.
+// hpp-constraints is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-constraints is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-constraints. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HPP_CONSTRAINTS_EVALUATION_CONTEXT_HH
+# define HPP_CONSTRAINTS_EVALUATION_CONTEXT_HH
+
+# include <map>
+
+# include <hpp/constraints/fwd.hh>
+# include <hpp/constraints/config.hh>
+
+namespace hpp {
+  namespace constraints {
+    /// \addtogroup constraints
+    /// \{
+
+    /// Storage for the evaluation of differentiable functions.
+    ///
+    /// An evaluation context owns the pinocchio data of the robots the
+    /// functions depend on and the scratch buffers of the functions.
+    /// Evaluating a function in a context, with
+    /// DifferentiableFunction::value (LiegroupElement&, vectorIn_t, EvaluationContext&) and
+    /// DifferentiableFunction::jacobian (matrixOut_t, vectorIn_t, EvaluationContext&),
+    /// does not modify the state of the robot (Device). Several threads can
+    /// thus evaluate the same functions concurrently, provided each thread
+    /// uses its own context.
+    ///
+    /// The kinematics of a robot are computed once per configuration. By
+    /// default, the configuration is compared to the one of the last
+    /// computation. A caller which evaluates several functions at the same
+    /// configuration can avoid this comparison by enclosing the evaluations
+    /// between lockConfiguration and unlockConfiguration.
+    ///
+    /// \note A context is not thread safe itself.
+    class HPP_CONSTRAINTS_DLLAPI EvaluationContext
+    {
+      public:
+        EvaluationContext ();
+
+        ~EvaluationContext ();
+
+        /// Compute the forward kinematics of a robot.
+        ///
+        /// \param robot the robot,
+        /// \param q the robot configuration,
+        /// \param jacobians whether the joint Jacobians are required.
+        ///
+        /// Nothing is computed if the kinematics of this robot were already
+        /// computed in this context for the same configuration.
+        void computeForwardKinematics (const DevicePtr_t& robot,
+                                       vectorIn_t q, bool jacobians);
+
+        /// Declare that the following evaluations are at the same
+        /// configuration, until unlockConfiguration is called.
+        ///
+        /// \param jacobians whether the joint Jacobians will be required.
+        ///        If so, the first forward kinematics computes them, which
+        ///        avoids a second computation for the first Jacobian.
+        ///
+        /// The kinematics of each robot are then computed at most once and
+        /// the configuration is not compared to the previous one.
+        void lockConfiguration (bool jacobians)
+        {
+          assert (!locked_);
+          ++version_;
+          locked_ = true;
+          lockedWithJacobians_ = jacobians;
+        }
+
+        /// Allow the following evaluations to be at another configuration.
+        void unlockConfiguration ()
+        {
+          assert (locked_);
+          ++version_;
+          locked_ = false;
+        }
+
+        /// Version stamp of the configuration, incremented by
+        /// lockConfiguration and unlockConfiguration.
+        std::size_t configurationVersion () const
+        {
+          return version_;
+        }
+
+        /// Number of forward kinematics computed in this context.
+        std::size_t forwardKinematicsCount () const
+        {
+          return forwardKinematicsCount_;
+        }
+
+        /// Position of a joint of robot in the world frame.
+        ///
+        /// \pre computeForwardKinematics has been called with this robot.
+        const Transform3f& currentTransformation
+        (const DevicePtr_t& robot, const JointConstPtr_t& joint) const;
+
+        /// Jacobian of a joint of robot, expressed in the joint frame.
+        ///
+        /// \pre computeForwardKinematics has been called with this robot
+        ///      and jacobians set to true.
+        const JointJacobian_t& jacobian
+        (const DevicePtr_t& robot, const JointConstPtr_t& joint) const;
+
+        /// Allocate a new identifier of scratch data.
+        ///
+        /// Functions allocate an identifier for each of their scratch data
+        /// when they are constructed. The identifiers are never reused, so
+        /// that the scratch data of a destroyed function are never
+        /// returned to another one.
+        static std::size_t newScratchId ();
+
+        /// Get scratch data.
+        ///
+        /// \param id identifier of the scratch data, see newScratchId,
+        /// \param init value the scratch data is initialized with, the first
+        ///        time it is requested.
+        /// \note the type of the scratch data of an identifier never changes.
+        template <typename T> T& scratch (std::size_t id, const T& init)
+        {
+          ScratchBase*& s = scratches_[id];
+          if (s == NULL) s = new Scratch<T> (init);
+          assert (dynamic_cast <Scratch<T>*> (s) != NULL);
+          return static_cast <Scratch<T>*> (s)->value;
+        }
+
+        /// Delete the scratch data.
+        ///
+        /// The solvers call it when they are modified, so that the scratch
+        /// data of the functions they do not use anymore are released.
+        void clearScratches ();
+
+      private:
+        struct RobotData;
+        struct ScratchBase
+        {
+          virtual ~ScratchBase () {}
+        };
+        template <typename T> struct Scratch : ScratchBase
+        {
+          Scratch (const T& init) : value (init) {}
+          T value;
+          EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+        };
+        typedef std::map <const Device*, RobotData*> RobotDatas_t;
+        typedef std::map <std::size_t, ScratchBase*> Scratches_t;
+
+        RobotData& robotData (const DevicePtr_t& robot) const;
+
+        // Non copyable
+        EvaluationContext (const EvaluationContext&);
+        EvaluationContext& operator= (const EvaluationContext&);
+
+        mutable RobotDatas_t robotDatas_;
+        /// Cache of the last call to robotData
+        mutable const Device* lastRobot_;
+        mutable RobotData* lastRobotData_;
+        Scratches_t scratches_;
+        std::size_t version_;
+        bool locked_, lockedWithJacobians_;
+        std::size_t forwardKinematicsCount_;
+    }; // class EvaluationContext
+    /// \}
+  } // namespace constraints
+} // namespace hpp
+
+#endif // HPP_CONSTRAINTS_EVALUATION_CONTEXT_HH
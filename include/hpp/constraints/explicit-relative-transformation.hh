@@ -0,0 +1,158 @@
+// Copyright (c) 2018, Joseph Mirabel
+// Authors: Joseph Mirabel (joseph.mirabel@laas.fr)
+//
+// This file is part of hpp-constraints.
+// hpp-constraints is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-constraints is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-constraints. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HPP_CONSTRAINTS_EXPLICIT_RELATIVE_TRANSFORMATION_HH
+# define HPP_CONSTRAINTS_EXPLICIT_RELATIVE_TRANSFORMATION_HH
+
+# include <hpp/constraints/fwd.hh>
+# include <hpp/constraints/config.hh>
+# include <hpp/constraints/differentiable-function.hh>
+# include <hpp/constraints/matrix-view.hh>
+
+namespace hpp {
+  namespace constraints {
+    /// \addtogroup constraints
+    /// \{
+
+    /// Explicit formulation of a relative transformation.
+    ///
+    /// The constraint \f$ T_1 T_{1/J_1} = T_2 T_{2/J_2} \f$, where joint 2
+    /// is a free-flyer attached to the world, is solved in closed form:
+    /// the configuration of joint 2 is computed from the configuration of
+    /// joint 1 and of its ancestors by
+    /// \f{equation*}
+    /// M_2 (\mathbf{q}) = P_2^{-1} T_1 (\mathbf{q}) T_{1/J_1} T_{2/J_2}^{-1}
+    /// \f}
+    /// where \f$ P_2 \f$ is the placement of joint 2 in the world frame.
+    /// If joint 1 is NULL, \f$ T_1 \f$ is the identity and the function is
+    /// constant.
+    ///
+    /// The function is meant to be added to an ExplicitSolver with
+    /// inArg(), outArg(), inDer() and outDer(). Its input are the
+    /// configuration parameters of inArg() and its output is the
+    /// configuration of joint 2.
+    class HPP_CONSTRAINTS_DLLAPI ExplicitRelativeTransformation :
+      public DifferentiableFunction
+    {
+      public:
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+        /// Return a shared pointer to a new instance
+        /// \param joint1 the joint the configuration of joint 2 depends on,
+        ///        NULL for the world frame,
+        /// \param joint2 a free-flyer joint whose parent is the world,
+        /// \param frame1 position of a fixed frame in joint 1,
+        /// \param frame2 position of a fixed frame in joint 2.
+        /// \pre isExplicit (robot, joint1, joint2)
+        static ExplicitRelativeTransformationPtr_t create
+        (const std::string& name, const DevicePtr_t& robot,
+         const JointConstPtr_t& joint1, const JointConstPtr_t& joint2,
+         const Transform3f& frame1, const Transform3f& frame2);
+
+        /// Whether the relative transformation between joint1 and joint2 can
+        /// be solved explicitly for the configuration of joint2, i.e.
+        /// whether joint2 is a free-flyer attached to the world which is
+        /// not an ancestor of joint1.
+        static bool isExplicit (const DevicePtr_t& robot,
+                                const JointConstPtr_t& joint1,
+                                const JointConstPtr_t& joint2);
+
+        virtual ~ExplicitRelativeTransformation () throw () {}
+
+        /// \name Variables of the explicit formulation
+        /// \{
+
+        /// Configuration parameters of joint 1 and of its ancestors
+        const Eigen::RowBlockIndices& inArg () const
+        {
+          return inArg_;
+        }
+
+        /// Configuration parameters of joint 2
+        const Eigen::RowBlockIndices& outArg () const
+        {
+          return outArg_;
+        }
+
+        /// Velocity parameters of joint 1 and of its ancestors
+        const Eigen::ColBlockIndices& inDer () const
+        {
+          return inDer_;
+        }
+
+        /// Velocity parameters of joint 2
+        const Eigen::RowBlockIndices& outDer () const
+        {
+          return outDer_;
+        }
+
+        /// \}
+
+        ExplicitRelativeTransformation (const std::string& name,
+            const DevicePtr_t& robot,
+            const JointConstPtr_t& joint1, const JointConstPtr_t& joint2,
+            const Transform3f& frame1, const Transform3f& frame2);
+
+      protected:
+        virtual void impl_compute (LiegroupElement& result,
+                                   ConfigurationIn_t argument) const throw ();
+
+        virtual void impl_jacobian (matrixOut_t jacobian,
+            ConfigurationIn_t arg) const throw ();
+
+        virtual void impl_compute (LiegroupElement& result,
+                                   ConfigurationIn_t argument,
+                                   EvaluationContext& context) const;
+
+        virtual void impl_jacobian (matrixOut_t jacobian,
+            ConfigurationIn_t arg, EvaluationContext& context) const;
+
+      private:
+        /// Store the configuration of joint 2 for the transformation of
+        /// joint 1.
+        void setValue (const Transform3f& M1, LiegroupElement& result) const;
+        /// Compute the jacobian from the jacobian of joint 1.
+        /// \param J1in buffer for the columns of J1 selected by inDer_.
+        void setJacobian (const JointJacobian_t& J1, matrix_t& J1in,
+                          matrixOut_t jacobian) const;
+
+        DevicePtr_t robot_;
+        JointConstPtr_t joint1_, joint2_;
+        /// \f$ P_2^{-1} \f$
+        Transform3f left_;
+        /// \f$ T_{1/J_1} T_{2/J_2}^{-1} \f$
+        Transform3f right_;
+        /// Action matrix of right_ inverse, which maps the velocity of
+        /// joint 1 to the velocity of joint 2.
+        Eigen::Matrix<value_type, 6, 6> action_;
+        Eigen::RowBlockIndices inArg_, outArg_, outDer_;
+        Eigen::ColBlockIndices inDer_;
+        /// Robot configuration in a context, of which only inArg_ is
+        /// modified.
+        Configuration_t config_;
+        /// Columns of the jacobian of joint 1 selected by inDer_.
+        matrix_t J1_;
+        /// Identifiers of config_ and J1_ in an EvaluationContext.
+        std::size_t configScratch_, J1Scratch_;
+        /// Context of the evaluations without context, so that the robot
+        /// is never modified.
+        EvaluationContextPtr_t context_;
+    }; // class ExplicitRelativeTransformation
+    /// \}
+  } // namespace constraints
+} // namespace hpp
+
+#endif // HPP_CONSTRAINTS_EXPLICIT_RELATIVE_TRANSFORMATION_HH
@@ -26,6 +26,7 @@
 
 #include <hpp/constraints/matrix-view.hh>
 #include <hpp/constraints/differentiable-function-stack.hh>
+#include <hpp/constraints/work-stealing-pool.hh>
 
 namespace hpp {
   namespace constraints {
@@ -63,15 +64,155 @@ namespace hpp {
         typedef Eigen::ColBlockIndices ColBlockIndices;
         typedef Eigen::MatrixBlockView<matrix_t, Eigen::Dynamic, Eigen::Dynamic, false, false> MatrixBlockView;
 
+        /// Data modified during the resolution.
+        ///
+        /// The solver is not modified by the functions taking a Workspace as
+        /// argument, so that it can be shared between threads owning
+        /// their own Workspace.
+        /// \warning the workspace must be reallocated
+        ///          (see ExplicitSolver::allocate) whenever the solver is
+        ///          modified.
+        struct Workspace {
+          struct FunctionData {
+            FunctionData (const DifferentiableFunctionPtr_t& f,
+                          const DifferentiableFunctionPtr_t& g);
+
+            vector_t qin, qout;
+            LiegroupElement value, expected;
+            matrix_t jacobian, jGinv;
+            /// Buffers of the computation of the Jacobian
+            /// \li Jg: Jacobian of the input of the function,
+            /// \li outJacobian: Jacobian of the output of the function,
+            /// \li tmpJacobian: product of jGinv and jacobian.
+            matrix_t Jg, outJacobian, tmpJacobian;
+            /// Rows of Jg computed by other functions, their rows in the
+            /// compact jacobian and the rows of the output of the function
+            /// in the compact jacobian.
+            /// \sa ExplicitSolver::compactJacobian
+            RowBlockIndices computedInputs, computedInputRows, outputRows;
+            /// Output of the last evaluation by ExplicitSolver::solve
+            vector_t output;
+          }; // struct FunctionData
+
+          std::vector<FunctionData> functions;
+          vector_t diffSmall;
+          /// Compact jacobian of ExplicitSolver::jacobian
+          /// \sa ExplicitSolver::compactJacobian
+          matrix_t Je;
+
+          /// \name Incremental evaluation
+          /// The functions whose input did not change since the previous
+          /// call to ExplicitSolver::solve (resp. ExplicitSolver::jacobian)
+          /// are not evaluated again.
+          /// \{
+
+          /// Argument of the previous call to ExplicitSolver::solve and to
+          /// ExplicitSolver::jacobian, empty if there was none.
+          vector_t solvedArg, jacobianArg;
+          /// Version of the solver at the previous calls.
+          std::size_t solvedVersion, jacobianVersion;
+          /// Whether the input of each function changed.
+          std::vector<bool> changed;
+
+          /// \}
+
+          /// If not NULL, the functions are evaluated in this context and
+          /// the robot state is left unchanged.
+          EvaluationContextPtr_t context;
+          /// Evaluation context of each thread of ExplicitSolver::pool, so
+          /// that several workspaces can be used concurrently.
+          std::vector<EvaluationContextPtr_t> workerContexts;
+        }; // struct Workspace
+
         /// \name Resolution
         /// \{
 
-        bool solve (vectorOut_t arg) const;
+        bool solve (vectorOut_t arg, Workspace& workspace) const;
+
+        bool isSatisfied (vectorIn_t arg, Workspace& workspace) const;
+
+        bool isSatisfied (vectorIn_t arg, vectorOut_t error,
+                          Workspace& workspace) const;
+
+        bool solve (vectorOut_t arg) const
+        {
+          return solve (arg, workspace ());
+        }
 
-        bool isSatisfied (vectorIn_t arg) const;
+        bool isSatisfied (vectorIn_t arg) const
+        {
+          return isSatisfied (arg, workspace ());
+        }
+
+        bool isSatisfied (vectorIn_t arg, vectorOut_t error) const
+        {
+          return isSatisfied (arg, error, workspace ());
+        }
+
+        /// Allocate a workspace for this solver.
+        void allocate (Workspace& workspace) const;
+
+        /// Evaluate all the functions at the next call to solve and jacobian.
+        ///
+        /// The solver only evaluates the functions whose input changed.
+        /// This must be called when a function is modified without the
+        /// solver being notified, for instance when the reference of a
+        /// transformation constraint is changed.
+        void invalidate (Workspace& workspace) const;
+
+        void invalidate () const
+        {
+          invalidate (workspace ());
+        }
+
+        /// \}
+
+        /// \name Parallel evaluation
+        /// \{
+
+        /// Evaluate the independent functions in parallel.
+        ///
+        /// The functions are grouped into wavefronts: the functions of a
+        /// wavefront only depend on the outputs of the previous ones, so that
+        /// they are evaluated concurrently. Each thread of the pool evaluates
+        /// the functions in its own EvaluationContext, stored in the
+        /// workspace (see Workspace::workerContexts).
+        /// \param pool the threads evaluating the functions, NULL to
+        ///        evaluate them sequentially,
+        /// \param minFunctions minimal number of functions of the solver
+        ///        for the evaluation to be parallel.
+        void parallel (WorkStealingPool* pool, std::size_t minFunctions = 16);
+
+        /// Pool of threads evaluating the functions, NULL if the evaluation
+        /// is sequential.
+        WorkStealingPool* pool () const
+        {
+          return pool_;
+        }
+
+        /// Indices of the functions of each wavefront.
+        /// Constant functions belong to no wavefront.
+        const std::vector<std::vector<std::size_t> >& wavefronts () const
+        {
+          return wavefronts_;
+        }
+
+        /// Whether all the functions are constant.
+        /// In this case, the output of the solver does not depend on its
+        /// input and the jacobian of the explicit solution is the identity
+        /// on the free DoFs.
+        bool isConstant () const
+        {
+          return wavefronts_.empty ();
+        }
+
+        /// Incremented whenever the functions or the right hand side are
+        /// modified.
+        std::size_t version () const
+        {
+          return version_;
+        }
 
-        bool isSatisfied (vectorIn_t arg, vectorOut_t error) const;
-        
         /// \}
 
         /// \name Construction of the problem
@@ -98,6 +239,23 @@ namespace hpp {
             const RowBlockIndices& outDer,
             const ComparisonTypes_t& comp);
 
+        /// Explicit function and its variables, for the bulk addition.
+        struct Explicit {
+          DifferentiableFunctionPtr_t f;
+          RowBlockIndices inArg, outArg;
+          ColBlockIndices inDer;
+          RowBlockIndices outDer;
+          /// Comparison types, EqualToZero if empty.
+          ComparisonTypes_t comparison;
+        }; // struct Explicit
+
+        /// Add several functions and update the solver once.
+        ///
+        /// The functions may depend on each other in any order.
+        /// \return for each function, its index if it was added, -1
+        ///         otherwise.
+        std::vector<size_type> add (const std::vector<Explicit>& functions);
+
         /// Set \f$g\f$  and \f$g^{-1}\f$ functions
         bool setG (const DifferentiableFunctionPtr_t& f,
                    const DifferentiableFunctionPtr_t& g,
@@ -113,11 +271,16 @@ namespace hpp {
           ,   inArgs_ (), freeArgs_ ()
           ,   inDers_ (), freeDers_ ()
           ,  outArgs_ (),  outDers_ ()
+          , orderedFunctions_ (0), reorder_ (false)
+          , derIsInput_ (ArrayXb::Constant (derSize, false))
           , argFunction_ (Eigen::VectorXi::Constant(argSize, -1))
           , derFunction_ (Eigen::VectorXi::Constant(derSize, -1))
           , squaredErrorThreshold_ (Eigen::NumTraits<value_type>::epsilon())
+          , version_ (0)
           // , Jg (derSize, derSize)
-          , arg_ (argSize), diff_(derSize), diffSmall_()
+          , arg_ (argSize), diff_(derSize)
+          , workspaceAllocated_ (false)
+          , pool_ (NULL), minParallelFunctions_ (0)
         {
           freeArgs_.addRow(0, argSize);
           freeDers_.addCol(0, derSize);
@@ -188,10 +351,7 @@ namespace hpp {
         /// - cols correspond to DoF
         /// - values correspond to the dependency degree of a function wrt to
         ///   a DoF
-        const Eigen::MatrixXi& inOutDependencies () const
-        {
-          return inOutDependencies_;
-        }
+        Eigen::MatrixXi inOutDependencies () const;
 
         /// Same as \ref inOutDependencies except that cols correpond to DoFs.
         Eigen::MatrixXi inOutDofDependencies () const;
@@ -237,7 +397,27 @@ namespace hpp {
         // /// \param jacobian must be of dimensions (derSize - freeDers().nbIndices(), freeDers().nbIndices())
         /// \param jacobian must be of dimensions (derSize, derSize) but only a subsegment will be used.
         /// \warning it is assumed solve(arg) has been called before.
-        void jacobian(matrixOut_t jacobian, vectorIn_t arg) const;
+        void jacobian(matrixOut_t jacobian, vectorIn_t arg, Workspace& workspace) const;
+
+        void jacobian(matrixOut_t J, vectorIn_t arg) const
+        {
+          jacobian (J, arg, workspace ());
+        }
+
+        /// Compute the jacobian of the output DoFs with respect to the
+        /// input DoFs.
+        /// This is the only non-trivial block of the jacobian, computed
+        /// without the rows and columns of the free DoFs.
+        /// \param jacobian of dimensions (outDers().nbIndices(),
+        ///        inDers().nbIndices()),
+        /// \warning it is assumed solve(arg) has been called before.
+        void compactJacobian (matrixOut_t jacobian, vectorIn_t arg,
+                              Workspace& workspace) const;
+
+        void compactJacobian (matrixOut_t jacobian, vectorIn_t arg) const
+        {
+          compactJacobian (jacobian, arg, workspace ());
+        }
 
         /// \name Right hand side accessors
         /// \{
@@ -271,9 +451,71 @@ namespace hpp {
       private:
         typedef std::vector<bool> Computed_t;
 
-        void computeFunction(const std::size_t& i, vectorOut_t arg) const;
-        void computeJacobian(const std::size_t& i, matrixOut_t J) const;
+        /// \param context where the function is evaluated, NULL to use
+        ///        the robot.
+        void computeFunction(const std::size_t& i, vectorOut_t arg,
+                             Workspace& workspace,
+                             EvaluationContext* context) const;
+        /// Compute the rows of the output of function i of the compact
+        /// jacobian J, by the chain rule.
+        void computeJacobian(const std::size_t& i, matrixOut_t J,
+                             Workspace& workspace) const;
+        /// Check that a function can be added and add it to functions_,
+        /// without updating the solver.
+        /// \return the index of the function, -1 if it cannot be added.
+        size_type addFunction (const DifferentiableFunctionPtr_t& f,
+            const RowBlockIndices& inArg,
+            const RowBlockIndices& outArg,
+            const ColBlockIndices& inDer,
+            const RowBlockIndices& outDer,
+            const ComparisonTypes_t& comp);
+        /// Update the variables, the computation order and the wavefronts
+        /// after the functions have been added.
+        void update ();
         void computeOrder(const std::size_t& iF, std::size_t& iOrder, Computed_t& computed);
+        /// Compute the dependencies and the wavefront of a function from the
+        /// ones of the functions computing its input.
+        void computeDependencies (const std::size_t& iF);
+        /// Find the constant functions and compute constantArgs_.
+        void computeConstants ();
+        /// Compute the output of function i in constantValue_, if constant.
+        void updateConstant (const std::size_t& i);
+        /// Workspace of the functions which do not take a workspace as
+        /// argument, allocated when first used after the solver is modified.
+        Workspace& workspace () const;
+
+        bool isParallel () const;
+        /// Worker index of the tasks run by the calling thread, which
+        /// evaluate the functions in the context of the workspace.
+        std::size_t callerWorker () const
+        {
+          return (pool_ == NULL ? 0 : pool_->size ());
+        }
+        /// Allocate Workspace::workerContexts for the threads of pool_.
+        void allocateWorkerContexts (Workspace& workspace) const;
+        /// Context of the evaluations of a worker.
+        EvaluationContext* context (const Workspace& workspace,
+                                    std::size_t worker) const;
+        /// Run the tasks of a wavefront in the threads of pool_.
+        void runWavefront (std::size_t nbTasks,
+                           const WorkStealingPool::Task_t& task) const;
+        /// Solve for function order[i].
+        void solveTask (const std::vector<std::size_t>& order,
+            vectorOut_t arg, Workspace& workspace, std::size_t i,
+            std::size_t worker) const;
+        /// Compute the jacobian of function i, if its input changed.
+        void functionJacobianTask (vectorIn_t arg, Workspace& workspace,
+            std::size_t i, std::size_t worker) const;
+        /// Compute the rows of the compact jacobian of function order[i].
+        void jacobianTask (const std::vector<std::size_t>& order,
+            matrixOut_t J, Workspace& workspace, std::size_t i,
+            std::size_t worker) const;
+        /// Find the functions whose input changed since lastArg, following
+        /// the computation order. An input computed by a function changes
+        /// iff the input of this function changes.
+        /// lastArg and lastVersion are set to arg and to version_.
+        void changedFunctions (vectorIn_t arg, vector_t& lastArg,
+            std::size_t& lastVersion, std::vector<bool>& changed) const;
 
         const std::size_t argSize_, derSize_;
 
@@ -290,26 +532,59 @@ namespace hpp {
           ComparisonTypes_t comparison;
           RowBlockIndices equalityIndices;
           vector_t rightHandSide;
-
-          mutable vector_t qin, qout;
-          mutable LiegroupElement value, expected;
-          mutable matrix_t jacobian, jGinv;
+          /// Whether f is a ConstantFunction and g is not set.
+          bool constant;
         }; // struct Function
 
         RowBlockIndices inArgs_, freeArgs_;
         ColBlockIndices inDers_, freeDers_;
         RowBlockIndices outArgs_, outDers_;
+        /// Variables of all the functions, inserted by add and copied to
+        /// the blocks above by update.
+        Eigen::IntervalSet inArgSet_, outArgSet_, inDerSet_, outDerSet_;
 
-        Eigen::MatrixXi inOutDependencies_;
+        /// Dependency degree of each function wrt to the free DoFs, as
+        /// (DoF, degree) pairs sorted by DoF.
+        typedef std::vector<std::pair<size_type, int> > Dependencies_t;
+        std::vector<Dependencies_t> dependencies_;
 
         std::vector<Function> functions_;
         std::vector<std::size_t> computationOrder_;
+        /// Functions of each wavefront
+        std::vector<std::vector<std::size_t> > wavefronts_;
+        /// Wavefront of each function
+        std::vector<std::size_t> functionWavefront_;
+        /// Outputs of the constant functions, set in one scatter.
+        RowBlockIndices constantArgs_;
+        /// Values of constantArgs_, right hand side included.
+        vector_t constantValue_;
+        /// Row of the output of each function in constantValue_, -1 if the
+        /// function is not constant.
+        std::vector<size_type> constantRows_;
+        /// Number of functions in computationOrder_.
+        std::size_t orderedFunctions_;
+        /// Whether a function added since the last update computes an input
+        /// of a function added before, in which case the computation order
+        /// must be computed again.
+        bool reorder_;
+        /// Whether each DoF is an input of a function.
+        ArrayXb derIsInput_;
         /// For dof i, dofFunction_[i] is the index of the function that computes it.
         /// -1 means it is the output of no function.
         Eigen::VectorXi argFunction_, derFunction_;
         value_type squaredErrorThreshold_;
+        /// Incremented whenever the functions or the right hand side are
+        /// modified.
+        std::size_t version_;
         // mutable matrix_t Jg;
-        mutable vector_t arg_, diff_, diffSmall_;
+        mutable vector_t arg_, diff_;
+        /// Workspace used by the functions which do not take a workspace
+        /// as argument.
+        mutable Workspace workspace_;
+        mutable bool workspaceAllocated_;
+
+        WorkStealingPool* pool_;
+        std::size_t minParallelFunctions_;
     }; // class ExplicitSolver
     /// \}
   } // namespace constraints
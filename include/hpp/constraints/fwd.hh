@@ -32,6 +32,8 @@ namespace hpp {
     HPP_PREDEF_CLASS (DifferentiableFunction);
     HPP_PREDEF_CLASS (DifferentiableFunctionStack);
     HPP_PREDEF_CLASS (ActiveSetDifferentiableFunction);
+    HPP_PREDEF_CLASS (EvaluationContext);
+    HPP_PREDEF_CLASS (SolverTelemetry);
     typedef pinocchio::size_type size_type;
     typedef pinocchio::value_type value_type;
     typedef pinocchio::JointPtr_t JointPtr_t;
@@ -75,6 +77,7 @@ namespace hpp {
     HPP_PREDEF_CLASS (ConfigurationConstraint);
     HPP_PREDEF_CLASS (AffineFunction);
     HPP_PREDEF_CLASS (ConstantFunction);
+    HPP_PREDEF_CLASS (ExplicitRelativeTransformation);
 
     typedef pinocchio::ObjectVector_t ObjectVector_t;
     typedef pinocchio::CollisionObjectPtr_t CollisionObjectPtr_t;
@@ -149,6 +152,7 @@ namespace hpp {
 
     class ExplicitSolver;
     class HierarchicalIterativeSolver;
+    class SolverWorkspace;
     class HybridSolver;
   } // namespace constraints
 } // namespace hpp
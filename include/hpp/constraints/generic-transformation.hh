@@ -27,6 +27,7 @@
 # include <hpp/constraints/fwd.hh>
 # include <hpp/constraints/config.hh>
 # include <hpp/constraints/differentiable-function.hh>
+# include <hpp/constraints/matrix-view.hh>
 
 namespace hpp {
   namespace constraints {
@@ -36,14 +37,30 @@ namespace hpp {
       JointConstPtr_t joint2;
       bool R1isID, R2isID, t1isZero, t2isZero;
       Transform3f F1inJ1, F2inJ2;
+      /// Kinematics of the joints, either stored in the robot or in an
+      /// EvaluationContext. They are set before each computation.
+      mutable const Transform3f *oM1, *oM2;
+      mutable const JointJacobian_t *jac1, *jac2;
+      /// Active columns of the joint Jacobians, for the compressed jacobian.
+      mutable JointJacobian_t compressedJac1, compressedJac2;
       inline JointConstPtr_t getJoint1() const { return JointConstPtr_t(); }
       inline void setJoint1(const JointConstPtr_t&) {}
-      const JointJacobian_t& J2 () const { return joint2->jacobian(); }
-      const Transform3f& M2 () const { return joint2->currentTransformation(); }
-      const vector3_t& t2 () const { return joint2->currentTransformation().translation(); }
-      const matrix3_t& R2 () const { return joint2->currentTransformation().rotation(); }
+      const JointJacobian_t& J2 () const { return *jac2; }
+      const Transform3f& M2 () const { return *oM2; }
+      const vector3_t& t2 () const { return oM2->translation(); }
+      const matrix3_t& R2 () const { return oM2->rotation(); }
+      /// Copy the parameters of another instance.
+      /// The joint pointers are copied only if they differ.
+      void setParameters (const GenericTransformationJointData& other)
+      {
+        if (joint2 != other.joint2) joint2 = other.joint2;
+        R1isID = other.R1isID; R2isID = other.R2isID;
+        t1isZero = other.t1isZero; t2isZero = other.t2isZero;
+        F1inJ1 = other.F1inJ1; F2inJ2 = other.F2inJ2;
+      }
       GenericTransformationJointData () :
-        joint2(), R1isID(true), R2isID(true), t1isZero(true), t2isZero(true)
+        joint2(), R1isID(true), R2isID(true), t1isZero(true), t2isZero(true),
+        oM1 (NULL), oM2 (NULL), jac1 (NULL), jac2 (NULL)
       { F1inJ1.setIdentity(); F2inJ2.setIdentity(); }
     };
     template <> struct GenericTransformationJointData<true> :
@@ -52,10 +69,15 @@ namespace hpp {
       JointConstPtr_t joint1;
       inline JointConstPtr_t getJoint1() const { return joint1; }
       inline void setJoint1(const JointConstPtr_t& j) { joint1 = j; }
-      const JointJacobian_t& J1 () const { return joint1->jacobian(); }
-      const Transform3f& M1 () const { return joint1->currentTransformation(); }
-      const matrix3_t& R1 () const { return joint1->currentTransformation().rotation(); }
-      const vector3_t& t1 () const { return joint1->currentTransformation().translation(); }
+      const JointJacobian_t& J1 () const { return *jac1; }
+      const Transform3f& M1 () const { return *oM1; }
+      const matrix3_t& R1 () const { return oM1->rotation(); }
+      const vector3_t& t1 () const { return oM1->translation(); }
+      void setParameters (const GenericTransformationJointData& other)
+      {
+        GenericTransformationJointData<false>::setParameters (other);
+        if (joint1 != other.joint1) joint1 = other.joint1;
+      }
       GenericTransformationJointData () :
         GenericTransformationJointData<false>(), joint1() {}
     };
@@ -80,9 +102,13 @@ namespace hpp {
       typedef Eigen::Matrix<value_type, NbRows, Eigen::Dynamic> JacobianType;
       bool fullPos, fullOri;
       size_type rowOri;
-      const size_type cols;
+      /// Number of columns of the joint Jacobians.
+      size_type cols;
       mutable ValueType value;
       mutable JacobianType jacobian;
+      /// Active columns of the jacobian, when the full jacobian is
+      /// requested.
+      mutable matrix_t activeJacobian;
       mutable Eigen::Matrix<value_type, 3, Eigen::Dynamic> tmpJac;
       mutable eigen::vector3_t cross1, cross2;
       GenericTransformationData (const size_type nCols) :
@@ -91,6 +117,25 @@ namespace hpp {
         fullPos(false), fullOri(false), cols (nCols),
         jacobian((int)NbRows, cols)
       { cross1.setZero(); cross2.setZero(); }
+      /// Copy the parameters of another instance.
+      /// The number of columns is not copied.
+      void setParameters (const GenericTransformationData& other)
+      {
+        GenericTransformationJointData<rel>::setParameters (other);
+        fullPos = other.fullPos; fullOri = other.fullOri;
+        rowOri = other.rowOri;
+      }
+      /// Copy the error computed by another instance.
+      void setError (const GenericTransformationData& other)
+      {
+        value = other.value;
+        static_cast<GenericTransformationOriData<ori>&> (*this) = other;
+      }
+      void resize (const size_type nCols)
+      {
+        cols = nCols;
+        jacobian.resize ((int)NbRows, cols);
+      }
       void checkIsIdentity1() {
         this->R1isID = this->F1inJ1.rotation().isIdentity(); this->t1isZero = this->F1inJ1.translation().isZero();
       }
@@ -252,6 +297,11 @@ namespace hpp {
 	return d_.F1inJ1.actInv(d_.F2inJ2);
       }
 
+      /// Get the robot
+      inline const DevicePtr_t& robot () const {
+	return robot_;
+      }
+
       /// Set joint 1
       inline void joint1 (const JointConstPtr_t& joint) {
         // static_assert(IsRelative);
@@ -324,13 +374,71 @@ namespace hpp {
 				 ConfigurationIn_t argument) const throw ();
       virtual void impl_jacobian (matrixOut_t jacobian,
 				  ConfigurationIn_t arg) const throw ();
+      /// Compute value of error in an evaluation context
+      ///
+      /// The robot state is not modified.
+      virtual void impl_compute	(LiegroupElement& result,
+				 ConfigurationIn_t argument,
+                                 EvaluationContext& context) const;
+      virtual void impl_jacobian (matrixOut_t jacobian,
+				  ConfigurationIn_t arg,
+                                  EvaluationContext& context) const;
+      /// Compute the active columns of the jacobian. The products with
+      /// the joint Jacobians are restricted to the active columns, i.e.
+      /// the degrees of freedom of the joints between joint1 and joint2,
+      /// excluding their common ancestors.
+      virtual void impl_jacobianCompressed (matrixOut_t jacobian,
+                                            ConfigurationIn_t arg) const;
+      virtual void impl_jacobianCompressed (matrixOut_t jacobian,
+                                            ConfigurationIn_t arg,
+                                            EvaluationContext& context) const;
+      /// Compute the value and the jacobian with a single evaluation of
+      /// the error.
+      virtual void impl_valueAndJacobian (LiegroupElement& result,
+                                          matrixOut_t jacobian,
+                                          ConfigurationIn_t arg) const;
+      virtual void impl_valueAndJacobianCompressed (LiegroupElement& result,
+                                                    matrixOut_t jacobian,
+                                                    ConfigurationIn_t arg) const;
+      virtual void impl_valueAndJacobian (LiegroupElement& result,
+                                          matrixOut_t jacobian,
+                                          ConfigurationIn_t arg,
+                                          EvaluationContext& context) const;
+      virtual void impl_valueAndJacobianCompressed (LiegroupElement& result,
+                                                    matrixOut_t jacobian,
+                                                    ConfigurationIn_t arg,
+                                                    EvaluationContext& context) const;
     private:
+      typedef GenericTransformationData
+        <IsRelative,ComputePosition,ComputeOrientation> Data_t;
       void computeError (const ConfigurationIn_t& argument) const;
+      /// Get the data stored in the context, with up to date parameters and
+      /// kinematics.
+      const Data_t& contextData (EvaluationContext& context,
+          const ConfigurationIn_t& argument, bool jacobians) const;
+      /// Get the data of the compressed jacobian stored in the context,
+      /// with up to date parameters, kinematics and error.
+      const Data_t& compressedContextData (EvaluationContext& context,
+          const ConfigurationIn_t& argument) const;
+      /// Copy the masked error into the value of the function.
+      void setValue (const Data_t& d, LiegroupElement& result) const;
       void computeActiveParams ();
+      /// Compute the jacobian from its active columns.
+      void uncompressJacobian (const matrix_t& compressed,
+                               matrixOut_t jacobian) const
+      {
+        jacobian.setZero ();
+        activeCols_.lview (jacobian) = compressed;
+      }
       DevicePtr_t robot_;
-      GenericTransformationData<IsRelative,ComputePosition,ComputeOrientation>
-        d_;
+      Data_t d_;
+      /// Data of the jacobian, whose columns are the active columns
+      /// activeCols_. d_ is only used for the values.
+      mutable Data_t dc_;
+      Eigen::ColBlockIndices activeCols_;
       const std::vector <bool> mask_;
+      /// Identifiers of d_ and dc_ in an EvaluationContext.
+      std::size_t dScratch_, dcScratch_;
       WkPtr_t self_;
       mutable Configuration_t latestArgument_;
     }; // class GenericTransformation
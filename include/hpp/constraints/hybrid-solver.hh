@@ -34,8 +34,7 @@ namespace hpp {
     {
       public:
         HybridSolver (const std::size_t& argSize, const std::size_t derSize)
-          : HierarchicalIterativeSolver(argSize, derSize), explicit_ (argSize, derSize),
-          JeExpanded_ (derSize, derSize)
+          : HierarchicalIterativeSolver(argSize, derSize), explicit_ (argSize, derSize)
         {}
 
         virtual ~HybridSolver () {}
@@ -53,60 +52,158 @@ namespace hpp {
         /// Should be called whenever explicit solver is modified
         void explicitSolverHasChanged();
 
+        /// Move the implicit constraints that can be solved in closed form
+        /// to the explicit solver.
+        ///
+        /// The equality constraints of the first level, with a null right
+        /// hand side, on the full relative transformation between a joint
+        /// and a free-flyer joint attached to the world are replaced by an
+        /// ExplicitRelativeTransformation. This removes their rows and the
+        /// variables of the free-flyer from the iterative problem.
+        /// \return the number of constraints moved to the explicit solver.
+        std::size_t promoteToExplicit ();
+
+        /// Solve the system, using the given workspace.
+        /// When the explicit constraints are constant (locked joints), they
+        /// are applied once before the iterations: the step is zero on
+        /// their outputs, so the line searches do not solve them again.
+        /// \sa HierarchicalIterativeSolver::solve
+        template <typename LineSearchType>
+        Status solve (vectorOut_t arg, SolverWorkspace& workspace,
+                      LineSearchType ls = LineSearchType()) const
+        {
+          return impl_solve (arg, workspace, ls);
+        }
+
+        inline Status solve (vectorOut_t arg, SolverWorkspace& workspace) const
+        {
+          return solve(arg, workspace, DefaultLineSearch());
+        }
+
         template <typename LineSearchType>
         Status solve (vectorOut_t arg, LineSearchType ls = LineSearchType()) const
         {
-          // TODO when there are only locked joint explicit constraints,
-          // there is no need for this intricated loop.
-          // if (explicit_.isConstant()) {
-            // explicit_.solve(arg);
-            // iterative_.solve(arg, ls);
-          // } else {
-          return impl_solve (arg, ls);
-          // }
+          return impl_solve (arg, workspace_, ls);
         }
 
         inline Status solve (vectorOut_t arg) const
         {
-          return solve(arg, DefaultLineSearch());
+          return solve(arg, workspace_, DefaultLineSearch());
         }
 
-        bool isSatisfied (vectorIn_t arg) const
+        /// Solve the system for several configurations concurrently.
+        /// \sa HierarchicalIterativeSolver::solveBatch
+        template <typename LineSearchType>
+        void solveBatch (matrixOut_t configs, std::vector<Status>& status,
+                         LineSearchType ls, WorkStealingPool& pool) const
+        {
+          impl_solveBatch (*this, configs, status, ls, pool);
+        }
+
+        template <typename LineSearchType>
+        void solveBatch (matrixOut_t configs, std::vector<Status>& status,
+                         LineSearchType ls = LineSearchType()) const
+        {
+          impl_solveBatch (*this, configs, status, ls,
+                           WorkStealingPool::global ());
+        }
+
+        inline void solveBatch (matrixOut_t configs,
+                                std::vector<Status>& status) const
+        {
+          solveBatch (configs, status, DefaultLineSearch());
+        }
+
+        bool isSatisfied (vectorIn_t arg, SolverWorkspace& workspace) const
         {
           return 
-            HierarchicalIterativeSolver::isSatisfied (arg)
-            && explicit_.isSatisfied (arg);
+            HierarchicalIterativeSolver::isSatisfied (arg, workspace)
+            && explicit_.isSatisfied (arg, workspace.explicitWs);
         }
 
-        bool isSatisfied (vectorIn_t arg, vectorOut_t error) const
+        bool isSatisfied (vectorIn_t arg) const
+        {
+          return isSatisfied (arg, workspace_);
+        }
+
+        bool isSatisfied (vectorIn_t arg, vectorOut_t error,
+                          SolverWorkspace& workspace) const
         {
           assert (error.size() == dimension() + explicit_.outDers().nbIndices());
           bool iterative =
-            HierarchicalIterativeSolver::isSatisfied (arg);
-          residualError(error.head(dimension()));
+            HierarchicalIterativeSolver::isSatisfied (arg, workspace);
+          residualError(error.head(dimension()), workspace);
           bool _explicit =
-            explicit_.isSatisfied (arg, error.tail(explicit_.outDers().nbIndices()));
+            explicit_.isSatisfied (arg, error.tail(explicit_.outDers().nbIndices()),
+                                   workspace.explicitWs);
           return iterative && _explicit;
         }
 
+        bool isSatisfied (vectorIn_t arg, vectorOut_t error) const
+        {
+          return isSatisfied (arg, error, workspace_);
+        }
+
         /// Project the point arg + darg onto the null space of the jacobian
         /// at arg.
-        void projectOnKernel (vectorIn_t arg, vectorIn_t darg, vectorOut_t result) const;
+        /// The projector onto the kernel is kept in the workspace, so that
+        /// the next projections at the same configuration only cost a
+        /// product by a matrix.
+        void projectOnKernel (vectorIn_t arg, vectorIn_t darg, vectorOut_t result,
+                              SolverWorkspace& workspace) const;
+
+        void projectOnKernel (vectorIn_t arg, vectorIn_t darg, vectorOut_t result) const
+        {
+          projectOnKernel (arg, darg, result, workspace_);
+        }
+
+        /// Project each column of dargs onto the null space of the jacobian
+        /// at arg.
+        /// \param dargs, results matrices with derSize rows.
+        /// \sa projectOnKernel (vectorIn_t, vectorIn_t, vectorOut_t, SolverWorkspace&) const
+        void projectOnKernelBatch (vectorIn_t arg, matrixIn_t dargs,
+                                   matrixOut_t results,
+                                   SolverWorkspace& workspace) const;
+
+        void projectOnKernelBatch (vectorIn_t arg, matrixIn_t dargs,
+                                   matrixOut_t results) const
+        {
+          projectOnKernelBatch (arg, dargs, results, workspace_);
+        }
+
+        template <typename LineSearchType>
+        bool oneStep (vectorOut_t arg, LineSearchType& lineSearch,
+                      SolverWorkspace& workspace) const
+        {
+          // A constant explicit system is solved once, as in solve.
+          if (explicit_.isConstant ())
+            explicit_.solve (arg, workspace.explicitWs);
+          computeValue<true> (arg, workspace);
+          updateJacobian (arg, workspace);
+          computeDescentDirection (workspace);
+          // The explicit system is solved by integrateStep.
+          lineSearch (*this, workspace, arg, workspace.dq);
+          return HierarchicalIterativeSolver::isSatisfied(arg, workspace);
+        }
 
         template <typename LineSearchType>
         bool oneStep (vectorOut_t arg, LineSearchType& lineSearch) const
         {
-          computeValue<true> (arg);
-          updateJacobian (arg);
-          computeDescentDirection ();
-          lineSearch (*this, arg, dq_);
-          explicit_.solve (arg);
-          return HierarchicalIterativeSolver::isSatisfied(arg);
+          return oneStep (arg, lineSearch, workspace_);
         }
 
         /// Computes the jacobian of the explicit functions and
         /// updates the jacobian of the problem using the chain rule.
-        void updateJacobian (vectorIn_t arg) const;
+        void updateJacobian (vectorIn_t arg, SolverWorkspace& workspace) const;
+
+        void updateJacobian (vectorIn_t arg) const
+        {
+          updateJacobian (arg, workspace_);
+        }
+
+        /// Allocate a workspace for this solver, including the data of the
+        /// explicit solver.
+        virtual void allocate (SolverWorkspace& workspace) const;
 
         /// Set error threshold
         void errorThreshold (const value_type& threshold)
@@ -208,23 +305,58 @@ namespace hpp {
 
         virtual std::ostream& print (std::ostream& os) const;
 
-        void integrate(vectorIn_t from, vectorIn_t velocity, vectorOut_t result) const
+        using HierarchicalIterativeSolver::integrate;
+
+        void integrate(vectorIn_t from, vectorIn_t velocity, vectorOut_t result,
+                       SolverWorkspace& workspace) const
         {
-          HierarchicalIterativeSolver::integrate(from, velocity, result);
-          explicit_.solve (result);
+          HierarchicalIterativeSolver::integrate(from, velocity, result, workspace);
+          explicit_.solve (result, workspace.explicitWs);
         }
 
       protected:
         void computeActiveRowsOfJ (std::size_t iStack);
 
+        /// The Jacobian of the explicit system couples the reduced
+        /// variables the explicit variables depend on.
+        Eigen::MatrixXi explicitDependencies () const;
+
       private:
         typedef HierarchicalIterativeSolver parent_t;
 
+        /// Integrate a step of a line search of solve or oneStep.
+        /// A constant explicit system is not solved: it is solved before
+        /// the iterations and the step is zero on its outputs.
+        void integrateStep (vectorIn_t from, vectorIn_t velocity,
+                            vectorOut_t result,
+                            SolverWorkspace& workspace) const
+        {
+          if (explicit_.isConstant ())
+            HierarchicalIterativeSolver::integrate(from, velocity, result,
+                                                   workspace);
+          else
+            integrate (from, velocity, result, workspace);
+        }
+
         template <typename LineSearchType>
-        Status impl_solve (vectorOut_t arg, LineSearchType ls) const;
+        Status impl_solve (vectorOut_t arg, SolverWorkspace& workspace,
+                           LineSearchType ls) const;
+
+        /// Compute SolverWorkspace::kernelProjector at arg, unless it is
+        /// up to date.
+        void computeKernelProjector (vectorIn_t arg,
+                                     SolverWorkspace& workspace) const;
 
         ExplicitSolver explicit_;
-        mutable matrix_t Je_, JeExpanded_;
+        /// Columns of the reduced jacobian of the inputs of the explicit
+        /// solver, i.e. of the columns of SolverWorkspace::Je.
+        Eigen::ColBlockIndices explicitInputs_;
+
+        friend struct lineSearch::Constant;
+        friend struct lineSearch::Backtracking;
+        friend struct lineSearch::FixedSequence;
+        friend struct lineSearch::ErrorNormBased;
+        friend struct lineSearch::LevenbergMarquardt;
     }; // class HybridSolver
     /// \}
 
@@ -22,11 +22,16 @@ namespace hpp {
     template <typename LineSearchType>
     inline HybridSolver::Status HybridSolver::impl_solve (
         vectorOut_t arg,
+        SolverWorkspace& ws,
         LineSearchType lineSearch) const
     {
       assert (!arg.hasNaN());
 
-      explicit_.solve(arg);
+      {
+        SolverTelemetry::Timer timer (telemetry_.get (),
+                                      SolverTelemetry::EXPLICIT_SOLVE);
+        explicit_.solve(arg, ws.explicitWs);
+      }
 
       size_type errorDecreased = 3, iter = 0;
       value_type previousSquaredNorm =
@@ -34,53 +39,64 @@ namespace hpp {
       value_type initSquaredNorm = 0;
 
       // Fill value and Jacobian
-      computeValue<true> (arg);
-      computeError();
+      ws.jacobianEvaluations = ws.jacobianUpdates = ws.consecutiveUpdates = 0;
+      computeValue<true> (arg, ws);
+      computeError(ws);
 
-      bool errorWasBelowThr = (squaredNorm_ < squaredErrorThreshold_);
-      vector_t initArg;
+      bool errorWasBelowThr = (ws.squaredNorm < squaredErrorThreshold_);
+      // Iterations skipped when the initial error is below the threshold.
+      size_type skipped = 0;
       if (errorWasBelowThr) {
-        initArg = arg;
-        iter = std::max (maxIterations_,size_type(2)) - 2;
-        initSquaredNorm = squaredNorm_;
+        ws.initArg = arg;
+        iter = skipped = std::max (maxIterations_,size_type(2)) - 2;
+        initSquaredNorm = ws.squaredNorm;
       }
 
-      if (squaredNorm_ > .25 * squaredErrorThreshold_
-          && reducedDimension_ == 0) return INFEASIBLE;
+      if (ws.squaredNorm > .25 * squaredErrorThreshold_
+          && reducedDimension_ == 0)
+        return endResolution (INFEASIBLE, iter - skipped);
 
-      while (squaredNorm_ > .25 * squaredErrorThreshold_ && errorDecreased &&
+      while (ws.squaredNorm > .25 * squaredErrorThreshold_ && errorDecreased &&
 	     iter < maxIterations_) {
 
         // Update the jacobian using the jacobian of the explicit system.
-        updateJacobian(arg);
-        computeSaturation(arg);
-
-        computeDescentDirection ();
-        lineSearch (*this, arg, dq_);
-        explicit_.solve(arg);
+        // A Broyden estimate already takes the explicit system into account.
+        if (ws.exactJacobian) updateJacobian(arg, ws);
+        saveJacobianAndError (ws);
+        computeSaturation(arg, ws);
+
+        computeDescentDirection (ws);
+        {
+          // The explicit system is solved by integrateStep, for each trial
+          // step, so that the accepted step is already explicitly solved.
+          // A constant explicit system was solved above, once for all.
+          SolverTelemetry::Timer timer (telemetry_.get (),
+                                        SolverTelemetry::LINE_SEARCH);
+          lineSearch (*this, ws, arg, ws.dq);
+        }
 
-	computeValue<true> (arg);
-        computeError ();
+        computeValueAndJacobian (arg, ws);
 
 	--errorDecreased;
-	if (squaredNorm_ < previousSquaredNorm) errorDecreased = 3;
-	previousSquaredNorm = squaredNorm_;
+	if (ws.squaredNorm < previousSquaredNorm) errorDecreased = 3;
+	previousSquaredNorm = ws.squaredNorm;
 	++iter;
 
       }
 
       if (errorWasBelowThr) {
-        if (squaredNorm_ > initSquaredNorm) {
-          arg = initArg;
+        if (ws.squaredNorm > initSquaredNorm) {
+          arg = ws.initArg;
         }
-        return SUCCESS;
+        return endResolution (SUCCESS, iter - skipped);
       }
 
-      if (squaredNorm_ > squaredErrorThreshold_) {
-        return (!errorDecreased) ? ERROR_INCREASED : MAX_ITERATION_REACHED;
+      if (ws.squaredNorm > squaredErrorThreshold_) {
+        return endResolution ((!errorDecreased) ?
+            ERROR_INCREASED : MAX_ITERATION_REACHED, iter);
       }
       assert (!arg.hasNaN());
-      return SUCCESS;
+      return endResolution (SUCCESS, iter);
     }
   } // namespace constraints
 } // namespace hpp
@@ -23,20 +23,18 @@ namespace hpp {
   namespace constraints {
     namespace lineSearch {
       template <typename SolverType>
-      inline bool Constant::operator() (const SolverType& solver, vectorOut_t arg, vectorOut_t darg)
+      inline bool Constant::operator() (const SolverType& solver, SolverWorkspace& ws, vectorOut_t arg, vectorOut_t darg)
       {
-        solver.integrate (arg, darg, arg);
+        solver.integrateStep (arg, darg, arg, ws);
         return true;
       }
 
       template <typename SolverType>
-      inline bool Backtracking::operator() (const SolverType& solver, vectorOut_t arg, vectorOut_t u)
+      inline bool Backtracking::operator() (const SolverType& solver, SolverWorkspace& ws, vectorOut_t arg, vectorOut_t u)
       {
-        arg_darg.resize(arg.size());
-
-        const value_type slope = computeLocalSlope(solver);
+        const value_type slope = computeLocalSlope(solver, ws);
         const value_type t = 2 * c * slope;
-        const value_type f_arg_norm2 = solver.residualError();
+        const value_type f_arg_norm2 = ws.squaredNorm;
 
         if (t > 0) {
           hppDout (error, "The descent direction is not valid: " << t/c);
@@ -44,17 +42,17 @@ namespace hpp {
           value_type alpha = 1;
 
           while (alpha > smallAlpha) {
-            darg = alpha * u;
-            solver.integrate (arg, darg, arg_darg);
-            solver.template computeValue<false> (arg_darg);
-            solver.computeError ();
+            ws.darg = alpha * u;
+            solver.integrateStep (arg, ws.darg, ws.arg_darg, ws);
+            solver.template computeValue<false> (ws.arg_darg, ws);
+            solver.computeError (ws);
             // Check if we are doing better than the linear approximation with coef
             // multiplied by c < 1
             // t < 0 must hold
-            const value_type f_arg_darg_norm2 = solver.residualError();
+            const value_type f_arg_darg_norm2 = ws.squaredNorm;
             if (f_arg_norm2 - f_arg_darg_norm2 >= - alpha * t) {
-              arg = arg_darg;
-              u = darg;
+              arg = ws.arg_darg;
+              u = ws.darg;
               return true;
             }
             // Prepare next step
@@ -66,47 +64,109 @@ namespace hpp {
         }
 
         u *= smallAlpha;
-        solver.integrate (arg, darg, arg);
+        solver.integrateStep (arg, ws.darg, arg, ws);
         return false;
       }
 
       template <typename SolverType>
-      inline value_type Backtracking::computeLocalSlope(const SolverType& solver) const
+      inline value_type Backtracking::computeLocalSlope(const SolverType& solver, SolverWorkspace& ws) const
       {
         value_type slope = 0;
         for (std::size_t i = 0; i < solver.stacks_.size (); ++i) {
-          typename SolverType::Data& d = solver.datas_[i];
-          const size_type nrows = d.reducedJ.rows();
-          if (df.size() < nrows) df.resize(nrows);
-          df.head(nrows).noalias() = d.reducedJ * solver.dqSmall_;
-          slope += df.head(nrows).dot(d.activeRowsOfJ.keepRows().rview(d.error).eval());
+          const SolverWorkspace::Level& l = ws.levels[i];
+          const size_type nrows = l.reducedJ.rows();
+          ws.df.head(nrows).noalias() = l.reducedJ * ws.dqSmall;
+          slope += ws.df.head(nrows).dot(l.reducedError);
         }
         return slope;
       }
 
       template <typename SolverType>
-      inline bool FixedSequence::operator() (const SolverType& solver, vectorOut_t arg, vectorOut_t darg)
+      inline bool FixedSequence::operator() (const SolverType& solver, SolverWorkspace& ws, vectorOut_t arg, vectorOut_t darg)
       {
         darg *= alpha;
         alpha = alphaMax - K * (alphaMax - alpha);
-        solver.integrate (arg, darg, arg);
+        solver.integrateStep (arg, darg, arg, ws);
         return true;
       }
 
       template <typename SolverType>
-      inline bool ErrorNormBased::operator() (const SolverType& solver, vectorOut_t arg, vectorOut_t darg)
+      inline bool ErrorNormBased::operator() (const SolverType& solver, SolverWorkspace& ws, vectorOut_t arg, vectorOut_t darg)
       {
-        const value_type r = solver.residualError() / solver.squaredErrorThreshold();
+        const value_type r = ws.squaredNorm / solver.squaredErrorThreshold();
         const value_type alpha = C - K * std::tanh(a * r + b);
         darg *= alpha;
-        solver.integration() (arg, darg, arg);
+        solver.integrateStep (arg, darg, arg, ws);
         return true;
       }
+
+      template <typename SolverType>
+      inline bool LevenbergMarquardt::operator() (const SolverType& solver, SolverWorkspace& ws, vectorOut_t arg, vectorOut_t darg)
+      {
+        const value_type f_arg = squaredError (solver, ws);
+        for (std::size_t i = 0; i < ws.levels.size(); ++i)
+          ws.levels[i].savedError = ws.levels[i].reducedError;
+
+        for (size_type trial = 0; trial < maxTrials; ++trial) {
+          if (trial > 0) {
+            for (std::size_t i = 0; i < ws.levels.size(); ++i)
+              ws.levels[i].reducedError = ws.levels[i].savedError;
+          }
+          solver.computeDampedDescentDirection (lambda, ws);
+
+          // Decrease of the squared error predicted by the linearization
+          value_type f_model = f_arg;
+          const std::size_t end = (solver.lastIsOptional_ ?
+              solver.stacks_.size() - 1 : solver.stacks_.size());
+          for (std::size_t i = 0; i < end; ++i) {
+            const SolverWorkspace::Level& l = ws.levels[i];
+            const size_type nrows = l.reducedJ.rows();
+            ws.df.head(nrows) = l.reducedError;
+            ws.df.head(nrows).noalias() += l.reducedJ * ws.dqSmall;
+            f_model += ws.df.head(nrows).squaredNorm()
+              - l.reducedError.squaredNorm();
+          }
+          const value_type predicted = f_arg - f_model;
+
+          solver.integrateStep (arg, ws.dq, ws.arg_darg, ws);
+          solver.template computeValue<false> (ws.arg_darg, ws);
+          solver.computeError (ws);
+          const value_type actual = f_arg - squaredError (solver, ws);
+
+          if (predicted > 0 && actual > 0) {
+            const value_type rho = actual / predicted,
+                             r = 2 * rho - 1;
+            lambda = std::max (lambdaMin,
+                lambda * std::max (value_type(1)/3, 1 - r * r * r));
+            nu = 2;
+            arg = ws.arg_darg;
+            darg = ws.dq;
+            return true;
+          }
+          lambda = std::min (lambdaMax, nu * lambda);
+          nu *= 2;
+        }
+        hppDout (error, "Could not find a damping which decreases the error");
+        darg.setZero ();
+        return false;
+      }
+
+      template <typename SolverType>
+      inline value_type LevenbergMarquardt::squaredError (const SolverType& solver, const SolverWorkspace& ws) const
+      {
+        const std::size_t end = (solver.lastIsOptional_ ?
+            solver.stacks_.size() - 1 : solver.stacks_.size());
+        value_type res = 0;
+        for (std::size_t i = 0; i < end; ++i)
+          res += ws.levels[i].error.squaredNorm();
+        return res;
+      }
     }
 
     template <typename LineSearchType>
     inline HierarchicalIterativeSolver::Status HierarchicalIterativeSolver::solve (
         vectorOut_t arg,
+        SolverWorkspace& ws,
         LineSearchType lineSearch) const
     {
       hppDout (info, "before projection: " << arg.transpose ());
@@ -117,40 +177,91 @@ namespace hpp {
 	std::numeric_limits<value_type>::infinity();
 
       // Fill value and Jacobian
-      computeValue<true> (arg);
-      computeError();
+      ws.jacobianEvaluations = ws.jacobianUpdates = ws.consecutiveUpdates = 0;
+      computeValue<true> (arg, ws);
+      computeError (ws);
 
-      if (squaredNorm_ > squaredErrorThreshold_
-          && reducedDimension_ == 0) return INFEASIBLE;
+      if (ws.squaredNorm > squaredErrorThreshold_
+          && reducedDimension_ == 0) return endResolution (INFEASIBLE, iter);
 
-      while (squaredNorm_ > squaredErrorThreshold_ && errorDecreased &&
+      while (ws.squaredNorm > squaredErrorThreshold_ && errorDecreased &&
 	     iter < maxIterations_) {
 
-        computeSaturation(arg);
-        computeDescentDirection ();
-        lineSearch (*this, arg, dq_);
+        saveJacobianAndError (ws);
+        computeSaturation(arg, ws);
+        computeDescentDirection (ws);
+        {
+          SolverTelemetry::Timer timer (telemetry_.get (),
+                                        SolverTelemetry::LINE_SEARCH);
+          lineSearch (*this, ws, arg, ws.dq);
+        }
 
-	computeValue<true> (arg);
-        computeError ();
+        computeValueAndJacobian (arg, ws);
 
-	hppDout (info, "squareNorm = " << squaredNorm_);
+	hppDout (info, "squareNorm = " << ws.squaredNorm);
 	--errorDecreased;
-	if (squaredNorm_ < previousSquaredNorm) errorDecreased = 3;
-	previousSquaredNorm = squaredNorm_;
+	if (ws.squaredNorm < previousSquaredNorm) errorDecreased = 3;
+	previousSquaredNorm = ws.squaredNorm;
 	++iter;
 
       }
 
       hppDout (info, "number of iterations: " << iter);
-      if (squaredNorm_ > squaredErrorThreshold_) {
+      if (ws.squaredNorm > squaredErrorThreshold_) {
 	hppDout (info, "Projection failed.");
-        return (!errorDecreased) ? ERROR_INCREASED : MAX_ITERATION_REACHED;
+        return endResolution ((!errorDecreased) ?
+            ERROR_INCREASED : MAX_ITERATION_REACHED, iter);
       }
       hppDout (info, "After projection: " << arg.transpose ());
       assert (!arg.hasNaN());
-      return SUCCESS;
+      return endResolution (SUCCESS, iter);
     }
 
+    namespace internal {
+      template <typename SolverType, typename LineSearchType>
+      struct SolveBatchTask
+      {
+        typedef HierarchicalIterativeSolver::Status Status;
+        typedef boost::shared_ptr<SolverWorkspace> SolverWorkspacePtr_t;
+
+        SolveBatchTask (const SolverType& s, matrixOut_t& c,
+            std::vector<Status>& st, const LineSearchType& l,
+            const std::vector<SolverWorkspacePtr_t>& w)
+          : solver (s), configs (c), status (st), ls (l), workspaces (w)
+        {}
+
+        void operator() (std::size_t i, std::size_t worker) const
+        {
+          status[i] = solver.solve (configs.col(i), *workspaces[worker], ls);
+        }
+
+        const SolverType& solver;
+        matrixOut_t& configs;
+        std::vector<Status>& status;
+        const LineSearchType& ls;
+        const std::vector<SolverWorkspacePtr_t>& workspaces;
+      };
+    } // namespace internal
+
+    template <typename SolverType, typename LineSearchType>
+    inline void HierarchicalIterativeSolver::impl_solveBatch (
+        const SolverType& solver,
+        matrixOut_t configs,
+        std::vector<Status>& status,
+        const LineSearchType& ls,
+        WorkStealingPool& pool)
+    {
+      typedef internal::SolveBatchTask<SolverType, LineSearchType> Task;
+      assert (configs.rows() == solver.argSize_);
+
+      status.resize (configs.cols());
+      std::vector<typename Task::SolverWorkspacePtr_t> workspaces (pool.size());
+      for (std::size_t i = 0; i < workspaces.size(); ++i)
+        workspaces[i].reset (new SolverWorkspace (solver));
+
+      pool.run (configs.cols(),
+                Task (solver, configs, status, ls, workspaces));
+    }
   } // namespace constraints
 } // namespace hpp
 
@@ -23,20 +23,28 @@
 
 #include <hpp/constraints/fwd.hh>
 #include <hpp/constraints/config.hh>
+#include <hpp/constraints/decomposition.hh>
 
 #include <hpp/constraints/matrix-view.hh>
 #include <hpp/constraints/differentiable-function-stack.hh>
+#include <hpp/constraints/explicit-solver.hh>
+#include <hpp/constraints/work-stealing-pool.hh>
+#include <hpp/constraints/solver-telemetry.hh>
 
 namespace hpp {
   namespace constraints {
 
     /// \addtogroup solvers
     /// \{
+    /// A line search is a functor updating arg along the descent direction
+    /// darg. The new value of arg must be computed by
+    /// SolverType::integrateStep, so that HybridSolver does not need to
+    /// solve the explicit system again afterwards.
     namespace lineSearch {
       /// No line search. Use \f$\alpha \gets 1\f$
       struct Constant {
         template <typename SolverType>
-        bool operator() (const SolverType& solver, vectorOut_t arg, vectorOut_t darg);
+        bool operator() (const SolverType& solver, SolverWorkspace& ws, vectorOut_t arg, vectorOut_t darg);
       };
 
       /// Implements the backtracking line search algorithm.
@@ -45,13 +53,12 @@ namespace hpp {
         Backtracking ();
 
         template <typename SolverType>
-        bool operator() (const SolverType& solver, vectorOut_t arg, vectorOut_t darg);
+        bool operator() (const SolverType& solver, SolverWorkspace& ws, vectorOut_t arg, vectorOut_t darg);
 
         template <typename SolverType>
-        inline value_type computeLocalSlope(const SolverType& solver) const;
+        inline value_type computeLocalSlope(const SolverType& solver, SolverWorkspace& ws) const;
 
         value_type c, tau, smallAlpha; // 0.8 ^ 7 = 0.209, 0.8 ^ 8 = 0.1677
-        mutable vector_t arg_darg, df, darg;
       };
 
       /// The step size is computed using the recursion:
@@ -60,7 +67,7 @@ namespace hpp {
         FixedSequence();
 
         template <typename SolverType>
-        bool operator() (const SolverType& solver, vectorOut_t arg, vectorOut_t darg);
+        bool operator() (const SolverType& solver, SolverWorkspace& ws, vectorOut_t arg, vectorOut_t darg);
 
         value_type alpha;
         value_type alphaMax, K;
@@ -73,17 +80,209 @@ namespace hpp {
         ErrorNormBased(value_type alphaMin = 0.2);
 
         template <typename SolverType>
-        bool operator() (const SolverType& solver, vectorOut_t arg, vectorOut_t darg);
+        bool operator() (const SolverType& solver, SolverWorkspace& ws, vectorOut_t arg, vectorOut_t darg);
 
         value_type C, K, a, b;
       };
+
+      /// Levenberg-Marquardt step.
+      ///
+      /// The descent direction of each level is replaced by the solution of
+      /// the damped least squares problem
+      /// \f$ \min_{dq} \| e + J dq \|^2 + \lambda \| dq \|^2 \f$,
+      /// restricted to the kernel of the upper levels. The step is accepted
+      /// if the error decreases. The damping \f$ \lambda \f$ is adapted
+      /// from the ratio \f$ \rho \f$ between the actual and the predicted
+      /// decrease of the squared error:
+      /// \li if \f$ \rho > 0 \f$, \f$ \lambda \gets \lambda \times
+      ///     \max (1/3, 1 - (2\rho-1)^3) \f$,
+      /// \li otherwise, \f$ \lambda \gets \nu \lambda \f$ and
+      ///     \f$ \nu \gets 2 \nu \f$, and the step is computed again.
+      ///
+      /// The damping is kept between two successive iterations of a
+      /// resolution.
+      struct LevenbergMarquardt {
+        LevenbergMarquardt (value_type lambda0 = 1e-3);
+
+        template <typename SolverType>
+        bool operator() (const SolverType& solver, SolverWorkspace& ws, vectorOut_t arg, vectorOut_t darg);
+
+        /// Sum of the squared errors of the levels which are not optional.
+        template <typename SolverType>
+        inline value_type squaredError (const SolverType& solver, const SolverWorkspace& ws) const;
+
+        value_type lambda, nu;
+        value_type lambdaMin, lambdaMax;
+        /// Maximal number of steps computed by one call
+        size_type maxTrials;
+      };
     }
 
+    /// Data modified during the resolution of a HierarchicalIterativeSolver.
+    ///
+    /// A configured solver can be shared by several threads, each of them
+    /// owning a SolverWorkspace. Once allocated, the workspace holds all the
+    /// buffers of the resolution so that the iterations do not allocate
+    /// memory.
+    /// \warning the workspace must be reallocated
+    ///          (see HierarchicalIterativeSolver::allocate) whenever the
+    ///          solver is modified.
+    class HPP_CONSTRAINTS_DLLAPI SolverWorkspace
+    {
+      public:
+        typedef Eigen::JacobiSVD <matrix_t> SVD_t;
+
+        /// Values, jacobians and decomposition of one level
+        struct Level {
+          /// \cond
+          EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+          /// \endcond
+          LiegroupElement output;
+          /// Values of each function of the level, when they are evaluated
+          /// together with their jacobian.
+          std::vector<LiegroupElement> functionOutputs;
+          vector_t error;
+          /// Compressed jacobians of the functions of the level. The rows
+          /// are those of the level, the columns are the active columns of
+          /// each function.
+          /// \sa DifferentiableFunction::jacobianCompressed
+          matrix_t compressedJ;
+          matrix_t reducedJ;
+          /// Active rows of error
+          vector_t reducedError;
+
+          Decomposition decomposition;
+
+          size_type maxRank;
+
+          /// \name Buffers of the computation of the descent direction
+          /// \{
+          /// Reduced jacobian multiplied by the transformations
+          /// Decomposition::applyKernelQOnTheRight of the upper levels.
+          matrix_t transformedJ;
+          /// Reduced jacobian multiplied by the basis of the common kernel
+          /// of the upper levels, i.e. the last columns of transformedJ.
+          matrix_t projectedJ;
+          vector_t residual;
+          /// Jacobian with respect to the output of the explicit solver
+          matrix_t explicitJ;
+          /// \}
+
+          /// \name Data of lineSearch::LevenbergMarquardt
+          /// \{
+          /// Copy of reducedError at the beginning of the line search.
+          vector_t savedError;
+          /// \f$ J J^T + \lambda I \f$ and its decomposition, where J is
+          /// projectedJ.
+          matrix_t dampedJJt;
+          Eigen::LLT<matrix_t> dampedLLT;
+          /// \}
+
+          /// \name Data of the Jacobian reuse
+          /// \{
+          /// Estimate of reducedJ, updated by Broyden corrections.
+          matrix_t approxJ;
+          /// reducedError at the beginning of the iteration.
+          vector_t previousError;
+          /// \}
+        };
+
+        /// Data of one independent block of the reduced problem.
+        /// \sa HierarchicalIterativeSolver::blockDecomposition
+        struct Block {
+          /// The levels having rows in the block, restricted to the block.
+          /// Only the buffers of the descent direction are used.
+          std::vector<Level> levels;
+          /// Descent direction restricted to the columns of the block
+          vector_t dqSmall, tmpDqSmall;
+          /// The smallest non-zero singular value of the block
+          value_type sigma;
+          /// Number of levels of the block taken into account in the last
+          /// computation of the descent direction.
+          std::size_t solvedLevels;
+        };
+
+        SolverWorkspace () : squaredNorm (0), sigma (0), solvedLevels (0),
+        kernelVersion (0), jacobianEvaluations (0), jacobianUpdates (0), exactJacobian (true),
+        consecutiveUpdates (0), previousSquaredNorm (0)
+        {}
+
+        /// Allocate a workspace for solver.
+        ///
+        /// The workspace owns an EvaluationContext so that the functions are
+        /// evaluated without modifying the robot state.
+        explicit SolverWorkspace (const HierarchicalIterativeSolver& solver);
+
+        std::vector<Level> levels;
+        /// Squared norm of the error
+        value_type squaredNorm;
+        /// The smallest non-zero singular value
+        value_type sigma;
+        /// Number of levels taken into account in the last computation of
+        /// the descent direction.
+        std::size_t solvedLevels;
+
+        vector_t dq, dqSmall, tmpDqSmall;
+        matrix_t reducedJ;
+        Eigen::VectorXi saturation, reducedSaturation;
+        ArrayXb tmpSat;
+        /// Decomposition of the whole reduced Jacobian
+        Decomposition decomposition;
+        /// Independent blocks, empty if the problem is not decomposed.
+        std::vector<Block> blocks;
+
+        /// \name Data of the line searches
+        /// \{
+        vector_t arg_darg, darg, df;
+        /// \}
+
+        /// If not NULL, the functions are evaluated in this context.
+        /// \sa DifferentiableFunction::value (LiegroupElement&, vectorIn_t, EvaluationContext&) const
+        EvaluationContextPtr_t context;
+
+        /// \name Data of the explicit part of a HybridSolver
+        /// \{
+        /// Compact jacobian of the explicit solver.
+        /// \sa ExplicitSolver::compactJacobian
+        matrix_t Je;
+        ExplicitSolver::Workspace explicitWs;
+        vector_t initArg;
+        /// \}
+
+        /// \name Kernel projector of HybridSolver::projectOnKernel
+        /// \{
+        /// Projector onto the kernel of the reduced jacobian at kernelArg.
+        matrix_t kernelProjector;
+        /// Configuration of kernelProjector, empty if it is not computed.
+        vector_t kernelArg;
+        /// Version of the solver when kernelProjector was computed.
+        std::size_t kernelVersion;
+        /// Reduced velocities projected by the batch projectOnKernel.
+        matrix_t kernelIn, kernelOut;
+        /// \}
+
+        /// \name Jacobian reuse
+        /// \sa HierarchicalIterativeSolver::maxJacobianReuse
+        /// \{
+        /// Number of evaluations of the Jacobians during the last resolution.
+        size_type jacobianEvaluations;
+        /// Number of Broyden updates during the last resolution, i.e. the
+        /// number of evaluations of the Jacobians which were saved.
+        size_type jacobianUpdates;
+        /// Whether reducedJ of the levels comes from an evaluation of the
+        /// Jacobians.
+        bool exactJacobian;
+        size_type consecutiveUpdates;
+        value_type previousSquaredNorm;
+        /// \}
+    }; // class SolverWorkspace
+
     class HPP_CONSTRAINTS_DLLAPI HierarchicalIterativeSolver
     {
       public:
         typedef Eigen::ColBlockIndices Reduction_t;
         typedef lineSearch::FixedSequence DefaultLineSearch;
+        typedef SolverWorkspace::SVD_t SVD_t;
 
         enum Status {
           ERROR_INCREASED,
@@ -148,19 +347,68 @@ namespace hpp {
         /// \name Problem resolution
         /// \{
 
+        /// Solve the system, using the given workspace.
+        ///
+        /// The solver itself is not modified so this function can be called
+        /// concurrently on the same solver, provided that each thread uses
+        /// its own workspace and that the functions are reentrant.
         template <typename LineSearchType>
-        Status solve (vectorOut_t arg, LineSearchType ls = LineSearchType()) const;
+        Status solve (vectorOut_t arg, SolverWorkspace& workspace,
+                      LineSearchType ls = LineSearchType()) const;
+
+        inline Status solve (vectorOut_t arg, SolverWorkspace& workspace) const
+        {
+          return solve (arg, workspace, DefaultLineSearch());
+        }
+
+        /// Solve the system, using the workspace owned by the solver.
+        template <typename LineSearchType>
+        inline Status solve (vectorOut_t arg, LineSearchType ls = LineSearchType()) const
+        {
+          return solve (arg, workspace_, ls);
+        }
 
         inline Status solve (vectorOut_t arg) const
         {
-          return solve (arg, DefaultLineSearch());
+          return solve (arg, workspace_, DefaultLineSearch());
+        }
+
+        /// Solve the system for several configurations concurrently.
+        ///
+        /// \param configs the configurations, one per column, modified in
+        ///        place,
+        /// \retval status the status of the resolution of each column,
+        /// \param ls the line search, copied for each configuration,
+        /// \param pool the threads to use. Each thread owns a SolverWorkspace
+        ///        allocated by this function.
+        template <typename LineSearchType>
+        void solveBatch (matrixOut_t configs, std::vector<Status>& status,
+                         LineSearchType ls, WorkStealingPool& pool) const
+        {
+          impl_solveBatch (*this, configs, status, ls, pool);
+        }
+
+        /// Solve the system for several configurations concurrently, using
+        /// WorkStealingPool::global.
+        template <typename LineSearchType>
+        void solveBatch (matrixOut_t configs, std::vector<Status>& status,
+                         LineSearchType ls = LineSearchType()) const
+        {
+          impl_solveBatch (*this, configs, status, ls,
+                           WorkStealingPool::global ());
         }
 
+        inline void solveBatch (matrixOut_t configs,
+                                std::vector<Status>& status) const
+        {
+          solveBatch (configs, status, DefaultLineSearch());
+        }
+
+        bool isSatisfied (vectorIn_t arg, SolverWorkspace& workspace) const;
+
         bool isSatisfied (vectorIn_t arg) const
         {
-          computeValue<false>(arg);
-          computeError();
-          return squaredNorm_ < squaredErrorThreshold_;
+          return isSatisfied (arg, workspace_);
         }
 
         /// Returns the lowest singular value.
@@ -169,7 +417,7 @@ namespace hpp {
         /// singular.
         const value_type& sigma () const
         {
-          return sigma_;
+          return workspace_.sigma;
         }
 
         /// \}
@@ -246,6 +494,128 @@ namespace hpp {
           return lastIsOptional_;
         }
 
+        /// Set the decomposition used to compute the descent direction.
+        /// \warning the workspaces other than the one owned by the solver
+        ///          must be reallocated.
+        void decomposition (Decomposition::Type type)
+        {
+          decompositionType_ = type;
+          allocate (workspace_);
+        }
+
+        /// Get the decomposition used to compute the descent direction.
+        Decomposition::Type decomposition () const
+        {
+          return decompositionType_;
+        }
+
+        /// Set the damping of Decomposition::DAMPED_LLT.
+        void decompositionDamping (const value_type& damping)
+        {
+          decompositionDamping_ = damping;
+          allocate (workspace_);
+        }
+
+        /// Get the damping of Decomposition::DAMPED_LLT.
+        value_type decompositionDamping () const
+        {
+          return decompositionDamping_;
+        }
+
+        /// Set the maximal number of consecutive iterations which reuse the
+        /// Jacobians.
+        ///
+        /// When it is not zero, the Jacobians are not evaluated after an
+        /// iteration which decreased the squared error by a factor smaller
+        /// than jacobianReuseRatio. They are instead updated with the rank
+        /// one correction of Broyden, using the step and the variation of the
+        /// error. The Jacobians are evaluated after \c iterations consecutive
+        /// updates. The default, 0, always evaluates the Jacobians.
+        /// \sa SolverWorkspace::jacobianUpdates
+        void maxJacobianReuse (size_type iterations)
+        {
+          maxJacobianReuse_ = iterations;
+        }
+
+        /// Get the maximal number of consecutive iterations which reuse the
+        /// Jacobians.
+        size_type maxJacobianReuse () const
+        {
+          return maxJacobianReuse_;
+        }
+
+        /// Set the ratio between the squared errors after and before an
+        /// iteration above which the Jacobians are evaluated.
+        void jacobianReuseRatio (const value_type& ratio)
+        {
+          jacobianReuseRatio_ = ratio;
+        }
+
+        /// Get the ratio between the squared errors after and before an
+        /// iteration above which the Jacobians are evaluated.
+        value_type jacobianReuseRatio () const
+        {
+          return jacobianReuseRatio_;
+        }
+
+        /// Enable the decomposition of the problem into independent blocks.
+        ///
+        /// The functions with active rows and the reduced variables they
+        /// depend on form a graph. When this graph has several connected
+        /// components, the descent direction of each of them is computed
+        /// independently, which is cheaper than the decomposition of the
+        /// whole reduced Jacobian. The decomposition is enabled by default.
+        /// The right hand side is kept.
+        /// \warning the workspaces other than the one owned by the solver
+        ///          must be reallocated.
+        void blockDecomposition (bool enable)
+        {
+          blockDecomposition_ = enable;
+          computeBlocks ();
+          ++version_;
+          allocate (workspace_);
+        }
+
+        /// Whether the problem is decomposed into independent blocks.
+        bool blockDecomposition () const
+        {
+          return blockDecomposition_;
+        }
+
+        /// Number of independent blocks, 0 if the problem is not decomposed.
+        std::size_t numberBlocks () const
+        {
+          return blocks_.size ();
+        }
+
+        /// Set the threads computing the descent directions of the blocks.
+        /// The blocks are solved sequentially if the pool is NULL, which is
+        /// the default.
+        void blockPool (WorkStealingPool* pool)
+        {
+          blockPool_ = pool;
+        }
+
+        /// Get the threads computing the descent directions of the blocks.
+        WorkStealingPool* blockPool () const
+        {
+          return blockPool_;
+        }
+
+        /// Set the telemetry which records the resolutions.
+        /// The resolutions are not measured when it is NULL, which is the
+        /// default. The same telemetry may be shared by several solvers.
+        void telemetry (const SolverTelemetryPtr_t& telemetry)
+        {
+          telemetry_ = telemetry;
+        }
+
+        /// Get the telemetry which records the resolutions.
+        const SolverTelemetryPtr_t& telemetry () const
+        {
+          return telemetry_;
+        }
+
         /// \}
 
         /// \name Stack
@@ -285,11 +655,34 @@ namespace hpp {
         /// Returns the squared norm of the error vector
         value_type residualError() const
         {
-          return squaredNorm_;
+          return workspace_.squaredNorm;
         }
 
         /// Returns the error vector
-        void residualError(vectorOut_t error) const;
+        void residualError(vectorOut_t error) const
+        {
+          residualError (error, workspace_);
+        }
+
+        /// Returns the error vector stored in a workspace
+        void residualError(vectorOut_t error, const SolverWorkspace& workspace) const;
+
+        /// \name Workspace
+        /// \{
+
+        /// Allocate a workspace for this solver.
+        ///
+        /// A workspace must be reallocated whenever the solver is modified.
+        virtual void allocate (SolverWorkspace& workspace) const;
+
+        /// Access the workspace used by the functions which do not take a
+        /// workspace as argument.
+        SolverWorkspace& workspace () const
+        {
+          return workspace_;
+        }
+
+        /// \}
 
         /// \name Right hand side accessors
         /// \{
@@ -319,21 +712,48 @@ namespace hpp {
         /// \{
 
         /// Compute the value of each level, and the jacobian if ComputeJac is true.
-        template <bool ComputeJac> void computeValue (vectorIn_t arg) const;
-        void computeSaturation (vectorIn_t arg) const;
-        void getValue (vectorOut_t v) const;
-        void getReducedJacobian (matrixOut_t J) const;
+        template <bool ComputeJac> void computeValue (vectorIn_t arg, SolverWorkspace& ws) const;
+        void computeSaturation (vectorIn_t arg, SolverWorkspace& ws) const;
+        void getValue (vectorOut_t v, const SolverWorkspace& ws) const;
+        void getReducedJacobian (matrixOut_t J, const SolverWorkspace& ws) const;
         /// If lastIsOptional() is true, then the last level is ignored.
         /// \warning computeValue must have been called first.
-        void computeError () const;
+        void computeError (SolverWorkspace& ws) const;
+
+        template <bool ComputeJac> void computeValue (vectorIn_t arg) const
+        {
+          computeValue<ComputeJac> (arg, workspace_);
+        }
+        void computeSaturation (vectorIn_t arg) const
+        {
+          computeSaturation (arg, workspace_);
+        }
+        void getValue (vectorOut_t v) const
+        {
+          getValue (v, workspace_);
+        }
+        void getReducedJacobian (matrixOut_t J) const
+        {
+          getReducedJacobian (J, workspace_);
+        }
+        void computeError () const
+        {
+          computeError (workspace_);
+        }
 
         /// Accessor to the last step done
         const vector_t& lastStep () const
         {
-          return dq_;
+          return workspace_.dq;
         }
 
-        virtual void integrate(vectorIn_t from, vectorIn_t velocity, vectorOut_t result) const
+        void integrate(vectorIn_t from, vectorIn_t velocity, vectorOut_t result) const
+        {
+          integrate (from, velocity, result, workspace_);
+        }
+
+        virtual void integrate(vectorIn_t from, vectorIn_t velocity, vectorOut_t result,
+                               SolverWorkspace&) const
         {
           integrate_ (from, velocity, result);
         }
@@ -343,25 +763,54 @@ namespace hpp {
         virtual std::ostream& print (std::ostream& os) const;
 
       protected:
-        typedef Eigen::JacobiSVD <matrix_t> SVD_t;
-
+        /// Description of a level. The data which change during the
+        /// resolution are stored in SolverWorkspace::Level.
         struct Data {
           /// \cond
           EIGEN_MAKE_ALIGNED_OPERATOR_NEW
           /// \endcond
-          LiegroupElement output, rightHandSide;
-          vector_t error;
-          matrix_t jacobian, reducedJ;
-
-          SVD_t svd;
-          matrix_t PK;
-
-          mutable size_type maxRank;
+          LiegroupElement rightHandSide;
 
           ComparisonTypes_t comparison;
           std::vector<std::size_t> inequalityIndices;
           Eigen::RowBlockIndices equalityIndices;
           Eigen::MatrixBlocks<false,false> activeRowsOfJ;
+          /// Compiled rows of activeRowsOfJ
+          Eigen::IndexPlan activeRows;
+          /// Rows of the inequalities among the active rows, i.e. in
+          /// SolverWorkspace::Level::reducedJ.
+          std::vector<size_type> activeInequalityRows;
+
+          /// Copy of columns from a compressed jacobian.
+          struct ColumnCopy {
+            size_type from, to, size;
+          };
+          typedef std::vector<ColumnCopy> ColumnCopies_t;
+          /// Compressed jacobian of a function with active rows.
+          struct CompressedJacobian {
+            /// Index of the function in the stack
+            std::size_t function;
+            /// First row of the function in the level and in the active rows.
+            size_type row, activeRow;
+            size_type rows, cols;
+            /// Copies to SolverWorkspace::Level::reducedJ and to
+            /// SolverWorkspace::Level::explicitJ.
+            ColumnCopies_t toReducedJ, toExplicitJ;
+          };
+          std::vector<CompressedJacobian> compressedJacobians;
+          /// Maximal number of columns of the compressed jacobians.
+          size_type compressedCols;
+        };
+
+        /// Independent block of the reduced problem.
+        struct Block {
+          /// Columns of the block in the reduced space
+          Eigen::RowBlockIndices cols;
+          /// Levels having active rows in the block
+          std::vector<std::size_t> levels;
+          /// Active rows and columns of the block in
+          /// SolverWorkspace::Level::reducedJ, for each of these levels.
+          std::vector<Eigen::MatrixBlocks<false,false> > jacobians;
         };
 
         /// Allocate datas and update sizes of the problem
@@ -373,6 +822,39 @@ namespace hpp {
         /// The result is stored in datas_[i].activeRowsOfJ
         virtual void computeActiveRowsOfJ (std::size_t iStack);
 
+        /// Compute where the columns of the compressed jacobians of the
+        /// functions with active rows are copied.
+        /// \param explicitCols the columns of
+        ///        SolverWorkspace::Level::explicitJ, empty if there is no
+        ///        explicit system.
+        /// \warning the active rows must have been computed.
+        void computeCompressedJacobians (std::size_t iStack,
+                                         const segments_t& explicitCols);
+
+        /// Remove a function from the levels.
+        ///
+        /// The comparison types and the right hand side of the other
+        /// functions are kept.
+        /// \return whether the function was found.
+        bool remove (const DifferentiableFunctionPtr_t& f);
+
+        /// Compute the independent blocks of the reduced problem.
+        /// \warning the compressed jacobians must have been computed.
+        void computeBlocks ();
+
+        /// Reduced variables the explicit variables depend on.
+        /// \return a matrix whose rows correspond to the columns of
+        ///         SolverWorkspace::Level::explicitJ and whose columns
+        ///         correspond to the reduced variables, empty if there is
+        ///         no explicit system.
+        virtual Eigen::MatrixXi explicitDependencies () const
+        {
+          return Eigen::MatrixXi ();
+        }
+
+        /// Compute the descent direction of a block.
+        void solveBlock (std::size_t block, SolverWorkspace& ws) const;
+
         /// Compute a SVD decomposition of each level and find the best descent
         /// direction at the first order.
         /// Linearization of the system of equations
@@ -380,9 +862,50 @@ namespace hpp {
         /// q_{i+1} - q_{i} = J(q_i)^{+} ( rhs - v_{i} )
         /// dq = J(q_i)^{+} ( rhs - v_{i} )
         /// \warning computeValue<true> must have been called first.
-        void computeDescentDirection () const;
-        void expandDqSmall () const;
-        void saturate (vectorOut_t arg) const;
+        void computeDescentDirection (SolverWorkspace& ws) const;
+        /// Compute the solution of the damped least squares problem of each
+        /// level, in the kernel of the upper levels.
+        /// \warning computeDescentDirection must have been called first.
+        /// \sa lineSearch::LevenbergMarquardt
+        void computeDampedDescentDirection (const value_type& lambda,
+                                            SolverWorkspace& ws) const;
+        void expandDqSmall (SolverWorkspace& ws) const;
+        /// Multiply v by the basis of the common kernel of the levels
+        /// above level. The input is v.tail(n) where n is the dimension of
+        /// the kernel. The other coefficients must be zero.
+        void multiplyByKernelBasis (std::size_t level, vectorOut_t v,
+                                    const SolverWorkspace& ws) const;
+
+        /// Store the Jacobians and the errors before the line search, if the
+        /// Jacobians may be reused.
+        void saveJacobianAndError (SolverWorkspace& ws) const;
+        /// Compute the values and the error after a step ws.dq.
+        /// The Jacobians are either evaluated or updated with a Broyden
+        /// correction.
+        /// \sa maxJacobianReuse
+        void computeValueAndJacobian (vectorIn_t arg, SolverWorkspace& ws) const;
+        /// Evaluate the Jacobians at arg, where the values were computed
+        /// by computeValue<false>.
+        void computeJacobian (vectorIn_t arg, SolverWorkspace& ws) const;
+        /// Copy the compressed jacobians of a level to
+        /// SolverWorkspace::Level::reducedJ and
+        /// SolverWorkspace::Level::explicitJ.
+        void copyCompressedJacobians (std::size_t iStack,
+                                      SolverWorkspace& ws) const;
+        /// Record the end of a resolution in the telemetry, if any.
+        /// \return status
+        Status endResolution (Status status, size_type iterations) const
+        {
+          if (telemetry_) telemetry_->addResolution (status, iterations);
+          return status;
+        }
+
+        /// Call solver.solve on each column of configs, in the threads of
+        /// pool.
+        template <typename SolverType, typename LineSearchType>
+        static void impl_solveBatch (const SolverType& solver,
+            matrixOut_t configs, std::vector<Status>& status,
+            const LineSearchType& ls, WorkStealingPool& pool);
 
 
         value_type squaredErrorThreshold_, inequalityThreshold_;
@@ -392,23 +915,44 @@ namespace hpp {
         size_type argSize_, derSize_;
         size_type dimension_, reducedDimension_;
         bool lastIsOptional_;
+        Decomposition::Type decompositionType_;
+        value_type decompositionDamping_;
+        size_type maxJacobianReuse_;
+        value_type jacobianReuseRatio_;
+        bool blockDecomposition_;
+        WorkStealingPool* blockPool_;
+        SolverTelemetryPtr_t telemetry_;
         Reduction_t reduction_;
+        /// Compiled columns of reduction_, computed by update.
+        Eigen::IndexPlan reductionPlan_;
         Integration_t integrate_;
         Saturation_t saturate_;
-        /// The smallest non-zero singular value
-        mutable value_type sigma_;
 
-        mutable vector_t dq_, dqSmall_;
-        mutable matrix_t projector_, reducedJ_;
-        mutable Eigen::VectorXi saturation_, reducedSaturation_;
-        mutable ArrayXb tmpSat_;
-        mutable value_type squaredNorm_;
-        mutable std::vector<Data> datas_;
-        mutable SVD_t svd_;
+        std::vector<Data> datas_;
+        /// Independent blocks, empty if the problem is not decomposed.
+        std::vector<Block> blocks_;
+        /// Incremented whenever the functions or the right hand side are
+        /// modified.
+        std::size_t version_;
+        /// Workspace used by the functions which do not take a workspace
+        /// as argument.
+        mutable SolverWorkspace workspace_;
 
         mutable ::hpp::statistics::SuccessStatistics statistics_;
 
+        /// Integrate a step of a line search.
+        void integrateStep (vectorIn_t from, vectorIn_t velocity,
+                            vectorOut_t result,
+                            SolverWorkspace& workspace) const
+        {
+          integrate (from, velocity, result, workspace);
+        }
+
+        friend struct lineSearch::Constant;
         friend struct lineSearch::Backtracking;
+        friend struct lineSearch::FixedSequence;
+        friend struct lineSearch::ErrorNormBased;
+        friend struct lineSearch::LevenbergMarquardt;
     }; // class IterativeSolver
     /// \}
   } // namespace constraints
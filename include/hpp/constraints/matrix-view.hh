@@ -19,6 +19,7 @@
 
 #include <Eigen/Core>
 #include <vector>
+#include <map>
 #include <iostream>
 #include <hpp/util/indent.hh>
 #include <hpp/constraints/fwd.hh>
@@ -107,6 +108,169 @@ namespace Eigen {
                                size_type cardinal);
   }; // struct BlockIndex
 
+  /// Set of integer intervals.
+  ///
+  /// The intervals are kept disjoint, non adjacent and sorted in a
+  /// balanced tree, so that inserting or erasing a segment is logarithmic
+  /// in the number of intervals, plus the number of intervals merged or
+  /// split. Use it instead of repeated BlockIndex::add and
+  /// BlockIndex::shrink when a set of indices is built incrementally.
+  class IntervalSet {
+    public:
+      typedef BlockIndex::size_type size_type;
+      typedef BlockIndex::segment_t segment_t;
+      typedef BlockIndex::segments_t segments_t;
+
+      /// Empty set
+      IntervalSet () : cardinal_ (0) {}
+
+      /// Union of segments
+      /// \param segments a vector of segments, not necessarily sorted.
+      explicit IntervalSet (const segments_t& segments);
+
+      /// Add the indices of a segment.
+      void insert (const segment_t& segment);
+
+      /// Add the indices of a vector of segments.
+      void insert (const segments_t& segments);
+
+      /// Remove the indices of a segment.
+      void erase (const segment_t& segment);
+
+      /// Whether index i belongs to the set.
+      bool contains (size_type i) const;
+
+      /// Number of indices
+      size_type cardinal () const
+      {
+        return cardinal_;
+      }
+
+      /// Number of intervals
+      std::size_t size () const
+      {
+        return intervals_.size ();
+      }
+
+      bool empty () const
+      {
+        return intervals_.empty ();
+      }
+
+      void clear ()
+      {
+        intervals_.clear ();
+        cardinal_ = 0;
+      }
+
+      /// Sorted vector of non overlapping and non adjacent segments.
+      segments_t segments () const;
+
+      /// Compute the union of two vectors of segments in linear time.
+      /// \note assumes a and b are sorted
+      /// \return sorted vector of non overlapping segments.
+      static segments_t unite (const segments_t& a, const segments_t& b);
+
+    private:
+      /// Map from the first index of each interval to the index following
+      /// its last index.
+      typedef std::map<size_type, size_type> Intervals_t;
+      Intervals_t intervals_;
+      size_type cardinal_;
+  }; // class IntervalSet
+
+  /// Flattened plan of the copy of the indices of a vector of segments.
+  ///
+  /// Adjacent segments are merged. The runs of at least \ref longRun
+  /// indices are copied as blocks, which Eigen vectorizes. The indices of
+  /// the shorter runs are stored in a flat table and copied one by one,
+  /// without the cost of building a block expression per segment. This is
+  /// faster when there are many short segments, as for locked joints
+  /// interleaved with free joints.
+  ///
+  /// \sa MatrixBlocksBase::compile
+  struct IndexPlan {
+    typedef BlockIndex::size_type size_type;
+
+    /// Minimal number of indices of the runs copied as blocks
+    static const size_type longRun = 8;
+
+    /// Run of consecutive indices
+    struct Run {
+      /// First index in the full vector and in the selection
+      size_type in, out;
+      size_type size;
+    };
+
+    /// Empty plan
+    IndexPlan () : size (0) {}
+
+    /// Plan of the selection of segments, in the order of the segments.
+    explicit IndexPlan (const BlockIndex::segments_t& segments);
+
+    /// dst = selection of the coefficients of vector src
+    template <typename Src, typename Dst>
+    void gather (const MatrixBase<Src>& src, const MatrixBase<Dst>& dst) const
+    {
+      Dst& d = const_cast<MatrixBase<Dst>&> (dst).derived ();
+      assert (d.size () == size);
+      for (std::size_t k = 0; k < runs.size (); ++k)
+        d.segment (runs[k].out, runs[k].size) =
+          src.segment (runs[k].in, runs[k].size);
+      for (std::size_t k = 0; k < in.size (); ++k)
+        d.coeffRef (out[k]) = src.coeff (in[k]);
+    }
+
+    /// Selection of the coefficients of vector dst = src
+    template <typename Src, typename Dst>
+    void scatter (const MatrixBase<Src>& src, const MatrixBase<Dst>& dst) const
+    {
+      Dst& d = const_cast<MatrixBase<Dst>&> (dst).derived ();
+      assert (src.size () == size);
+      for (std::size_t k = 0; k < runs.size (); ++k)
+        d.segment (runs[k].in, runs[k].size) =
+          src.segment (runs[k].out, runs[k].size);
+      for (std::size_t k = 0; k < in.size (); ++k)
+        d.coeffRef (in[k]) = src.coeff (out[k]);
+    }
+
+    /// dst = selection of the columns of src
+    template <typename Src, typename Dst>
+    void gatherCols (const MatrixBase<Src>& src, const MatrixBase<Dst>& dst)
+      const
+    {
+      Dst& d = const_cast<MatrixBase<Dst>&> (dst).derived ();
+      assert (d.cols () == size);
+      for (std::size_t k = 0; k < runs.size (); ++k)
+        d.middleCols (runs[k].out, runs[k].size) =
+          src.middleCols (runs[k].in, runs[k].size);
+      for (std::size_t k = 0; k < in.size (); ++k)
+        d.col (out[k]) = src.col (in[k]);
+    }
+
+    /// Selection of the columns of dst = src
+    template <typename Src, typename Dst>
+    void scatterCols (const MatrixBase<Src>& src, const MatrixBase<Dst>& dst)
+      const
+    {
+      Dst& d = const_cast<MatrixBase<Dst>&> (dst).derived ();
+      assert (src.cols () == size);
+      for (std::size_t k = 0; k < runs.size (); ++k)
+        d.middleCols (runs[k].in, runs[k].size) =
+          src.middleCols (runs[k].out, runs[k].size);
+      for (std::size_t k = 0; k < in.size (); ++k)
+        d.col (in[k]) = src.col (out[k]);
+    }
+
+    /// Runs of at least longRun indices
+    std::vector<Run> runs;
+    /// Indices of the shorter runs, in the full vector and in the
+    /// selection.
+    std::vector<size_type> in, out;
+    /// Number of selected indices
+    size_type size;
+  }; // struct IndexPlan
+
   template <typename ArgType, int _Rows, int _Cols, bool _allRows, bool _allCols> class MatrixBlockView;
 
   /// Collection of indices of matrix blocks
@@ -125,6 +289,8 @@ namespace Eigen {
 
   template <bool _allRows = false, bool _allCols = false> class MatrixBlocksRef;
 
+  template <bool _allRows, bool _allCols> class MatrixBlocksPlan;
+
   namespace internal {
       template <bool row> struct return_first {
         template <typename First, typename Second>
@@ -138,8 +304,8 @@ namespace Eigen {
       struct empty_struct {
         typedef MatrixXd::Index Index;
         empty_struct () {}
-        template <typename In_t> empty_struct (In_t) {}
-        template <typename In0_t, typename In1_t> empty_struct (In0_t, In1_t) {}
+        template <typename In_t> empty_struct (const In_t&) {}
+        template <typename In0_t, typename In1_t> empty_struct (const In0_t&, const In1_t&) {}
         static inline Index size() { return 1; }
         inline const Index& operator[](const Index& i) const { return i; }
       };
@@ -386,6 +552,14 @@ namespace Eigen {
           return typename View<const MatrixType>::type (other.derived(), nbRows(), rows(), nbCols(), cols());
       }
 
+      /// Compile the blocks into a flattened copy plan.
+      /// The plan must be compiled again if the blocks are modified.
+      /// \sa MatrixBlocksPlan
+      MatrixBlocksPlan<AllRows, AllCols> compile () const
+      {
+        return MatrixBlocksPlan<AllRows, AllCols> (*this);
+      }
+
       MatrixBlocksRef<AllCols, AllRows> transpose() const
       {
         return MatrixBlocksRef<AllCols, AllRows> (nbCols(), cols(), nbRows(), rows());
@@ -780,6 +954,106 @@ namespace Eigen {
   typedef Eigen::MatrixBlocks<false, true> RowBlockIndices;
   typedef Eigen::MatrixBlocks<true, false> ColBlockIndices;
 
+  namespace internal {
+    inline IndexPlan make_index_plan (const BlockIndex::segments_t& segments)
+    {
+      return IndexPlan (segments);
+    }
+    inline IndexPlan make_index_plan (const empty_struct&)
+    {
+      return IndexPlan ();
+    }
+  } // namespace internal
+
+  /// Compiled MatrixBlocks.
+  ///
+  /// gather and scatter are equivalent to the assignments from
+  /// MatrixBlocks::rview and to MatrixBlocks::lview, using an IndexPlan
+  /// for the rows and for the columns.
+  /// \code
+  /// MatrixBlocksPlan<false, true> plan (blocks.compile ());
+  /// plan.gather (m, small);  // small = blocks.rview (m);
+  /// plan.scatter (small, m); // blocks.lview (m) = small;
+  /// \endcode
+  template <bool _allRows, bool _allCols>
+  class MatrixBlocksPlan
+  {
+    public:
+      typedef hpp::constraints::size_type size_type;
+
+      MatrixBlocksPlan () {}
+
+      template <typename Derived>
+      explicit MatrixBlocksPlan (const MatrixBlocksBase<Derived>& blocks)
+        : m_rows (internal::make_index_plan (blocks.rows ())),
+        m_cols (internal::make_index_plan (blocks.cols ()))
+      {
+        EIGEN_STATIC_ASSERT(
+            (bool(_allRows) == bool(Derived::AllRows)) && (bool(_allCols) == bool(Derived::AllCols)),
+            YOU_MIXED_MATRICES_OF_DIFFERENT_SIZES);
+      }
+
+      /// dst = blocks.rview (src)
+      /// \note dst must have the size of the view.
+      template <typename Src, typename Dst>
+      void gather (const MatrixBase<Src>& src, const MatrixBase<Dst>& dst)
+        const
+      {
+        Dst& d = const_cast<MatrixBase<Dst>&> (dst).derived ();
+        if (_allRows) {
+          m_cols.gatherCols (src, d);
+        } else if (_allCols) {
+          for (size_type c = 0; c < src.cols (); ++c)
+            m_rows.gather (src.col (c), d.col (c));
+        } else {
+          for (std::size_t k = 0; k < m_cols.runs.size (); ++k) {
+            const IndexPlan::Run& r = m_cols.runs[k];
+            for (size_type c = 0; c < r.size; ++c)
+              m_rows.gather (src.col (r.in + c), d.col (r.out + c));
+          }
+          for (std::size_t k = 0; k < m_cols.in.size (); ++k)
+            m_rows.gather (src.col (m_cols.in[k]), d.col (m_cols.out[k]));
+        }
+      }
+
+      /// blocks.lview (dst) = src
+      template <typename Src, typename Dst>
+      void scatter (const MatrixBase<Src>& src, const MatrixBase<Dst>& dst)
+        const
+      {
+        Dst& d = const_cast<MatrixBase<Dst>&> (dst).derived ();
+        if (_allRows) {
+          m_cols.scatterCols (src, d);
+        } else if (_allCols) {
+          for (size_type c = 0; c < src.cols (); ++c)
+            m_rows.scatter (src.col (c), d.col (c));
+        } else {
+          for (std::size_t k = 0; k < m_cols.runs.size (); ++k) {
+            const IndexPlan::Run& r = m_cols.runs[k];
+            for (size_type c = 0; c < r.size; ++c)
+              m_rows.scatter (src.col (r.out + c), d.col (r.in + c));
+          }
+          for (std::size_t k = 0; k < m_cols.in.size (); ++k)
+            m_rows.scatter (src.col (m_cols.out[k]), d.col (m_cols.in[k]));
+        }
+      }
+
+      /// Plan of the rows, empty if all rows are selected
+      const IndexPlan& rows () const
+      {
+        return m_rows;
+      }
+
+      /// Plan of the columns, empty if all columns are selected
+      const IndexPlan& cols () const
+      {
+        return m_cols;
+      }
+
+    private:
+      IndexPlan m_rows, m_cols;
+  }; // class MatrixBlocksPlan
+
   /// A view of an Eigen matrix.
   ///
   /// Instances of MatrixBlockView are easily built from a MatrixBlocks object.
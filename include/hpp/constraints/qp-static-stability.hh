@@ -84,6 +84,37 @@ namespace hpp {
 
         void impl_jacobian (matrixOut_t jacobian, ConfigurationIn_t argument) const;
 
+        /// Compute the value and the jacobian with a single resolution of
+        /// the QP.
+        void impl_valueAndJacobian (LiegroupElement& result,
+            matrixOut_t jacobian, ConfigurationIn_t argument) const;
+        /// Keep the evaluations in a context and of the active columns fused.
+        void impl_valueAndJacobian (LiegroupElement& result,
+            matrixOut_t jacobian, ConfigurationIn_t argument,
+            EvaluationContext& context) const
+        {
+          legacyValueAndJacobian (result, jacobian, argument, &context);
+        }
+        void impl_valueAndJacobianCompressed (LiegroupElement& result,
+            matrixOut_t jacobian, ConfigurationIn_t argument) const
+        {
+          legacyValueAndJacobian (result, jacobian, argument, NULL);
+        }
+        void impl_valueAndJacobianCompressed (LiegroupElement& result,
+            matrixOut_t jacobian, ConfigurationIn_t argument,
+            EvaluationContext& context) const
+        {
+          legacyValueAndJacobian (result, jacobian, argument, &context);
+        }
+
+        /// Compute the kinematics and phi, and solve the QP.
+        /// \param jacobian whether the jacobian of phi is computed.
+        void computeQP (vectorOut_t result, ConfigurationIn_t argument,
+                        bool jacobian) const;
+
+        /// Compute the jacobian from the solution of the QP.
+        void computeJacobian (matrixOut_t jacobian) const;
+
         qpOASES::returnValue solveQP (vectorOut_t result) const;
 
         bool checkQPSol () const;
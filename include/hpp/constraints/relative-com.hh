@@ -94,7 +94,34 @@ namespace hpp {
 	const throw ();
       virtual void impl_jacobian (matrixOut_t jacobian,
 				  ConfigurationIn_t arg) const throw ();
+      /// Compute the value and the jacobian with a single computation of
+      /// the kinematics and of the center of mass.
+      virtual void impl_valueAndJacobian (LiegroupElement& result,
+                                          matrixOut_t jacobian,
+                                          ConfigurationIn_t arg) const;
+      /// Keep the evaluations in a context and of the active columns fused.
+      virtual void impl_valueAndJacobian (LiegroupElement& result,
+          matrixOut_t jacobian, ConfigurationIn_t argument,
+          EvaluationContext& context) const
+      {
+        legacyValueAndJacobian (result, jacobian, argument, &context);
+      }
+      virtual void impl_valueAndJacobianCompressed (LiegroupElement& result,
+          matrixOut_t jacobian, ConfigurationIn_t argument) const
+      {
+        legacyValueAndJacobian (result, jacobian, argument, NULL);
+      }
+      virtual void impl_valueAndJacobianCompressed (LiegroupElement& result,
+          matrixOut_t jacobian, ConfigurationIn_t argument,
+          EvaluationContext& context) const
+      {
+        legacyValueAndJacobian (result, jacobian, argument, &context);
+      }
     private:
+      /// Compute the value from the current kinematics.
+      void computeValue (LiegroupElement& result) const;
+      /// Compute the jacobian from the current kinematics.
+      void computeJacobian (matrixOut_t jacobian) const;
       DevicePtr_t robot_;
       CenterOfMassComputationPtr_t comc_;
       JointPtr_t joint_;
@@ -0,0 +1,169 @@
+// Copyright (c) 2018, Joseph Mirabel
+// Authors: Joseph Mirabel (joseph.mirabel@laas.fr)
+//
+// This file is part of hpp-constraints.
+// hpp-constraints is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-constraints is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-constraints. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HPP_CONSTRAINTS_SOLVER_TELEMETRY_HH
+# define HPP_CONSTRAINTS_SOLVER_TELEMETRY_HH
+
+# include <iostream>
+# include <vector>
+
+# include <boost/atomic.hpp>
+# include <boost/chrono.hpp>
+# include <boost/cstdint.hpp>
+
+# include <hpp/constraints/fwd.hh>
+# include <hpp/constraints/config.hh>
+
+namespace hpp {
+  namespace constraints {
+    /// \addtogroup solvers
+    /// \{
+
+    /// Measurements of the resolutions of a solver.
+    ///
+    /// A telemetry records the time spent in each phase of the resolution,
+    /// the number of iterations of each resolution and the number of
+    /// resolutions of each status. It is enabled by passing it to
+    /// HierarchicalIterativeSolver::telemetry.
+    ///
+    /// The counters are atomic so that the resolutions running concurrently,
+    /// for instance in HierarchicalIterativeSolver::solveBatch, are
+    /// aggregated without lock. They can be read and reset at any time.
+    class HPP_CONSTRAINTS_DLLAPI SolverTelemetry
+    {
+      public:
+        /// Phases of the resolution.
+        /// \note LINE_SEARCH includes the evaluations of the values and the
+        ///       resolutions of the explicit system done by the line search.
+        enum Phase {
+          /// Evaluation of the values of the functions, without their
+          /// Jacobians
+          VALUE,
+          /// Evaluation of the values and of the Jacobians of the functions
+          JACOBIAN,
+          /// Composition with the Jacobian of the explicit system
+          /// (HybridSolver::updateJacobian)
+          EXPLICIT_JACOBIAN,
+          /// Decompositions and computation of the descent direction
+          DESCENT_DIRECTION,
+          /// Line search
+          LINE_SEARCH,
+          /// Resolution of the explicit system (ExplicitSolver::solve)
+          EXPLICIT_SOLVE,
+          NB_PHASES
+        };
+
+        /// Number of values of HierarchicalIterativeSolver::Status.
+        static const std::size_t NB_STATUS = 4;
+        /// Number of bins of the histogram of iterations. The last bin
+        /// counts the resolutions with at least NB_ITERATION_BINS - 1
+        /// iterations.
+        static const std::size_t NB_ITERATION_BINS = 64;
+
+        typedef boost::chrono::steady_clock Clock_t;
+
+        /// Add the duration of its lifetime to a phase.
+        /// Nothing is measured if the telemetry is NULL.
+        class Timer
+        {
+          public:
+            Timer (SolverTelemetry* telemetry, Phase phase)
+              : telemetry_ (telemetry), phase_ (phase)
+            {
+              if (telemetry_) start_ = Clock_t::now ();
+            }
+
+            ~Timer ()
+            {
+              if (telemetry_)
+                telemetry_->addTime (phase_, Clock_t::now () - start_);
+            }
+
+          private:
+            SolverTelemetry* telemetry_;
+            Phase phase_;
+            Clock_t::time_point start_;
+        };
+
+        SolverTelemetry ();
+
+        /// Set all the counters to zero.
+        void reset ();
+
+        /// Add a duration to a phase.
+        void addTime (Phase phase, const Clock_t::duration& duration)
+        {
+          time_ [phase].fetch_add (
+              boost::chrono::duration_cast <boost::chrono::nanoseconds>
+              (duration).count (), boost::memory_order_relaxed);
+          calls_[phase].fetch_add (1, boost::memory_order_relaxed);
+        }
+
+        /// Record the end of a resolution.
+        /// \param status a HierarchicalIterativeSolver::Status
+        void addResolution (std::size_t status, size_type iterations);
+
+        /// \name Queries
+        /// \{
+
+        /// Total time spent in a phase, in seconds.
+        value_type time (Phase phase) const;
+
+        /// Number of measurements of a phase.
+        std::size_t calls (Phase phase) const;
+
+        /// Total number of resolutions.
+        std::size_t resolutions () const;
+
+        /// Number of resolutions which ended with a status.
+        /// \param status a HierarchicalIterativeSolver::Status
+        std::size_t resolutions (std::size_t status) const;
+
+        /// Number of resolutions per number of iterations.
+        /// \sa NB_ITERATION_BINS
+        std::vector<std::size_t> iterationHistogram () const;
+
+        /// Total number of iterations.
+        std::size_t iterations () const;
+
+        std::ostream& print (std::ostream& os) const;
+
+        static const char* phaseName (Phase phase);
+
+        /// \}
+
+      private:
+        // Non copyable
+        SolverTelemetry (const SolverTelemetry&);
+        SolverTelemetry& operator= (const SolverTelemetry&);
+
+        boost::atomic<boost::uint64_t> time_ [NB_PHASES];
+        boost::atomic<boost::uint64_t> calls_[NB_PHASES];
+        boost::atomic<boost::uint64_t> status_[NB_STATUS];
+        boost::atomic<boost::uint64_t> iterationBins_[NB_ITERATION_BINS];
+        boost::atomic<boost::uint64_t> iterations_;
+    }; // class SolverTelemetry
+
+    inline std::ostream& operator<< (std::ostream& os,
+                                     const SolverTelemetry& t)
+    {
+      return t.print (os);
+    }
+    /// \}
+  } // namespace constraints
+} // namespace hpp
+
+#endif // HPP_CONSTRAINTS_SOLVER_TELEMETRY_HH
@@ -73,6 +73,39 @@ namespace hpp {
 
         void impl_jacobian (matrixOut_t jacobian, ConfigurationIn_t argument) const;
 
+        /// Compute the value and the jacobian with a single decomposition
+        /// of phi.
+        void impl_valueAndJacobian (LiegroupElement& result,
+            matrixOut_t jacobian, ConfigurationIn_t argument) const;
+        /// Keep the evaluations in a context and of the active columns fused.
+        void impl_valueAndJacobian (LiegroupElement& result,
+            matrixOut_t jacobian, ConfigurationIn_t argument,
+            EvaluationContext& context) const
+        {
+          legacyValueAndJacobian (result, jacobian, argument, &context);
+        }
+        void impl_valueAndJacobianCompressed (LiegroupElement& result,
+            matrixOut_t jacobian, ConfigurationIn_t argument) const
+        {
+          legacyValueAndJacobian (result, jacobian, argument, NULL);
+        }
+        void impl_valueAndJacobianCompressed (LiegroupElement& result,
+            matrixOut_t jacobian, ConfigurationIn_t argument,
+            EvaluationContext& context) const
+        {
+          legacyValueAndJacobian (result, jacobian, argument, &context);
+        }
+
+        /// Compute the kinematics, the decomposition of phi, u, uMinus and v.
+        /// \param jacobian whether the data of the jacobian are computed.
+        void computeU (ConfigurationIn_t argument, bool jacobian) const;
+
+        /// Compute the value from u and v.
+        void computeValue (LiegroupElement& result) const;
+
+        /// Compute the jacobian from u and v.
+        void computeJacobian (matrixOut_t jacobian) const;
+
         static void findBoundIndex (vectorIn_t u, vectorIn_t v, 
             value_type& lambdaMin, size_type* iMin,
             value_type& lambdaMax, size_type* iMax);
@@ -95,6 +128,8 @@ namespace hpp {
 
         mutable MoE_t phi_;
         mutable vector_t u_, uMinus_, v_;
+        /// Whether uMinus_ is not zero, in which case v_ is computed.
+        mutable bool hasUminus_;
         mutable matrix_t uDot_, uMinusDot_, vDot_;
         mutable vector_t lambdaDot_; 
     };
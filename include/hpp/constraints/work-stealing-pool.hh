@@ -0,0 +1,79 @@
+// Copyright (c) 2018, Joseph Mirabel
+// Authors: Joseph Mirabel (joseph.mirabel@laas.fr)
+//
+// This file is part of hpp-constraints.
+// hpp-constraints is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-constraints is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-constraints. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HPP_CONSTRAINTS_WORK_STEALING_POOL_HH
+# define HPP_CONSTRAINTS_WORK_STEALING_POOL_HH
+
+# include <cstddef>
+# include <boost/function.hpp>
+
+# include <hpp/constraints/config.hh>
+
+namespace hpp {
+  namespace constraints {
+    /// \addtogroup solvers
+    /// \{
+
+    /// Pool of threads executing indexed tasks.
+    ///
+    /// The tasks of a call to run are split into one range per thread.
+    /// A thread that has completed its range steals half of the remaining
+    /// range of another thread.
+    class HPP_CONSTRAINTS_DLLAPI WorkStealingPool
+    {
+      public:
+        /// Task called with the task index and the index of the thread
+        /// running it, in [0, size()).
+        typedef boost::function<void (std::size_t task, std::size_t worker)>
+          Task_t;
+
+        /// Constructor
+        /// \param nbThreads number of threads. If 0, the number of hardware
+        ///        threads is used.
+        explicit WorkStealingPool (std::size_t nbThreads = 0);
+
+        /// Stop and join the threads.
+        ~WorkStealingPool ();
+
+        /// Number of threads.
+        std::size_t size () const;
+
+        /// Run task for every index in [0, nbTasks) and wait for completion.
+        ///
+        /// Concurrent calls to this function are serialized. When called
+        /// from a task of this pool, the tasks are run sequentially by the
+        /// calling thread, with its worker index, and their exceptions are
+        /// propagated as is.
+        /// \throw std::runtime_error if one of the tasks threw an exception.
+        void run (std::size_t nbTasks, const Task_t& task);
+
+        /// Pool shared by the solvers, with one thread per hardware thread.
+        static WorkStealingPool& global ();
+
+      private:
+        struct Impl;
+
+        // Non copyable
+        WorkStealingPool (const WorkStealingPool&);
+        WorkStealingPool& operator= (const WorkStealingPool&);
+
+        Impl* impl_;
+    }; // class WorkStealingPool
+    /// \}
+  } // namespace constraints
+} // namespace hpp
+
+#endif // HPP_CONSTRAINTS_WORK_STEALING_POOL_HH
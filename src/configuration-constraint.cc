@@ -22,6 +22,8 @@
 #include <hpp/pinocchio/configuration.hh>
 #include <hpp/pinocchio/liegroup-space.hh>
 
+#include <hpp/constraints/evaluation-context.hh>
+
 namespace hpp {
   namespace constraints {
 
@@ -39,7 +41,8 @@ namespace hpp {
         ConfigurationIn_t goal, std::vector <bool> mask) :
       DifferentiableFunction (robot->configSize (), robot->numberDof (),
                               LiegroupSpace::R1 (), name),
-      robot_ (robot), goal_ (goal), diff_ (robot->numberDof())
+      robot_ (robot), goal_ (goal), diff_ (robot->numberDof()),
+      diffScratch_ (EvaluationContext::newScratchId ())
     {
       mask_ = EigenBoolVector_t (robot->numberDof ());
       for (std::size_t i = 0; i < mask.size (); ++i) {
@@ -64,5 +67,24 @@ namespace hpp {
       jacobian.leftCols (robot_->numberDof ()) =
         mask_.select (diff_, 0).transpose ();
     }
+
+    void ConfigurationConstraint::impl_compute (LiegroupElement& result,
+                                                ConfigurationIn_t argument,
+                                                EvaluationContext& context)
+      const
+    {
+      vector_t& diff = context.scratch (diffScratch_, diff_);
+      hpp::pinocchio::difference (robot_, argument, goal_, diff);
+      result.vector () [0] = 0.5 * mask_.select (diff, 0).squaredNorm ();
+    }
+
+    void ConfigurationConstraint::impl_jacobian (matrixOut_t jacobian,
+        ConfigurationIn_t argument, EvaluationContext& context) const
+    {
+      vector_t& diff = context.scratch (diffScratch_, diff_);
+      hpp::pinocchio::difference (robot_, argument, goal_, diff);
+      jacobian.leftCols (robot_->numberDof ()) =
+        mask_.select (diff, 0).transpose ();
+    }
   } // namespace constraints
 } // namespace hpp
@@ -132,12 +132,54 @@ namespace hpp {
 
     void ConvexShapeContact::impl_compute (LiegroupElement& result,
                                            ConfigurationIn_t argument) const
+    {
+      computeInternalValue (argument);
+      copyInternalValue (result);
+    }
+
+    void ConvexShapeContact::impl_jacobian (matrixOut_t jacobian, ConfigurationIn_t argument) const
+    {
+      computeInternalJacobian (argument);
+      copyInternalJacobian (jacobian);
+    }
+
+    void ConvexShapeContact::impl_valueAndJacobian (LiegroupElement& result,
+        matrixOut_t jacobian, ConfigurationIn_t argument) const
+    {
+      computeInternalValueAndJacobian (argument);
+      copyInternalValue (result);
+      copyInternalJacobian (jacobian);
+    }
+
+    void ConvexShapeContact::computeInternalValue
+    (ConfigurationIn_t argument) const
     {
       robot_->currentConfiguration (argument);
       robot_->computeForwardKinematics ();
-
       selectConvexShapes ();
       relativeTransformation_.value (result_, argument);
+    }
+
+    void ConvexShapeContact::computeInternalJacobian
+    (ConfigurationIn_t argument) const
+    {
+      robot_->currentConfiguration (argument);
+      robot_->computeForwardKinematics ();
+      selectConvexShapes ();
+      relativeTransformation_.jacobian (jacobian_, argument);
+    }
+
+    void ConvexShapeContact::computeInternalValueAndJacobian
+    (ConfigurationIn_t argument) const
+    {
+      robot_->currentConfiguration (argument);
+      robot_->computeForwardKinematics ();
+      selectConvexShapes ();
+      relativeTransformation_.valueAndJacobian (result_, jacobian_, argument);
+    }
+
+    void ConvexShapeContact::copyInternalValue (LiegroupElement& result) const
+    {
       if (isInside_) {
         result.vector () [0] = result_.vector () [0] + normalMargin_;
         result.vector ().segment <2> (1).setZero ();
@@ -163,18 +205,8 @@ namespace hpp {
       hppDout (info, "result = " << result);
     }
 
-    void ConvexShapeContact::computeInternalJacobian
-    (ConfigurationIn_t argument) const
+    void ConvexShapeContact::copyInternalJacobian (matrixOut_t jacobian) const
     {
-      robot_->currentConfiguration (argument);
-      robot_->computeForwardKinematics ();
-      selectConvexShapes ();
-      relativeTransformation_.jacobian (jacobian_, argument);
-    }
-
-    void ConvexShapeContact::impl_jacobian (matrixOut_t jacobian, ConfigurationIn_t argument) const
-    {
-      computeInternalJacobian (argument);
       if (isInside_) {
 	jacobian.row (0) = jacobian_.row (0);
 	jacobian.row (1).setZero ();
@@ -187,7 +219,7 @@ namespace hpp {
           jacobian.bottomRows<2> ().setZero ();
           break;
         case LINE_ON_PLANE:
-          // FIXME: See FIXME of impl_compute
+          // FIXME: See FIXME of copyInternalValue
           // jacobian.row (3).setZero ();
           // jacobian.row (4) = jacobian_.row (5);
           throw std::logic_error ("Contact LINE_ON_PLANE: Unimplement feature");
@@ -284,8 +316,29 @@ namespace hpp {
     void ConvexShapeContactComplement::impl_compute
     (LiegroupElement& result, ConfigurationIn_t argument) const
     {
-      LiegroupElement tmp (LiegroupSpace::Rn (5));
-      sibling_->impl_compute (tmp, argument);
+      sibling_->computeInternalValue (argument);
+      copyInternalValue (result);
+    }
+
+    void ConvexShapeContactComplement::impl_jacobian
+    (matrixOut_t jacobian, ConfigurationIn_t argument) const
+    {
+      sibling_->computeInternalJacobian (argument);
+      copyInternalJacobian (jacobian);
+    }
+
+    void ConvexShapeContactComplement::impl_valueAndJacobian
+    (LiegroupElement& result, matrixOut_t jacobian,
+     ConfigurationIn_t argument) const
+    {
+      sibling_->computeInternalValueAndJacobian (argument);
+      copyInternalValue (result);
+      copyInternalJacobian (jacobian);
+    }
+
+    void ConvexShapeContactComplement::copyInternalValue
+    (LiegroupElement& result) const
+    {
       result.vector () [2] = sibling_->result_.vector () [3];
       if (sibling_->isInside_) {
 	result.vector () [0] = sibling_->result_.vector () [1];
@@ -297,10 +350,9 @@ namespace hpp {
       hppDout (info, "result = " << result);
     }
 
-    void ConvexShapeContactComplement::impl_jacobian
-    (matrixOut_t jacobian, ConfigurationIn_t argument) const
+    void ConvexShapeContactComplement::copyInternalJacobian
+    (matrixOut_t jacobian) const
     {
-      sibling_->computeInternalJacobian (argument);
       if (sibling_->isInside_) {
 	jacobian.row (0) = sibling_->jacobian_.row (1);
 	jacobian.row (1) = sibling_->jacobian_.row (2);
@@ -0,0 +1,369 @@
+// Copyright (c) 2018, Joseph Mirabel
+// Authors: Joseph Mirabel (joseph.mirabel@laas.fr)
+//
+// This file is part of hpp-constraints.
+// hpp-constraints is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-constraints is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-constraints. If not, see <http://www.gnu.org/licenses/>.
+
+#include <hpp/constraints/decomposition.hh>
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+#include <hpp/constraints/svd.hh>
+
+namespace hpp {
+  namespace constraints {
+    namespace {
+      template <typename SVD>
+      void svdSolve (const SVD& svd, vectorIn_t b, vectorOut_t x,
+                     vector_t& tmp)
+      {
+        // x = V1 S1^-1 U1^T b
+        const size_type r = svd.rank();
+        tmp.head (r).noalias() = getU1<SVD> (svd).adjoint() * b;
+        tmp.head (r).array() /= svd.singularValues().head (r).array();
+        x.noalias() = getV1<SVD> (svd) * tmp.head (r);
+      }
+
+      template <typename SVD>
+      void svdProjectOnKernel (const SVD& svd, vectorOut_t x, vector_t& tmp)
+      {
+        const size_type r = svd.rank();
+        tmp.head (r).noalias() = getV1<SVD> (svd).adjoint() * x;
+        x.noalias() -= getV1<SVD> (svd) * tmp.head (r);
+      }
+
+      /// Apply the first length Householder reflections of qr, or their
+      /// adjoint, on the left of dst.
+      ///
+      /// Contrary to HouseholderSequence::applyOnTheLeft, this does not
+      /// allocate memory. workspace must be of size dst.cols().
+      template <typename QR, typename Derived>
+      void applyHouseholderQ (const QR& qr, size_type length, bool adjoint,
+                              const Eigen::MatrixBase<Derived>& _dst,
+                              vector_t& workspace)
+      {
+        Eigen::MatrixBase<Derived>& dst =
+          const_cast<Eigen::MatrixBase<Derived>&> (_dst);
+        const size_type n = qr.matrixQR().rows();
+        for (size_type i = 0; i < length; ++i) {
+          const size_type k = (adjoint ? i : length - 1 - i);
+          dst.bottomRows (n - k).applyHouseholderOnTheLeft
+            (qr.matrixQR().col (k).tail (n - k - 1), qr.hCoeffs() (k),
+             workspace.data());
+        }
+      }
+    } // namespace
+
+    Decomposition::Decomposition ()
+      : type_ (JACOBI_SVD), threshold_ (0), damping_ (1e-8), rank_ (0),
+      rows_ (0), cols_ (0), computeKernel_ (false)
+    {}
+
+    void Decomposition::allocate (Type type, size_type rows, size_type cols,
+                                  bool computeKernel)
+    {
+      type_ = type;
+      rank_ = 0;
+      rows_ = rows;
+      cols_ = cols;
+      computeKernel_ = computeKernel;
+      const unsigned int flags = Eigen::ComputeThinU | Eigen::ComputeThinV;
+      switch (type_) {
+        case JACOBI_SVD:
+          jacobiSvd_ = Eigen::JacobiSVD <matrix_t> (rows, cols, flags);
+          break;
+# if EIGEN_VERSION_AT_LEAST(3,3,0)
+        case BDC_SVD:
+          bdcSvd_ = Eigen::BDCSVD <matrix_t> (rows, cols, flags);
+          break;
+        case COMPLETE_ORTHOGONAL_DECOMPOSITION:
+          cod_ = Eigen::CompleteOrthogonalDecomposition <matrix_t> (rows, cols);
+          J_.resize (rows, cols);
+          break;
+# else // EIGEN_VERSION_AT_LEAST(3,3,0)
+        case BDC_SVD:
+        case COMPLETE_ORTHOGONAL_DECOMPOSITION:
+          throw std::invalid_argument ("BDC_SVD and "
+              "COMPLETE_ORTHOGONAL_DECOMPOSITION require Eigen >= 3.3");
+# endif // EIGEN_VERSION_AT_LEAST(3,3,0)
+        case COL_PIV_HOUSEHOLDER_QR:
+          qr_ = Eigen::ColPivHouseholderQR <matrix_t> (cols, rows);
+          Q1_.resize (cols, std::min (rows, cols));
+          householderWs_.resize (std::min (rows, cols));
+          break;
+        case DAMPED_LLT:
+          llt_ = Eigen::LLT <matrix_t> (rows);
+          J_.resize (rows, cols);
+          JJt_.resize (rows, rows);
+          tmpJ_.resize (rows, cols);
+          break;
+      }
+      if (computeKernel && type_ != COL_PIV_HOUSEHOLDER_QR)
+        qr_ = Eigen::ColPivHouseholderQR <matrix_t> (cols, rows);
+      sv_.resize (std::min (rows, cols));
+      tmpRows_.resize (rows);
+      tmpCols_.resize (cols);
+      threshold (threshold_);
+    }
+
+    void Decomposition::threshold (const value_type& threshold)
+    {
+      threshold_ = threshold;
+      switch (type_) {
+        case JACOBI_SVD:
+          jacobiSvd_.setThreshold (threshold_);
+          break;
+# if EIGEN_VERSION_AT_LEAST(3,3,0)
+        case BDC_SVD:
+          bdcSvd_.setThreshold (threshold_);
+          break;
+        case COMPLETE_ORTHOGONAL_DECOMPOSITION:
+          cod_.setThreshold (threshold_);
+          break;
+# endif // EIGEN_VERSION_AT_LEAST(3,3,0)
+        default:
+          break;
+      }
+      qr_.setThreshold (threshold_);
+    }
+
+    void Decomposition::compute (const matrix_t& J)
+    {
+      if (J.rows() != rows_ || J.cols() != cols_)
+        allocate (type_, J.rows(), J.cols(), computeKernel_);
+      switch (type_) {
+        case JACOBI_SVD:
+          jacobiSvd_.compute (J);
+          break;
+# if EIGEN_VERSION_AT_LEAST(3,3,0)
+        case BDC_SVD:
+          bdcSvd_.compute (J);
+          break;
+        case COMPLETE_ORTHOGONAL_DECOMPOSITION:
+          J_ = J;
+          cod_.compute (J);
+          rank_ = cod_.rank ();
+          estimateSingularValues ();
+          break;
+# endif // EIGEN_VERSION_AT_LEAST(3,3,0)
+        case COL_PIV_HOUSEHOLDER_QR:
+          qr_.compute (J.transpose ());
+          rank_ = qr_.rank ();
+          estimateSingularValues ();
+          break;
+        case DAMPED_LLT:
+          J_ = J;
+          JJt_.noalias() = J * J.transpose ();
+          JJt_.diagonal().array() += damping_;
+          llt_.compute (JJt_);
+          estimateSingularValues ();
+          rank_ = 0;
+          while (rank_ < sv_.size() && sv_[rank_] > 0
+              && sv_[rank_] > threshold_ * sv_[0])
+            ++rank_;
+          break;
+        default:
+          break;
+      }
+      if (computeKernel_ && type_ != COL_PIV_HOUSEHOLDER_QR)
+        qr_.compute (J.transpose ());
+    }
+
+    void Decomposition::estimateSingularValues ()
+    {
+      switch (type_) {
+# if EIGEN_VERSION_AT_LEAST(3,3,0)
+        case COMPLETE_ORTHOGONAL_DECOMPOSITION:
+          sv_ = cod_.matrixQTZ ().diagonal ().cwiseAbs ();
+          break;
+# endif // EIGEN_VERSION_AT_LEAST(3,3,0)
+        case COL_PIV_HOUSEHOLDER_QR:
+          sv_ = qr_.matrixR ().diagonal ().cwiseAbs ();
+          break;
+        case DAMPED_LLT:
+          // L(k,k)^2 = d_k + damping where d_k estimates the k-th squared
+          // singular value. Values that are not above the damping are
+          // considered as zero.
+          for (size_type k = 0; k < sv_.size(); ++k) {
+            const value_type l2 = llt_.matrixLLT () (k, k)
+              * llt_.matrixLLT () (k, k);
+            sv_[k] = (l2 > 2 * damping_ ? std::sqrt (l2 - damping_) : 0);
+          }
+          break;
+        default:
+          return;
+      }
+      std::sort (sv_.data(), sv_.data() + sv_.size(),
+                 std::greater<value_type> ());
+    }
+
+    void Decomposition::solve (vectorIn_t b, vectorOut_t x) const
+    {
+      switch (type_) {
+        case JACOBI_SVD:
+          svdSolve (jacobiSvd_, b, x, tmpRows_);
+          break;
+# if EIGEN_VERSION_AT_LEAST(3,3,0)
+        case BDC_SVD:
+          svdSolve (bdcSvd_, b, x, tmpRows_);
+          break;
+        case COMPLETE_ORTHOGONAL_DECOMPOSITION:
+          x = cod_.solve (b);
+          break;
+# endif // EIGEN_VERSION_AT_LEAST(3,3,0)
+        case COL_PIV_HOUSEHOLDER_QR:
+          // J^T P = Q R so that J x = b is equivalent to R^T Q^T x = P^T b.
+          // The solution of minimal norm is x = Q1 R1^-T (P^T b)_1
+          tmpRows_.noalias() = qr_.colsPermutation ().transpose () * b;
+          x.setZero ();
+          x.head (rank_) = qr_.matrixR ().topLeftCorner (rank_, rank_)
+            .template triangularView <Eigen::Upper> ().transpose ()
+            .solve (tmpRows_.head (rank_));
+          applyHouseholderQ (qr_, rank_, false, x, householderWs_);
+          break;
+        case DAMPED_LLT:
+          // x = J^T (J J^T + damping I)^-1 b. One step of iterative
+          // refinement removes most of the bias due to the damping, so that
+          // the residual vanishes when J is full rank.
+          tmpRows_ = b;
+          llt_.solveInPlace (tmpRows_);
+          x.noalias() = J_.transpose () * tmpRows_;
+          tmpRows_ = b;
+          tmpRows_.noalias() -= J_ * x;
+          llt_.solveInPlace (tmpRows_);
+          x.noalias() += J_.transpose () * tmpRows_;
+          break;
+      }
+    }
+
+    size_type Decomposition::rank () const
+    {
+      switch (type_) {
+        case JACOBI_SVD:
+          return jacobiSvd_.rank ();
+# if EIGEN_VERSION_AT_LEAST(3,3,0)
+        case BDC_SVD:
+          return bdcSvd_.rank ();
+# endif // EIGEN_VERSION_AT_LEAST(3,3,0)
+        default:
+          return rank_;
+      }
+    }
+
+    const vector_t& Decomposition::singularValues () const
+    {
+      switch (type_) {
+        case JACOBI_SVD:
+          return jacobiSvd_.singularValues ();
+# if EIGEN_VERSION_AT_LEAST(3,3,0)
+        case BDC_SVD:
+          return bdcSvd_.singularValues ();
+# endif // EIGEN_VERSION_AT_LEAST(3,3,0)
+        default:
+          return sv_;
+      }
+    }
+
+    void Decomposition::projectorOnSpan (matrixOut_t projector) const
+    {
+      switch (type_) {
+        case JACOBI_SVD:
+          hpp::constraints::projectorOnSpan (jacobiSvd_, projector);
+          break;
+# if EIGEN_VERSION_AT_LEAST(3,3,0)
+        case BDC_SVD:
+          hpp::constraints::projectorOnSpan (bdcSvd_, projector);
+          break;
+        case COMPLETE_ORTHOGONAL_DECOMPOSITION:
+          projector = cod_.solve (J_);
+          break;
+# endif // EIGEN_VERSION_AT_LEAST(3,3,0)
+        case COL_PIV_HOUSEHOLDER_QR:
+          Q1_.leftCols (rank_).setIdentity ();
+          applyHouseholderQ (qr_, rank_, false, Q1_.leftCols (rank_),
+                             householderWs_);
+          projector.noalias() = Q1_.leftCols (rank_)
+            * Q1_.leftCols (rank_).transpose ();
+          break;
+        case DAMPED_LLT:
+          tmpJ_ = J_;
+          llt_.solveInPlace (tmpJ_);
+          projector.noalias() = J_.transpose () * tmpJ_;
+          break;
+      }
+    }
+
+    void Decomposition::projectOnKernel (vectorOut_t x) const
+    {
+      switch (type_) {
+        case JACOBI_SVD:
+          svdProjectOnKernel (jacobiSvd_, x, tmpCols_);
+          break;
+# if EIGEN_VERSION_AT_LEAST(3,3,0)
+        case BDC_SVD:
+          svdProjectOnKernel (bdcSvd_, x, tmpCols_);
+          break;
+        case COMPLETE_ORTHOGONAL_DECOMPOSITION:
+          tmpRows_.noalias() = J_ * x;
+          tmpCols_ = cod_.solve (tmpRows_);
+          x -= tmpCols_;
+          break;
+# endif // EIGEN_VERSION_AT_LEAST(3,3,0)
+        case COL_PIV_HOUSEHOLDER_QR:
+          // Keep the components of Q^T x on the columns of Q that are not
+          // in the span of J^T.
+          applyHouseholderQ (qr_, rank_, true, x, householderWs_);
+          x.head (rank_).setZero ();
+          applyHouseholderQ (qr_, rank_, false, x, householderWs_);
+          break;
+        case DAMPED_LLT:
+          tmpRows_.noalias() = J_ * x;
+          llt_.solveInPlace (tmpRows_);
+          x.noalias() -= J_.transpose () * tmpRows_;
+          break;
+      }
+    }
+
+    // J^T P = Q R with Q = H_0 ... H_{p-1}. H_k does not modify the first
+    // k rows so the first r columns of Q and of H_0 ... H_{r-1} are equal
+    // and span the image of J^T. The other columns of H_0 ... H_{r-1} span
+    // the kernel of J.
+    size_type Decomposition::kernelDimension () const
+    {
+      assert (computeKernel_);
+      return cols_ - qr_.rank ();
+    }
+
+    void Decomposition::applyKernelQOnTheRight (matrixOut_t M) const
+    {
+      assert (computeKernel_);
+      assert (M.cols() == cols_);
+      if (kernelWs_.size() < M.rows()) kernelWs_.resize (M.rows());
+      const size_type r = qr_.rank ();
+      for (size_type k = 0; k < r; ++k)
+        M.rightCols (cols_ - k).applyHouseholderOnTheRight
+          (qr_.matrixQR().col (k).tail (cols_ - k - 1), qr_.hCoeffs() (k),
+           kernelWs_.data());
+    }
+
+    void Decomposition::applyKernelQOnTheLeft (vectorOut_t x) const
+    {
+      assert (computeKernel_);
+      assert (x.rows() == cols_);
+      if (kernelWs_.size() < x.cols()) kernelWs_.resize (x.cols());
+      applyHouseholderQ (qr_, qr_.rank (), false, x, kernelWs_);
+    }
+  } // namespace constraints
+} // namespace hpp
@@ -20,6 +20,103 @@
 
 namespace hpp {
   namespace constraints {
+    namespace {
+      /// Evaluation of one function of a stack into its rows.
+      struct EvaluationTask
+      {
+        typedef DifferentiableFunctionStack::Functions_t Functions_t;
+
+        EvaluationTask (std::size_t s, const Functions_t& f,
+            LiegroupElement* r, matrixOut_t* j, ConfigurationIn_t a,
+            const std::vector<size_type>& vr,
+            const std::vector<size_type>& dr,
+            const std::vector<LiegroupElement>& i,
+            const std::vector<EvaluationContextPtr_t>& c)
+          : scratch (s), functions (f), result (r), jacobian (j), arg (a),
+          valueRows (vr), derivativeRows (dr), init (i), contexts (c)
+        {}
+
+        void operator() (std::size_t i, std::size_t worker) const
+        {
+          const DifferentiableFunction& f = *functions[i];
+          EvaluationContext& context = *contexts[worker];
+          // The value of each function is stored in the context because the
+          // result of the stack does not have the Lie group of the function.
+          std::vector <LiegroupElement>& values =
+            context.scratch (scratch, init);
+          // Functions may have been added since the previous evaluation.
+          if (values.size () != init.size ()) values = init;
+          if (result != NULL && jacobian != NULL)
+            f.valueAndJacobian (values[i], jacobian->middleRows
+                (derivativeRows[i], f.outputDerivativeSize()), arg, context);
+          else if (result != NULL)
+            f.value (values[i], arg, context);
+          else
+            f.jacobian (jacobian->middleRows
+                (derivativeRows[i], f.outputDerivativeSize()), arg, context);
+          if (result != NULL)
+            result->vector ().segment (valueRows[i], f.outputSize()) =
+              values[i].vector ();
+        }
+
+        /// Identifier of the values in the contexts.
+        std::size_t scratch;
+        const Functions_t& functions;
+        LiegroupElement* result;
+        matrixOut_t* jacobian;
+        ConfigurationIn_t arg;
+        const std::vector<size_type>& valueRows;
+        const std::vector<size_type>& derivativeRows;
+        const std::vector<LiegroupElement>& init;
+        const std::vector<EvaluationContextPtr_t>& contexts;
+      };
+    } // namespace
+
+    void DifferentiableFunctionStack::parallel (WorkStealingPool* pool,
+                                                std::size_t minFunctions)
+    {
+      pool_ = pool;
+      minParallelFunctions_ = minFunctions;
+      workerContexts_.clear ();
+      if (pool_ == NULL) return;
+      workerContexts_.resize (pool_->size ());
+      for (std::size_t i = 0; i < workerContexts_.size (); ++i)
+        workerContexts_[i].reset (new EvaluationContext);
+    }
+
+    bool DifferentiableFunctionStack::remove
+    (const DifferentiableFunctionPtr_t& func)
+    {
+      Functions_t functions;
+      functions.swap (functions_);
+      result_.clear ();
+      valueRows_.clear ();
+      derivativeRows_.clear ();
+      outputSpace_ = LiegroupSpace::Rn (0);
+      activeParameters_.setConstant (false);
+      activeDerivativeParameters_.setConstant (false);
+
+      bool found = false;
+      for (Functions_t::const_iterator _f = functions.begin();
+          _f != functions.end(); ++_f) {
+        if (*_f == func) found = true;
+        else add (*_f);
+      }
+      return found;
+    }
+
+    void DifferentiableFunctionStack::evaluateInParallel
+    (LiegroupElement* result, matrixOut_t* jacobian, ConfigurationIn_t arg)
+      const
+    {
+      // The contexts are shared by the concurrent evaluations of the stack:
+      // the runs of the pool are serialized and a run nested in a task of
+      // the pool is executed by the thread of this task.
+      pool_->run (functions_.size (), EvaluationTask (resultScratch_,
+            functions_, result, jacobian, arg, valueRows_, derivativeRows_,
+            result_, workerContexts_));
+    }
+
     std::ostream& DifferentiableFunctionStack::print (std::ostream& os) const
     {
       DifferentiableFunction::print (os) << incindent;
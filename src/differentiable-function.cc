@@ -16,6 +16,8 @@
 
 #include <hpp/constraints/differentiable-function.hh>
 
+#include <boost/thread/mutex.hpp>
+
 #include <pinocchio/algorithm/finite-differences.hpp>
 
 #include <hpp/pinocchio/joint.hh>
@@ -23,11 +25,17 @@
 #include <hpp/pinocchio/configuration.hh>
 #include <hpp/pinocchio/liegroup.hh>
 
+#include <hpp/constraints/evaluation-context.hh>
+
 namespace hpp {
   namespace constraints {
     namespace {
       typedef std::vector<se3::JointIndex> JointIndexVector;
 
+      /// Serializes the evaluations in a context of the functions that do
+      /// not reimplement them.
+      boost::mutex legacyEvaluationMutex;
+
       struct FiniteDiffRobotOp
       {
         FiniteDiffRobotOp (const DevicePtr_t& r, const value_type& epsilon)
@@ -200,7 +208,7 @@ namespace hpp {
       activeParameters_ (ArrayXb::Constant (sizeInput, true)),
       activeDerivativeParameters_
       (ArrayXb::Constant (sizeInputDerivative, true)),
-      name_ (name)
+      name_ (name), jacobianScratch_ (EvaluationContext::newScratchId ())
       {
       }
 
@@ -212,8 +220,120 @@ namespace hpp {
       (ArrayXb::Constant (sizeInput, true)),
       activeDerivativeParameters_
       (ArrayXb::Constant (sizeInputDerivative, true)),
-      name_ (name), context_ ()
+      name_ (name), context_ (),
+      jacobianScratch_ (EvaluationContext::newScratchId ())
+    {
+    }
+
+    void DifferentiableFunction::impl_compute
+    (LiegroupElement& result, vectorIn_t argument, EvaluationContext&) const
     {
+      boost::mutex::scoped_lock lock (legacyEvaluationMutex);
+      impl_compute (result, argument);
+    }
+
+    void DifferentiableFunction::impl_jacobian
+    (matrixOut_t jacobian, vectorIn_t arg, EvaluationContext&) const
+    {
+      boost::mutex::scoped_lock lock (legacyEvaluationMutex);
+      impl_jacobian (jacobian, arg);
+    }
+
+    void DifferentiableFunction::impl_jacobianCompressed
+    (matrixOut_t jacobian, vectorIn_t arg) const
+    {
+      if (jacobianBuffer_.rows () != outputDerivativeSize () ||
+          jacobianBuffer_.cols () != inputDerivativeSize ())
+        jacobianBuffer_ = matrix_t::Zero (outputDerivativeSize (),
+                                          inputDerivativeSize ());
+      impl_jacobian (jacobianBuffer_, arg);
+      compressJacobian (jacobianBuffer_, jacobian);
+    }
+
+    void DifferentiableFunction::impl_jacobianCompressed
+    (matrixOut_t jacobian, vectorIn_t arg, EvaluationContext& context) const
+    {
+      matrix_t& J = context.scratch (jacobianScratch_, jacobianBuffer_);
+      if (J.rows () != outputDerivativeSize () ||
+          J.cols () != inputDerivativeSize ())
+        J = matrix_t::Zero (outputDerivativeSize (), inputDerivativeSize ());
+      impl_jacobian (J, arg, context);
+      compressJacobian (J, jacobian);
+    }
+
+    void DifferentiableFunction::impl_valueAndJacobian
+    (LiegroupElement& result, matrixOut_t jacobian, vectorIn_t arg) const
+    {
+      impl_compute (result, arg);
+      impl_jacobian (jacobian, arg);
+    }
+
+    void DifferentiableFunction::impl_valueAndJacobian
+    (LiegroupElement& result, matrixOut_t jacobian, vectorIn_t arg,
+     EvaluationContext& context) const
+    {
+      impl_compute (result, arg, context);
+      impl_jacobian (jacobian, arg, context);
+    }
+
+    void DifferentiableFunction::impl_valueAndJacobianCompressed
+    (LiegroupElement& result, matrixOut_t jacobian, vectorIn_t arg) const
+    {
+      if (jacobian.cols () == inputDerivativeSize ())
+        impl_valueAndJacobian (result, jacobian, arg);
+      else {
+        impl_compute (result, arg);
+        impl_jacobianCompressed (jacobian, arg);
+      }
+    }
+
+    void DifferentiableFunction::impl_valueAndJacobianCompressed
+    (LiegroupElement& result, matrixOut_t jacobian, vectorIn_t arg,
+     EvaluationContext& context) const
+    {
+      if (jacobian.cols () == inputDerivativeSize ())
+        impl_valueAndJacobian (result, jacobian, arg, context);
+      else {
+        impl_compute (result, arg, context);
+        impl_jacobianCompressed (jacobian, arg, context);
+      }
+    }
+
+    void DifferentiableFunction::legacyValueAndJacobian
+    (LiegroupElement& result, matrixOut_t jacobian, vectorIn_t arg,
+     EvaluationContext* context) const
+    {
+      boost::mutex::scoped_lock lock (legacyEvaluationMutex,
+                                      boost::defer_lock);
+      if (context) lock.lock ();
+      if (jacobian.cols () == inputDerivativeSize ()) {
+        impl_valueAndJacobian (result, jacobian, arg);
+        return;
+      }
+      matrix_t& J (context ?
+                   context->scratch (jacobianScratch_, jacobianBuffer_) :
+                   jacobianBuffer_);
+      if (J.rows () != outputDerivativeSize () ||
+          J.cols () != inputDerivativeSize ())
+        J = matrix_t::Zero (outputDerivativeSize (), inputDerivativeSize ());
+      impl_valueAndJacobian (result, J, arg);
+      compressJacobian (J, jacobian);
+    }
+
+    void DifferentiableFunction::compressJacobian
+    (matrixIn_t jacobian, matrixOut_t compressed) const
+    {
+      const ArrayXb& adp = activeDerivativeParameters_;
+      size_type col = 0, i = 0;
+      while (i < adp.size ()) {
+        if (!adp[i]) { ++i; continue; }
+        size_type j = i + 1;
+        while (j < adp.size () && adp[j]) ++j;
+        compressed.middleCols (col, j - i) = jacobian.middleCols (i, j - i);
+        col += j - i;
+        i = j;
+      }
+      assert (col == compressed.cols ());
     }
 
     std::ostream& DifferentiableFunction::print (std::ostream& o) const
@@ -26,6 +26,8 @@
 #include <hpp/pinocchio/device.hh>
 #include <hpp/pinocchio/joint.hh>
 
+#include <hpp/constraints/evaluation-context.hh>
+
 namespace hpp {
   namespace constraints {
 
@@ -147,5 +149,56 @@ namespace hpp {
       }
     }
 
+    void DistanceBetweenPointsInBodies::impl_compute
+    (LiegroupElement& result, ConfigurationIn_t argument,
+     EvaluationContext& context) const
+    {
+      context.computeForwardKinematics (robot_, argument, false);
+      const vector3_t global1
+        (context.currentTransformation (robot_, joint1_).act (point1_));
+      if (joint2_) {
+        const vector3_t global2
+          (context.currentTransformation (robot_, joint2_).act (point2_));
+        result.vector () [0] = (global2 - global1).norm ();
+      } else {
+        result.vector () [0] = (          global1).norm ();
+      }
+    }
+
+    void DistanceBetweenPointsInBodies::impl_jacobian
+    (matrixOut_t jacobian, ConfigurationIn_t arg,
+     EvaluationContext& context) const
+    {
+      context.computeForwardKinematics (robot_, arg, true);
+      LiegroupElement dist (outputSpace ());
+      impl_compute (dist, arg, context);
+      const JointJacobian_t& J1 (context.jacobian (robot_, joint1_));
+      const Transform3f& M1 (context.currentTransformation (robot_, joint1_));
+      const matrix3_t& R1 (M1.rotation());
+      const vector3_t global1 (M1.act (point1_));
+      vector3_t global2 (point2_);
+      if (joint2_)
+        global2 = context.currentTransformation (robot_, joint2_).act (point2_);
+
+      vector3_t P1_minus_P2 (global1 - global2);
+      vector3_t P1_minus_t1 (global1 - M1.translation ());
+      matrix_t tmp1
+	(P1_minus_P2.transpose () * R1 * J1.topRows (3)
+         + P1_minus_P2.transpose () * R1.colwise().cross(P1_minus_t1) * J1.bottomRows (3));
+      if (joint2_) {
+        const JointJacobian_t& J2 (context.jacobian (robot_, joint2_));
+        const Transform3f& M2 (context.currentTransformation (robot_, joint2_));
+        const matrix3_t& R2 (M2.rotation());
+	vector3_t P2_minus_t2 (global2 - M2.translation ());
+	matrix_t tmp2
+	  (P1_minus_P2.transpose () * R2 * J2.topRows (3)
+           + P1_minus_P2.transpose () * R2.colwise().cross(P2_minus_t2) * J2.bottomRows (3));
+	jacobian.leftCols (J1.cols ()) = (tmp1 - tmp2)/dist.vector () [0];
+      } else {
+	jacobian.leftCols (J1.cols ()) = tmp1/dist.vector () [0];
+      }
+      jacobian.rightCols (jacobian.cols () - J1.cols ()).setZero ();
+    }
+
   } // namespace constraints
 } // namespace hpp
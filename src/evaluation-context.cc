@@ -0,0 +1,148 @@
+// Copyright (c) 2018, Joseph Mirabel
+// Authors: Joseph Mirabel (joseph.mirabel@laas.fr)
+//
+// This file is part of hpp-constraints.
+// hpp-constraints is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-constraints is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-constraints. If not, see <http://www.gnu.org/licenses/>.
+
+#include <hpp/constraints/evaluation-context.hh>
+
+#include <boost/thread/mutex.hpp>
+
+#include <pinocchio/multibody/model.hpp>
+#include <pinocchio/multibody/data.hpp>
+#include <pinocchio/algorithm/kinematics.hpp>
+#include <pinocchio/algorithm/jacobian.hpp>
+
+#include <hpp/pinocchio/device.hh>
+#include <hpp/pinocchio/joint.hh>
+
+namespace hpp {
+  namespace constraints {
+    namespace {
+      /// Protects lastScratchId.
+      boost::mutex scratchIdMutex;
+      std::size_t lastScratchId = 0;
+    } // namespace
+
+    struct EvaluationContext::RobotData
+    {
+      RobotData (const DevicePtr_t& r) :
+        robot (r), data (r->model()), version (0), hasJacobians (false),
+        jacobians (r->model().joints.size()),
+        jacobianUpToDate (r->model().joints.size(), false)
+      {}
+
+      /// Keeps the model alive.
+      DevicePtr_t robot;
+      se3::Data data;
+      /// Configuration of the last forward kinematics computation.
+      vector_t q;
+      /// EvaluationContext::version_ of the last forward kinematics
+      /// computation.
+      std::size_t version;
+      bool hasJacobians;
+      /// Joint Jacobians, computed on demand.
+      std::vector<JointJacobian_t> jacobians;
+      std::vector<bool> jacobianUpToDate;
+    };
+
+    EvaluationContext::EvaluationContext () :
+      lastRobot_ (NULL), lastRobotData_ (NULL), version_ (0),
+      locked_ (false), lockedWithJacobians_ (false), forwardKinematicsCount_ (0)
+    {}
+
+    EvaluationContext::~EvaluationContext ()
+    {
+      for (RobotDatas_t::iterator _rd = robotDatas_.begin ();
+          _rd != robotDatas_.end (); ++_rd)
+        delete _rd->second;
+      clearScratches ();
+    }
+
+    std::size_t EvaluationContext::newScratchId ()
+    {
+      boost::mutex::scoped_lock lock (scratchIdMutex);
+      return ++lastScratchId;
+    }
+
+    void EvaluationContext::clearScratches ()
+    {
+      for (Scratches_t::iterator _s = scratches_.begin ();
+          _s != scratches_.end (); ++_s)
+        delete _s->second;
+      scratches_.clear ();
+    }
+
+    EvaluationContext::RobotData& EvaluationContext::robotData
+    (const DevicePtr_t& robot) const
+    {
+      if (robot.get() == lastRobot_) return *lastRobotData_;
+      RobotData*& rd = robotDatas_[robot.get()];
+      if (rd == NULL) rd = new RobotData (robot);
+      lastRobot_ = robot.get();
+      lastRobotData_ = rd;
+      return *rd;
+    }
+
+    void EvaluationContext::computeForwardKinematics
+    (const DevicePtr_t& robot, vectorIn_t q, bool jacobians)
+    {
+      RobotData& rd = robotData (robot);
+      const se3::Model& model = robot->model();
+      // The extra configuration space is not part of the pinocchio model.
+      const vectorIn_t qModel (q.head (model.nq));
+      if (locked_) {
+        if (rd.version == version_ && (rd.hasJacobians || !jacobians))
+          return;
+        jacobians = jacobians || lockedWithJacobians_;
+      } else if (rd.q.size() == model.nq && rd.q == qModel
+          && (rd.hasJacobians || !jacobians))
+        return;
+
+      ++forwardKinematicsCount_;
+      rd.version = version_;
+      if (jacobians)
+        se3::computeJacobians (model, rd.data, qModel);
+      else
+        se3::forwardKinematics (model, rd.data, qModel);
+      rd.q = qModel;
+      rd.hasJacobians = jacobians;
+      rd.jacobianUpToDate.assign (rd.jacobianUpToDate.size(), false);
+    }
+
+    const Transform3f& EvaluationContext::currentTransformation
+    (const DevicePtr_t& robot, const JointConstPtr_t& joint) const
+    {
+      const RobotData& rd = robotData (robot);
+      assert (rd.q.size() == robot->model().nq);
+      return rd.data.oMi [joint->index()];
+    }
+
+    const JointJacobian_t& EvaluationContext::jacobian
+    (const DevicePtr_t& robot, const JointConstPtr_t& joint) const
+    {
+      RobotData& rd = robotData (robot);
+      assert (rd.hasJacobians);
+      const se3::JointIndex i = joint->index();
+      JointJacobian_t& J = rd.jacobians [i];
+      if (!rd.jacobianUpToDate [i]) {
+        const se3::Model& model = robot->model();
+        if (J.cols() != model.nv) J.resize (6, model.nv);
+        J.setZero ();
+        se3::getJacobian<true> (model, rd.data, i, J);
+        rd.jacobianUpToDate [i] = true;
+      }
+      return J;
+    }
+  } // namespace constraints
+} // namespace hpp
@@ -0,0 +1,154 @@
+// Copyright (c) 2018, Joseph Mirabel
+// Authors: Joseph Mirabel (joseph.mirabel@laas.fr)
+//
+// This file is part of hpp-constraints.
+// hpp-constraints is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-constraints is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-constraints. If not, see <http://www.gnu.org/licenses/>.
+
+#include <hpp/constraints/explicit-relative-transformation.hh>
+
+#include <pinocchio/multibody/model.hpp>
+
+#include <hpp/pinocchio/device.hh>
+#include <hpp/pinocchio/joint.hh>
+#include <hpp/pinocchio/liegroup-space.hh>
+
+#include <hpp/constraints/evaluation-context.hh>
+
+namespace hpp {
+  namespace constraints {
+    namespace {
+      /// Add the parameters of joint and of its ancestors.
+      void ancestorParameters (const se3::Model& model, se3::JointIndex i,
+          Eigen::RowBlockIndices& args, Eigen::ColBlockIndices& ders)
+      {
+        for (; i > 0; i = model.parents[i]) {
+          args.addRow (model.joints[i].idx_q(), model.joints[i].nq());
+          ders.addCol (model.joints[i].idx_v(), model.joints[i].nv());
+        }
+        args.updateRows<true, true, true> ();
+        ders.updateIndices<true, true, true> ();
+      }
+    }
+
+    ExplicitRelativeTransformationPtr_t ExplicitRelativeTransformation::create
+    (const std::string& name, const DevicePtr_t& robot,
+     const JointConstPtr_t& joint1, const JointConstPtr_t& joint2,
+     const Transform3f& frame1, const Transform3f& frame2)
+    {
+      ExplicitRelativeTransformation* ptr = new ExplicitRelativeTransformation
+        (name, robot, joint1, joint2, frame1, frame2);
+      return ExplicitRelativeTransformationPtr_t (ptr);
+    }
+
+    bool ExplicitRelativeTransformation::isExplicit (const DevicePtr_t& robot,
+        const JointConstPtr_t& joint1, const JointConstPtr_t& joint2)
+    {
+      if (!joint2) return false;
+      const se3::Model& model = robot->model();
+      const se3::JointIndex i2 = joint2->index();
+      // Free-flyer attached to the world
+      if (model.parents[i2] != 0 ||
+          model.joints[i2].nq() != 7 || model.joints[i2].nv() != 6)
+        return false;
+      if (!joint1) return true;
+      for (se3::JointIndex i = joint1->index(); i > 0; i = model.parents[i])
+        if (i == i2) return false;
+      return true;
+    }
+
+    ExplicitRelativeTransformation::ExplicitRelativeTransformation
+    (const std::string& name, const DevicePtr_t& robot,
+     const JointConstPtr_t& joint1, const JointConstPtr_t& joint2,
+     const Transform3f& frame1, const Transform3f& frame2) :
+      DifferentiableFunction (0, 0, LiegroupSpace::SE3 (), name),
+      robot_ (robot), joint1_ (joint1), joint2_ (joint2),
+      config_ (robot->neutralConfiguration ()),
+      configScratch_ (EvaluationContext::newScratchId ()),
+      J1Scratch_ (EvaluationContext::newScratchId ()),
+      context_ (new EvaluationContext)
+    {
+      assert (isExplicit (robot, joint1, joint2));
+      const se3::Model& model = robot->model();
+      left_ = model.jointPlacements[joint2->index()].inverse();
+      right_ = frame1 * frame2.inverse();
+      action_ = right_.inverse().toActionMatrix();
+
+      if (joint1) ancestorParameters (model, joint1->index(), inArg_, inDer_);
+      outArg_.addRow (joint2->rankInConfiguration(), 7);
+      outDer_.addRow (joint2->rankInVelocity(), 6);
+
+      inputSize_ = inArg_.nbIndices();
+      inputDerivativeSize_ = inDer_.nbIndices();
+      J1_.resize (6, inputDerivativeSize_);
+      activeParameters_ = ArrayXb::Constant (inputSize_, true);
+      activeDerivativeParameters_ =
+        ArrayXb::Constant (inputDerivativeSize_, true);
+    }
+
+    void ExplicitRelativeTransformation::setValue (const Transform3f& M1,
+        LiegroupElement& result) const
+    {
+      const Transform3f M2 (left_ * M1 * right_);
+      result.vector ().head<3> () = M2.translation ();
+      result.vector ().tail<4> () =
+        Eigen::Quaternion<value_type> (M2.rotation ()).coeffs ();
+    }
+
+    void ExplicitRelativeTransformation::setJacobian
+    (const JointJacobian_t& J1, matrix_t& J1in, matrixOut_t jacobian) const
+    {
+      // The velocity of joint 2 is the velocity of joint 1 expressed in
+      // frame right_.
+      J1in = inDer_.rview (J1);
+      jacobian.noalias() = action_ * J1in;
+    }
+
+    void ExplicitRelativeTransformation::impl_compute
+    (LiegroupElement& result, ConfigurationIn_t argument) const throw ()
+    {
+      impl_compute (result, argument, *context_);
+    }
+
+    void ExplicitRelativeTransformation::impl_jacobian
+    (matrixOut_t jacobian, ConfigurationIn_t argument) const throw ()
+    {
+      impl_jacobian (jacobian, argument, *context_);
+    }
+
+    void ExplicitRelativeTransformation::impl_compute
+    (LiegroupElement& result, ConfigurationIn_t argument,
+     EvaluationContext& context) const
+    {
+      if (!joint1_) {
+        setValue (Transform3f::Identity (), result);
+        return;
+      }
+      Configuration_t& q = context.scratch (configScratch_, config_);
+      inArg_.lview (q) = argument;
+      context.computeForwardKinematics (robot_, q, false);
+      setValue (context.currentTransformation (robot_, joint1_), result);
+    }
+
+    void ExplicitRelativeTransformation::impl_jacobian
+    (matrixOut_t jacobian, ConfigurationIn_t argument,
+     EvaluationContext& context) const
+    {
+      if (!joint1_) return;
+      Configuration_t& q = context.scratch (configScratch_, config_);
+      inArg_.lview (q) = argument;
+      context.computeForwardKinematics (robot_, q, true);
+      matrix_t& J1 = context.scratch (J1Scratch_, J1_);
+      setJacobian (context.jacobian (robot_, joint1_), J1, jacobian);
+    }
+  } // namespace constraints
+} // namespace hpp
@@ -16,14 +16,19 @@
 
 #include <hpp/constraints/explicit-solver.hh>
 
+#include <map>
 #include <queue>
 
+#include <boost/bind.hpp>
+
 #include <hpp/util/indent.hh>
 
 #include <hpp/pinocchio/util.hh>
 #include <hpp/pinocchio/device.hh>
 #include <hpp/pinocchio/liegroup.hh>
 
+#include <hpp/constraints/affine-function.hh>
+#include <hpp/constraints/evaluation-context.hh>
 #include <hpp/constraints/matrix-view.hh>
 
 
@@ -37,6 +42,46 @@ namespace hpp {
           for (size_type j = 0; j < rbi.indices()[i].second; ++j)
             q.push(rbi.indices()[i].first + j);
       }
+
+      /// Add rows after the last segment of rows, merging adjacent
+      /// segments. Unlike updateRows, the order of the rows is kept.
+      void pushRows (Eigen::RowBlockIndices& rows, size_type first,
+                     size_type size)
+      {
+        segments_t& segments = rows.m_rows;
+        if (!segments.empty () &&
+            segments.back ().first + segments.back ().second == first)
+          segments.back ().second += size;
+        else
+          segments.push_back (segment_t (first, size));
+      }
+
+      /// Rank of each index of segments, -1 for the other indices.
+      Eigen::VectorXi ranks (const segments_t& segments, size_type size)
+      {
+        Eigen::VectorXi rank (Eigen::VectorXi::Constant (size, -1));
+        int r = 0;
+        for (std::size_t i = 0; i < segments.size (); ++i)
+          for (size_type j = 0; j < segments[i].second; ++j)
+            rank[segments[i].first + j] = r++;
+        return rank;
+      }
+
+      /// Evaluate f in context, if not NULL.
+      inline void evaluate (const DifferentiableFunctionPtr_t& f,
+          LiegroupElement& result, vectorIn_t arg, EvaluationContext* context)
+      {
+        if (context) f->value (result, arg, *context);
+        else         f->value (result, arg);
+      }
+
+      /// Compute the jacobian of f in context, if not NULL.
+      inline void evaluateJacobian (const DifferentiableFunctionPtr_t& f,
+          matrixOut_t J, vectorIn_t arg, EvaluationContext* context)
+      {
+        if (context) f->jacobian (J, arg, *context);
+        else         f->jacobian (J, arg);
+      }
     }
 
     Eigen::ColBlockIndices ExplicitSolver::activeParameters () const
@@ -49,30 +94,182 @@ namespace hpp {
       return inDers_;
     }
 
-    bool ExplicitSolver::solve (vectorOut_t arg) const
+    ExplicitSolver::Workspace::FunctionData::FunctionData
+    (const DifferentiableFunctionPtr_t& f, const DifferentiableFunctionPtr_t& g)
+      : qin (f->inputSize ()), qout (f->outputSpace ()->nq ()),
+      value (f->outputSpace ()), expected (f->outputSpace ()),
+      jacobian (f->outputDerivativeSize(), f->inputDerivativeSize())
+    {
+      size_type n = (g ? g->outputSpace()->nv() : 0);
+      jGinv.resize (n,n);
+    }
+
+    void ExplicitSolver::allocate (Workspace& ws) const
     {
+      // Rows of the compact jacobian and columns of Jg
+      const Eigen::VectorXi outRank (ranks (outDers_.indices(), derSize_)),
+        inRank (ranks (inDers_.indices(), derSize_));
+
+      ws.functions.clear ();
+      ws.functions.reserve (functions_.size ());
       for(std::size_t i = 0; i < functions_.size(); ++i) {
-        computeFunction(computationOrder_[i], arg);
+        const Function& f = functions_[i];
+        ws.functions.push_back (Workspace::FunctionData (f.f, f.g));
+        Workspace::FunctionData& d = ws.functions.back();
+        // The rows of Jg of the free inputs are constant.
+        d.Jg.setZero (f.inDer.nbIndices(), inDers_.nbIndices());
+        size_type row = 0;
+        for (std::size_t k = 0; k < f.inDer.indices().size(); ++k) {
+          const segment_t& segment = f.inDer.indices()[k];
+          for (size_type j = segment.first; j < segment.first + segment.second;
+              ++j, ++row) {
+            if (outRank[j] >= 0) {
+              pushRows (d.computedInputs, row, 1);
+              pushRows (d.computedInputRows, outRank[j], 1);
+            } else
+              d.Jg (row, inRank[j]) = 1;
+          }
+        }
+        d.computedInputs.updateRows<false, false, true> ();
+        d.computedInputRows.updateRows<false, false, true> ();
+        for (std::size_t k = 0; k < f.outDer.indices().size(); ++k)
+          for (size_type j = 0; j < f.outDer.indices()[k].second; ++j)
+            pushRows (d.outputRows, outRank[f.outDer.indices()[k].first + j],
+                      1);
+        d.outputRows.updateRows<false, false, true> ();
+        // The jacobian of a constant function stays zero.
+        d.outJacobian.setZero (f.outDer.nbIndices(), inDers_.nbIndices());
+        if (f.ginv) d.tmpJacobian.resize (d.jacobian.rows(), d.jacobian.cols());
+      }
+      ws.diffSmall.resize(outDers_.nbIndices());
+      ws.Je.setZero (outDers_.nbIndices(), inDers_.nbIndices());
+      allocateWorkerContexts (ws);
+      // Release the scratch data of the functions the solver does not use
+      // anymore.
+      if (ws.context) ws.context->clearScratches ();
+      for (std::size_t i = 0; i < ws.workerContexts.size (); ++i)
+        ws.workerContexts[i]->clearScratches ();
+      invalidate (ws);
+    }
+
+    void ExplicitSolver::allocateWorkerContexts (Workspace& ws) const
+    {
+      const std::size_t n = callerWorker ();
+      if (ws.workerContexts.size () == n) return;
+      ws.workerContexts.resize (n);
+      for (std::size_t i = 0; i < n; ++i)
+        if (!ws.workerContexts[i])
+          ws.workerContexts[i].reset (new EvaluationContext);
+    }
+
+    void ExplicitSolver::invalidate (Workspace& ws) const
+    {
+      ws.solvedArg.resize (0);
+      ws.jacobianArg.resize (0);
+      ws.solvedVersion = ws.jacobianVersion = version_;
+    }
+
+    void ExplicitSolver::changedFunctions (vectorIn_t arg, vector_t& lastArg,
+        std::size_t& lastVersion, std::vector<bool>& changed) const
+    {
+      const bool all = (lastArg.size() != arg.size() || lastVersion != version_);
+      changed.assign (functions_.size(), all);
+      if (!all) {
+        for(std::size_t k = 0; k < functions_.size(); ++k) {
+          const std::size_t iF = computationOrder_[k];
+          const RowBlockIndices::segments_t& segs = functions_[iF].inArg.indices();
+          bool c = false;
+          for (std::size_t i = 0; !c && i < segs.size(); ++i) {
+            for (size_type j = segs[i].first;
+                !c && j < segs[i].first + segs[i].second; ++j) {
+              if (argFunction_[j] < 0) c = (arg[j] != lastArg[j]);
+              else                     c = changed[argFunction_[j]];
+            }
+          }
+          changed[iF] = c;
+        }
+      }
+      lastArg = arg;
+      lastVersion = version_;
+    }
+
+    bool ExplicitSolver::solve (vectorOut_t arg, Workspace& ws) const
+    {
+      changedFunctions (arg, ws.solvedArg, ws.solvedVersion, ws.changed);
+      constantArgs_.lview(arg) = constantValue_;
+      if (isParallel ()) {
+        allocateWorkerContexts (ws);
+        for (std::size_t w = 0; w < wavefronts_.size(); ++w)
+          runWavefront (wavefronts_[w].size(), boost::bind
+              (&ExplicitSolver::solveTask, this, boost::cref (wavefronts_[w]),
+               arg, boost::ref (ws), _1, _2));
+        return true;
       }
+      for(std::size_t i = 0; i < functions_.size(); ++i)
+        solveTask (computationOrder_, arg, ws, i, callerWorker ());
       return true;
     }
 
-    bool ExplicitSolver::isSatisfied (vectorIn_t arg, vectorOut_t error) const
+    void ExplicitSolver::parallel (WorkStealingPool* pool,
+                                   std::size_t minFunctions)
+    {
+      pool_ = pool;
+      minParallelFunctions_ = minFunctions;
+    }
+
+    bool ExplicitSolver::isParallel () const
+    {
+      return pool_ != NULL && functions_.size () >= minParallelFunctions_;
+    }
+
+    EvaluationContext* ExplicitSolver::context (const Workspace& ws,
+                                                std::size_t worker) const
+    {
+      if (worker < ws.workerContexts.size ())
+        return ws.workerContexts[worker].get();
+      return ws.context.get();
+    }
+
+    void ExplicitSolver::runWavefront (std::size_t nbTasks,
+        const WorkStealingPool::Task_t& task) const
+    {
+      // A single task is not worth the synchronization. It is run by the
+      // calling thread, in the context of the workspace.
+      if (nbTasks == 0) return;
+      if (nbTasks == 1) task (0, callerWorker ());
+      else pool_->run (nbTasks, task);
+    }
+
+    void ExplicitSolver::solveTask (const std::vector<std::size_t>& order,
+        vectorOut_t arg, Workspace& ws, std::size_t i, std::size_t worker)
+      const
+    {
+      const std::size_t iF = order[i];
+      if (functions_[iF].constant) return;
+      if (ws.changed[iF])
+        computeFunction(iF, arg, ws, context (ws, worker));
+      else
+        functions_[iF].outArg.lview(arg) = ws.functions[iF].output;
+    }
+
+    bool ExplicitSolver::isSatisfied (vectorIn_t arg, vectorOut_t error,
+                                      Workspace& ws) const
     {
       value_type squaredNorm = 0;
 
       size_type row = 0;
       for(std::size_t i = 0; i < functions_.size(); ++i) {
         const Function& f = functions_[i];
+        Workspace::FunctionData& d = ws.functions[i];
         // Compute this function
-        f.qin = f.inArg.rview(arg);
-        f.f->value(f.value, f.qin);
-        f.value += f.rightHandSide;
+        d.qin = f.inArg.rview(arg);
+        evaluate (f.f, d.value, d.qin, ws.context.get());
+        d.value += f.rightHandSide;
         const size_type& nbRows = f.outDer.nbRows();
-        f.qout = f.outArg.rview(arg);
-        if (f.g) f.g->value(f.expected, f.qout);
-        else     f.expected.vector() = f.qout;
-        error.segment (row, nbRows) = f.expected - f.value;
+        d.qout = f.outArg.rview(arg);
+        if (f.g) evaluate (f.g, d.expected, d.qout, ws.context.get());
+        else     d.expected.vector() = d.qout;
+        error.segment (row, nbRows) = d.expected - d.value;
         squaredNorm = std::max(squaredNorm,
             error.segment (row, nbRows).squaredNorm ());
         row += nbRows;
@@ -82,10 +279,9 @@ namespace hpp {
       return squaredNorm < squaredErrorThreshold_;
     }
 
-    bool ExplicitSolver::isSatisfied (vectorIn_t arg) const
+    bool ExplicitSolver::isSatisfied (vectorIn_t arg, Workspace& ws) const
     {
-      diffSmall_.resize(outDers_.nbIndices());
-      return isSatisfied (arg, diffSmall_);
+      return isSatisfied (arg, ws.diffSmall, ws);
     }
 
     ExplicitSolver::Function::Function (DifferentiableFunctionPtr_t _f,
@@ -95,9 +291,8 @@ namespace hpp {
       f (_f), inArg (ia), outArg (oa), inDer (id), outDer (od),
       comparison (comp),
       rightHandSide (vector_t::Zero(f->outputSpace()->nv())),
-      value (f->outputSpace ()), expected (f->outputSpace ())
+      constant (false)
     {
-      jacobian.resize(_f->outputDerivativeSize(), _f->inputDerivativeSize());
       for (std::size_t i = 0; i < comp.size(); ++i) {
         switch (comp[i]) {
           case Equality:
@@ -123,8 +318,6 @@ namespace hpp {
           );
       g = _g;
       ginv = _ginv;
-      size_type n = (g ? g->outputSpace()->nv() : 0);
-      jGinv.resize (n,n);
     }
 
     size_type ExplicitSolver::add (const DifferentiableFunctionPtr_t& f,
@@ -143,6 +336,33 @@ namespace hpp {
         const ColBlockIndices& inDer,
         const RowBlockIndices& outDer,
         const ComparisonTypes_t& comp)
+    {
+      size_type idx = addFunction (f, inArg, outArg, inDer, outDer, comp);
+      if (idx >= 0) update ();
+      return idx;
+    }
+
+    std::vector<size_type> ExplicitSolver::add
+    (const std::vector<Explicit>& functions)
+    {
+      std::vector<size_type> indices (functions.size());
+      for (std::size_t i = 0; i < functions.size(); ++i) {
+        const Explicit& e = functions[i];
+        indices[i] = addFunction (e.f, e.inArg, e.outArg, e.inDer, e.outDer,
+            e.comparison.empty() ?
+            ComparisonTypes_t(e.f->outputDerivativeSize(), EqualToZero) :
+            e.comparison);
+      }
+      update ();
+      return indices;
+    }
+
+    size_type ExplicitSolver::addFunction (const DifferentiableFunctionPtr_t& f,
+        const RowBlockIndices& inArg,
+        const RowBlockIndices& outArg,
+        const ColBlockIndices& inDer,
+        const RowBlockIndices& outDer,
+        const ComparisonTypes_t& comp)
     {
       assert (outArg.indices().size() == 1 && "Only contiguous function output is supported.");
       assert (outDer.indices().size() == 1 && "Only contiguous function output is supported.");
@@ -183,42 +403,66 @@ namespace hpp {
       outDer.lview(derFunction_).setConstant(idx);
       functions_.push_back (Function(f, inArg, outArg, inDer, outDer, comp));
 
-      // Update the free dofs
-      outArgs_.addRow(outIdx.first, outIdx.second);
-      outArgs_.updateIndices<true, true, true>();
+      // If f computes the input of a function, this function is not
+      // computed after f anymore.
+      reorder_ = reorder_ ||
+        derIsInput_.segment (outDerIdx.first, outDerIdx.second).any();
+      for (std::size_t i = 0; i < inDer.indices().size(); ++i)
+        derIsInput_.segment (inDer.indices()[i].first,
+                             inDer.indices()[i].second).setConstant (true);
+
+      // Insertions of the variables
+      outArgSet_.insert (outIdx);
+      inArgSet_.insert (inArg.rows());
+      outDerSet_.insert (outDerIdx);
+      inDerSet_.insert (inDer.cols());
+      return idx;
+    }
+
+    void ExplicitSolver::update ()
+    {
+      // Update the free dofs. The segments of the interval sets are
+      // sorted and shrunk, and so are their differences.
+      outArgs_ = RowBlockIndices (outArgSet_.segments ());
       freeArgs_ = RowBlockIndices
         (BlockIndex::difference (BlockIndex::segment_t(0, argSize_),
                                  outArgs_.indices()));
-
-      BlockIndex::add (inArgs_.m_rows, inArg.rows());
       inArgs_ = RowBlockIndices
-        (BlockIndex::difference (inArgs_.rows(), outArgs_.rows()));
-      // should be sorted already
-      inArgs_.updateIndices<false, true, true>();
+        (BlockIndex::difference (inArgSet_.segments (), outArgs_.rows()));
 
-      outDers_.addRow(outDerIdx.first, outDerIdx.second);
-      outDers_.updateIndices<true, true, true>();
+      outDers_ = RowBlockIndices (outDerSet_.segments ());
       freeDers_ = ColBlockIndices
         (BlockIndex::difference(BlockIndex::segment_t(0, derSize_),
                                 outDers_.indices()));
-
-      BlockIndex::add (inDers_.m_cols, inDer.cols());
       inDers_ = ColBlockIndices
-        (BlockIndex::difference (inDers_.cols(), outDers_.rows()));
-      // should be sorted already
-      inDers_.updateIndices<false, true, true>();
+        (BlockIndex::difference (inDerSet_.segments (), outDers_.rows()));
+
+      computeConstants ();
 
       /// Computation order
-      std::size_t order = 0;
-      computationOrder_.resize(functions_.size());
-      inOutDependencies_ = Eigen::MatrixXi::Zero(functions_.size(), derSize_);
-      Computed_t computed(functions_.size(), false);
-      for(std::size_t i = 0; i < functions_.size(); ++i)
-        computeOrder(i, order, computed);
-      assert(order == functions_.size());
-      return functions_.size() - 1;
+      dependencies_.resize (functions_.size());
+      functionWavefront_.resize (functions_.size());
+      if (reorder_) {
+        std::size_t order = 0;
+        computationOrder_.resize(functions_.size());
+        wavefronts_.clear ();
+        Computed_t computed(functions_.size(), false);
+        for(std::size_t i = 0; i < functions_.size(); ++i)
+          computeOrder(i, order, computed);
+        assert(order == functions_.size());
+      } else {
+        // The new functions do not compute the input of the other ones:
+        // they are computed last, in the order they were added.
+        for(std::size_t i = orderedFunctions_; i < functions_.size(); ++i) {
+          computeDependencies (i);
+          computationOrder_.push_back (i);
+        }
+      }
+      orderedFunctions_ = functions_.size();
+      reorder_ = false;
+      ++version_;
+      workspaceAllocated_ = false;
     }
-
     bool ExplicitSolver::setG (const DifferentiableFunctionPtr_t& df,
         const DifferentiableFunctionPtr_t& g,
         const DifferentiableFunctionPtr_t& ginv)
@@ -227,6 +471,9 @@ namespace hpp {
         Function& f = functions_[i];
         if (f.f == df) {
           f.setG (g, ginv);
+          // f may not be constant anymore.
+          reorder_ = true;
+          update ();
           return true;
         }
       }
@@ -244,54 +491,109 @@ namespace hpp {
       for(std::size_t i = 0; i < functions_.size(); ++i) {
         if (functions_[i].f == oldf) {
           functions_[i].f = newf;
+          reorder_ = true;
+          update ();
           return true;
         }
       }
       return false;
     }
 
-    void ExplicitSolver::computeFunction(const std::size_t& iF, vectorOut_t arg) const
+    void ExplicitSolver::computeFunction(const std::size_t& iF, vectorOut_t arg,
+        Workspace& ws, EvaluationContext* context) const
     {
       const Function& f = functions_[iF];
+      Workspace::FunctionData& d = ws.functions[iF];
       // Compute this function
-      f.qin = f.inArg.rview(arg);
-      f.f->value(f.value, f.qin);
-      f.value += f.rightHandSide;
-      if (f.ginv) f.ginv->value (f.expected, f.value.vector());
-      else        f.expected.vector() = f.value.vector();
-      f.outArg.lview(arg) = f.expected.vector();
+      d.qin = f.inArg.rview(arg);
+      evaluate (f.f, d.value, d.qin, context);
+      d.value += f.rightHandSide;
+      if (f.ginv) evaluate (f.ginv, d.expected, d.value.vector(), context);
+      else        d.expected.vector() = d.value.vector();
+      d.output = d.expected.vector();
+      f.outArg.lview(arg) = d.output;
     }
 
-    void ExplicitSolver::jacobian(matrixOut_t jacobian, vectorIn_t arg) const
+    void ExplicitSolver::jacobian(matrixOut_t jacobian, vectorIn_t arg,
+                                  Workspace& ws) const
     {
-      // TODO this could be done only on the complement of inDers_
       jacobian.setZero();
       MatrixBlocksRef (freeDers_, freeDers_)
         .lview (jacobian).setIdentity();
-      // Compute the function jacobians
-      for(std::size_t i = 0; i < functions_.size(); ++i) {
-        const Function& f = functions_[i];
-        f.qin = f.inArg.rview(arg);
-        if (f.ginv) f.f->value(f.value, f.qin);
-        f.f->jacobian(f.jacobian, f.qin);
-        if (f.equalityIndices.nbIndices() > 0)
-          f.f->outputSpace ()->Jintegrate (f.rightHandSide, f.jacobian);
-        if (f.ginv) {
-          f.value += f.rightHandSide;
-          f.ginv->jacobian(f.jGinv, f.value.vector());
-          f.jacobian.applyOnTheLeft(f.jGinv);
+      compactJacobian (ws.Je, arg, ws);
+      MatrixBlocksRef (outDers_, inDers_).lview (jacobian) = ws.Je;
+    }
+
+    void ExplicitSolver::compactJacobian (matrixOut_t jacobian, vectorIn_t arg,
+                                          Workspace& ws) const
+    {
+      assert (jacobian.rows() == outDers_.nbIndices()
+              && jacobian.cols() == inDers_.nbIndices());
+      // Compute the jacobians of the functions whose input changed
+      changedFunctions (arg, ws.jacobianArg, ws.jacobianVersion, ws.changed);
+      if (isParallel ()) {
+        allocateWorkerContexts (ws);
+        runWavefront (functions_.size(), boost::bind
+            (&ExplicitSolver::functionJacobianTask, this, arg,
+             boost::ref (ws), _1, _2));
+        // Constant functions belong to no wavefront. Their rows are read
+        // by the functions they compute the input of.
+        for (std::size_t i = 0; i < functions_.size(); ++i) {
+          if (!functions_[i].constant) continue;
+          const Workspace::FunctionData& d = ws.functions[i];
+          d.outputRows.lview (jacobian) = d.outJacobian;
         }
+        for (std::size_t w = 0; w < wavefronts_.size(); ++w)
+          runWavefront (wavefronts_[w].size(), boost::bind
+              (&ExplicitSolver::jacobianTask, this,
+               boost::cref (wavefronts_[w]), jacobian, boost::ref (ws),
+               _1, _2));
+        return;
       }
-      for(std::size_t i = 0; i < functions_.size(); ++i) {
-        computeJacobian(computationOrder_[i], jacobian);
+      for(std::size_t i = 0; i < functions_.size(); ++i)
+        functionJacobianTask (arg, ws, i, callerWorker ());
+      for(std::size_t i = 0; i < functions_.size(); ++i)
+        jacobianTask (computationOrder_, jacobian, ws, i, callerWorker ());
+    }
+
+    void ExplicitSolver::functionJacobianTask (vectorIn_t arg, Workspace& ws,
+        std::size_t i, std::size_t worker) const
+    {
+      // The jacobian of a constant function is zero.
+      if (!ws.changed[i] || functions_[i].constant) return;
+      EvaluationContext* c = context (ws, worker);
+      const Function& f = functions_[i];
+      Workspace::FunctionData& d = ws.functions[i];
+      d.qin = f.inArg.rview(arg);
+      if (f.ginv) evaluate (f.f, d.value, d.qin, c);
+      evaluateJacobian (f.f, d.jacobian, d.qin, c);
+      if (f.equalityIndices.nbIndices() > 0)
+        f.f->outputSpace ()->Jintegrate (f.rightHandSide, d.jacobian);
+      if (f.ginv) {
+        d.value += f.rightHandSide;
+        evaluateJacobian (f.ginv, d.jGinv, d.value.vector(), c);
+        d.tmpJacobian.noalias() = d.jGinv * d.jacobian;
+        d.jacobian.swap (d.tmpJacobian);
       }
     }
 
-    void ExplicitSolver::computeJacobian(const std::size_t& iF, matrixOut_t J) const
+    void ExplicitSolver::jacobianTask (const std::vector<std::size_t>& order,
+        matrixOut_t J, Workspace& ws, std::size_t i, std::size_t) const
     {
-      const Function& f = functions_[iF];
-      matrix_t Jg (MatrixBlocksRef (f.inDer, inDers_).rview(J));
-      MatrixBlocksRef (f.outDer, inDers_).lview (J) = f.jacobian * Jg;
+      if (functions_[order[i]].constant) {
+        const Workspace::FunctionData& d = ws.functions[order[i]];
+        d.outputRows.lview (J) = d.outJacobian;
+      } else
+        computeJacobian (order[i], J, ws);
+    }
+
+    void ExplicitSolver::computeJacobian(const std::size_t& iF, matrixOut_t J,
+                                         Workspace& ws) const
+    {
+      Workspace::FunctionData& d = ws.functions[iF];
+      d.computedInputs.lview (d.Jg) = d.computedInputRows.rview (J);
+      d.outJacobian.noalias() = d.jacobian * d.Jg;
+      d.outputRows.lview (J) = d.outJacobian;
     }
 
     void ExplicitSolver::computeOrder(const std::size_t& iF, std::size_t& iOrder, Computed_t& computed)
@@ -301,32 +603,109 @@ namespace hpp {
       for (std::size_t i = 0; i < f.inDer.indices().size(); ++i) {
         const BlockIndex::segment_t& segment = f.inDer.indices()[i];
         for (size_type j = 0; j < segment.second; ++j) {
-          if (derFunction_[segment.first + j] < 0) {
-            inOutDependencies_(iF, segment.first + j) += 1;
-          } else {
+          if (derFunction_[segment.first + j] >= 0) {
             assert((std::size_t)derFunction_[segment.first + j] < functions_.size());
             computeOrder(derFunction_[segment.first + j], iOrder, computed);
-            inOutDependencies_.row(iF) += inOutDependencies_.row(derFunction_[segment.first + j]);
           }
         }
       }
+      computeDependencies (iF);
       computationOrder_[iOrder] = iF;
       ++iOrder;
       computed[iF] = true;
     }
 
-    vector_t ExplicitSolver::rightHandSideFromInput (vectorIn_t arg)
+    void ExplicitSolver::computeDependencies (const std::size_t& iF)
     {
-      for (std::size_t i = 0; i < functions_.size (); ++i) {
+      // The wavefront of a function is one more than the wavefronts of
+      // the functions computing its input.
+      std::map<size_type, int> deps;
+      std::size_t w = 0;
+      const Function& f = functions_[iF];
+      if (f.constant) {
+        // The output does not depend on any DoF.
+        dependencies_[iF].clear ();
+        functionWavefront_[iF] = 0;
+        return;
+      }
+      for (std::size_t i = 0; i < f.inDer.indices().size(); ++i) {
+        const BlockIndex::segment_t& segment = f.inDer.indices()[i];
+        for (size_type j = segment.first; j < segment.first + segment.second; ++j) {
+          const int g = derFunction_[j];
+          if (g < 0) {
+            deps[j] += 1;
+          } else {
+            const Dependencies_t& gDeps = dependencies_[g];
+            for (std::size_t k = 0; k < gDeps.size(); ++k)
+              deps[gDeps[k].first] += gDeps[k].second;
+            // The outputs of constant functions are set beforehand.
+            if (!functions_[g].constant)
+              w = std::max (w, functionWavefront_[g] + 1);
+          }
+        }
+      }
+      dependencies_[iF].assign (deps.begin(), deps.end());
+      functionWavefront_[iF] = w;
+      if (wavefronts_.size() <= w) wavefronts_.resize (w + 1);
+      wavefronts_[w].push_back (iF);
+    }
+
+    void ExplicitSolver::computeConstants ()
+    {
+      // Constant functions sorted by output
+      std::vector<std::pair<size_type, std::size_t> > outputs;
+      for(std::size_t i = 0; i < functions_.size(); ++i) {
         Function& f = functions_[i];
-        f.qin = f.inArg.rview(arg);
-        f.f->value(f.value, f.qin);
-        f.qout = f.outArg.rview(arg);
-        if (f.g) f.g->value(f.expected, f.qout);
-        else     f.expected.vector() = f.qout;
-        vector_t rhs = f.expected - f.value;
-        f.equalityIndices.lview(f.rightHandSide) = f.equalityIndices.rview(rhs);
+        f.constant = (!f.g &&
+            boost::dynamic_pointer_cast<ConstantFunction> (f.f));
+        if (f.constant)
+          outputs.push_back (std::make_pair (f.outArg.indices()[0].first, i));
+      }
+      std::sort (outputs.begin(), outputs.end());
+
+      constantArgs_ = RowBlockIndices ();
+      constantRows_.assign (functions_.size(), -1);
+      size_type row = 0;
+      for(std::size_t k = 0; k < outputs.size(); ++k) {
+        const RowBlockIndices& out = functions_[outputs[k].second].outArg;
+        for (std::size_t j = 0; j < out.indices().size(); ++j)
+          constantArgs_.addRow (out.indices()[j].first,
+                                out.indices()[j].second);
+        constantRows_[outputs[k].second] = row;
+        row += out.nbRows();
       }
+      // Adjacent outputs are merged. The order is kept so that the rows of
+      // constantValue_ match the segments of constantArgs_.
+      constantArgs_.updateRows<false, true, true> ();
+      constantValue_.resize (row);
+      for(std::size_t k = 0; k < outputs.size(); ++k)
+        updateConstant (outputs[k].second);
+    }
+
+    void ExplicitSolver::updateConstant (const std::size_t& i)
+    {
+      const Function& f = functions_[i];
+      if (!f.constant) return;
+      LiegroupElement value
+        (boost::static_pointer_cast<ConstantFunction> (f.f)->c_);
+      value += f.rightHandSide;
+      constantValue_.segment (constantRows_[i], value.space()->nq()) =
+        value.vector();
+    }
+
+    ExplicitSolver::Workspace& ExplicitSolver::workspace () const
+    {
+      if (!workspaceAllocated_) {
+        allocate (workspace_);
+        workspaceAllocated_ = true;
+      }
+      return workspace_;
+    }
+
+    vector_t ExplicitSolver::rightHandSideFromInput (vectorIn_t arg)
+    {
+      for (std::size_t i = 0; i < functions_.size (); ++i)
+        rightHandSideFromInput (i, arg);
       return rightHandSide();
     }
 
@@ -346,17 +725,20 @@ namespace hpp {
     {
       assert (fidx < functions_.size());
       Function& f = functions_[fidx];
+      Workspace::FunctionData& d = workspace ().functions[fidx];
 
       // Computes f(q1) and g(q2)
-      f.qin = f.inArg.rview(arg);
-      f.f->value(f.value, f.qin);
-      f.qout = f.outArg.rview(arg);
-      if (f.g) f.g->value(f.expected, f.qout);
-      else     f.expected.vector() = f.qout;
+      d.qin = f.inArg.rview(arg);
+      f.f->value(d.value, d.qin);
+      d.qout = f.outArg.rview(arg);
+      if (f.g) f.g->value(d.expected, d.qout);
+      else     d.expected.vector() = d.qout;
 
       // Set rhs = g(q2) - f(q1)
-      vector_t rhs = f.expected - f.value;
+      vector_t rhs = d.expected - d.value;
       f.equalityIndices.lview(f.rightHandSide) = f.equalityIndices.rview(rhs);
+      updateConstant (fidx);
+      ++version_;
     }
 
     bool ExplicitSolver::rightHandSide (const DifferentiableFunctionPtr_t& df, vectorIn_t rhs)
@@ -376,6 +758,8 @@ namespace hpp {
       assert (i < functions_.size());
       Function& f = functions_[i];
       f.equalityIndices.lview(f.rightHandSide) = f.equalityIndices.rview(rhs);
+      updateConstant (i);
+      ++version_;
     }
 
     void ExplicitSolver::rightHandSide (vectorIn_t rhs)
@@ -387,8 +771,10 @@ namespace hpp {
         f.equalityIndices.lview(f.rightHandSide)
           = rhs.segment(row, f.equalityIndices.nbRows());
         row += f.equalityIndices.nbRows();
+        updateConstant (i);
       }
       assert (row == rhs.size());
+      ++version_;
     }
 
     vector_t ExplicitSolver::rightHandSide () const
@@ -431,17 +817,38 @@ namespace hpp {
       return os << decindent << decindent;
     }
 
+    Eigen::MatrixXi ExplicitSolver::inOutDependencies () const
+    {
+      Eigen::MatrixXi iod (Eigen::MatrixXi::Zero (functions_.size(), derSize_));
+      for(std::size_t i = 0; i < functions_.size(); ++i) {
+        const Dependencies_t& deps = dependencies_[i];
+        for (std::size_t k = 0; k < deps.size(); ++k)
+          iod (i, deps[k].first) = deps[k].second;
+      }
+      return iod;
+    }
+
     Eigen::MatrixXi ExplicitSolver::inOutDofDependencies () const
     {
-      Eigen::MatrixXi iod (derSize(), inDers_.nbCols());
+      Eigen::MatrixXi iod (Eigen::MatrixXi::Zero (outDers_.nbIndices(),
+                                                  inDers_.nbCols()));
       if (inDers_.nbCols() == 0) return iod;
-      Eigen::RowVectorXi tmp (inDers_.nbCols());
+      // Rows of the output DoFs and columns of the input DoFs in iod.
+      Eigen::VectorXi row (Eigen::VectorXi::Constant (derSize_, -1)),
+                      col (Eigen::VectorXi::Constant (derSize_, -1));
+      outDers_.lview (row) = Eigen::VectorXi::LinSpaced
+        (outDers_.nbIndices(), 0, int(outDers_.nbIndices()) - 1);
+      inDers_.transpose().lview (col) = Eigen::VectorXi::LinSpaced
+        (inDers_.nbCols(), 0, int(inDers_.nbCols()) - 1);
       for(std::size_t i = 0; i < functions_.size(); ++i) {
         const Function& f = functions_[i];
-        tmp = inDers_.rview (inOutDependencies_.row(i));
-        f.outDer.lview(iod).rowwise() = tmp;
+        const Dependencies_t& deps = dependencies_[i];
+        const BlockIndex::segment_t& out = f.outDer.indices()[0];
+        for (size_type r = out.first; r < out.first + out.second; ++r)
+          for (std::size_t k = 0; k < deps.size(); ++k)
+            iod (row[r], col[deps[k].first]) = deps[k].second;
       }
-      return outDers_.rview(iod);
+      return iod;
     }
   } // namespace constraints
 } // namespace hpp
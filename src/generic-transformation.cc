@@ -26,6 +26,7 @@
 #include <hpp/pinocchio/device.hh>
 #include <hpp/pinocchio/joint.hh>
 
+#include <hpp/constraints/evaluation-context.hh>
 #include <hpp/constraints/tools.hh>
 #include <hpp/constraints/macros.hh>
 #include <hpp/constraints/matrix-view.hh>
@@ -218,7 +219,7 @@ namespace hpp {
             const GenericTransformationData<runtimeRel, true, false>& d)
         {
           // There is no joint1
-          const Transform3f& J2 = d.joint2->currentTransformation ();
+          const Transform3f& J2 = d.M2 ();
           d.value.noalias() = J2.act (d.F2inJ2.translation());
           if (!d.t1isZero) d.value.noalias() -= d.F1inJ1.translation();
           if (!d.R1isID)
@@ -229,7 +230,7 @@ namespace hpp {
         template <bool runtimeRel, bool pos> static inline void run (
             const GenericTransformationData<runtimeRel, pos, true>& d)
         {
-          const Transform3f& J2 = d.joint2->currentTransformation ();
+          const Transform3f& J2 = d.M2 ();
           d.M = d.F1inJ1.actInv(J2 * d.F2inJ2);
           if (pos) d.value.template head<3>().noalias() = d.M.translation();
         }
@@ -243,8 +244,8 @@ namespace hpp {
             relativeTransform<false, true>::run(d);
             return;
           }
-          const Transform3f& J1 = d.joint1->currentTransformation ();
-          const Transform3f& J2 = d.joint2->currentTransformation ();
+          const Transform3f& J1 = d.M1 ();
+          const Transform3f& J2 = d.M2 ();
           d.M = d.F1inJ1.actInv(J1.actInv(J2 * d.F2inJ2));
           if (pos) d.value.template head<3>().noalias() = d.M.translation();
         }
@@ -257,8 +258,8 @@ namespace hpp {
             relativeTransform<false, false>::run(d);
             return;
           }
-          const Transform3f& J2 = d.joint2->currentTransformation ();
-          const Transform3f& J1 = d.joint1->currentTransformation ();
+          const Transform3f& J2 = d.M2 ();
+          const Transform3f& J1 = d.M1 ();
           d.value.noalias() = J2.act (d.F2inJ2.translation())
                               - J1.translation();
           d.value.applyOnTheLeft(J1.rotation().transpose());
@@ -280,7 +281,7 @@ namespace hpp {
         static inline void jacobian (const GenericTransformationData<rel, pos, ori>& d,
             matrixOut_t jacobian, const std::vector<bool>& mask)
         {
-          const Transform3f& J2 = d.joint2->currentTransformation ();
+          const Transform3f& J2 = d.M2 ();
           const vector3_t& t2inJ2 (d.F2inJ2.translation ());
           const vector3_t& t2 (J2.translation ());
           const matrix3_t& R2 (J2.rotation ());
@@ -293,7 +294,7 @@ namespace hpp {
           // rel:           relative known at compile time
           // d.getJoint1(): relative known at run time
           if (rel && d.getJoint1()) {
-            const Transform3f& J1 = d.getJoint1()->currentTransformation ();
+            const Transform3f& J1 = *d.oM1;
             const vector3_t& t1 (J1.translation ());
             d.cross1.noalias() = d.cross2 + t2 - t1;
             binary<rel, pos>::Jtranslation (d, jacobian);
@@ -324,6 +325,80 @@ namespace hpp {
           jacobian.rightCols(jacobian.cols()-d.cols).setZero();
         }
       };
+      /// Kinematics stored in the robot
+      struct DeviceKinematics
+      {
+        const Transform3f& transformation (const JointConstPtr_t& j) const
+        {
+          return j->currentTransformation ();
+        }
+        const JointJacobian_t& jacobian (const JointConstPtr_t& j) const
+        {
+          return j->jacobian ();
+        }
+      };
+
+      /// Kinematics stored in an evaluation context
+      struct ContextKinematics
+      {
+        ContextKinematics (const EvaluationContext& c, const DevicePtr_t& r)
+          : context (c), robot (r) {}
+        const Transform3f& transformation (const JointConstPtr_t& j) const
+        {
+          return context.currentTransformation (robot, j);
+        }
+        const JointJacobian_t& jacobian (const JointConstPtr_t& j) const
+        {
+          return context.jacobian (robot, j);
+        }
+        const EvaluationContext& context;
+        const DevicePtr_t& robot;
+      };
+
+      template <bool pos, bool ori, typename Kinematics>
+      inline void setKinematics
+      (const GenericTransformationData<false, pos, ori>& d,
+       const Kinematics& k, bool jacobians)
+      {
+        d.oM2 = &k.transformation (d.joint2);
+        if (jacobians) d.jac2 = &k.jacobian (d.joint2);
+      }
+
+      template <bool pos, bool ori, typename Kinematics>
+      inline void setKinematics
+      (const GenericTransformationData<true, pos, ori>& d,
+       const Kinematics& k, bool jacobians)
+      {
+        d.oM2 = &k.transformation (d.joint2);
+        if (jacobians) d.jac2 = &k.jacobian (d.joint2);
+        if (d.joint1) {
+          d.oM1 = &k.transformation (d.joint1);
+          if (jacobians) d.jac1 = &k.jacobian (d.joint1);
+        }
+      }
+
+      /// Replace the joint Jacobians by their active columns.
+      template <bool pos, bool ori>
+      inline void compressKinematics
+      (const GenericTransformationData<false, pos, ori>& d,
+       const Eigen::ColBlockIndices& cols)
+      {
+        d.compressedJac2 = cols.rview (*d.jac2);
+        d.jac2 = &d.compressedJac2;
+      }
+
+      template <bool pos, bool ori>
+      inline void compressKinematics
+      (const GenericTransformationData<true, pos, ori>& d,
+       const Eigen::ColBlockIndices& cols)
+      {
+        d.compressedJac2 = cols.rview (*d.jac2);
+        d.jac2 = &d.compressedJac2;
+        if (d.joint1) {
+          d.compressedJac1 = cols.rview (*d.jac1);
+          d.jac1 = &d.compressedJac1;
+        }
+      }
     }
 
     template <int _Options> std::ostream&
@@ -415,8 +490,9 @@ namespace hpp {
        std::vector <bool> mask) :
         DifferentiableFunction (robot->configSize (), robot->numberDof (),
                                 LiegroupSpace::Rn (size (mask)), name),
-        robot_ (robot), d_(robot->numberDof()-robot->extraConfigSpace().
-                           dimension()), mask_ (mask)
+        robot_ (robot), d_ (0), dc_ (0), mask_ (mask),
+        dScratch_ (EvaluationContext::newScratchId ()),
+        dcScratch_ (EvaluationContext::newScratchId ())
     {
       assert(mask.size()==ValueSize);
       std::size_t iOri = 0;
@@ -466,6 +542,9 @@ namespace hpp {
         }
       }
       assert (i1 == i2);
+      activeCols_ = Eigen::ColBlockIndices
+        (BlockIndex::fromLogicalExpression (activeDerivativeParameters_));
+      dc_.resize (activeCols_.nbIndices ());
     }
 
     template <int _Options>
@@ -476,6 +555,7 @@ namespace hpp {
 	  argument != latestArgument_) {
 	robot_->currentConfiguration (argument);
 	robot_->computeForwardKinematics ();
+        setKinematics (d_, DeviceKinematics (), false);
         compute<IsRelative, ComputePosition, ComputeOrientation>::error (d_);
 	latestArgument_ = argument;
       }
@@ -486,10 +566,17 @@ namespace hpp {
     (LiegroupElement& result, ConfigurationIn_t argument) const throw ()
     {
       computeError (argument);
+      setValue (d_, result);
+    }
+
+    template <int _Options>
+    inline void GenericTransformation<_Options>::setValue
+    (const Data_t& d, LiegroupElement& result) const
+    {
       size_type index=0;
       for (size_type i=0; i<ValueSize; ++i) {
 	if (mask_ [i]) {
-	  result.vector () [index] = d_.value[i]; ++index;
+	  result.vector () [index] = d.value[i]; ++index;
 	}
       }
     }
@@ -498,8 +585,11 @@ namespace hpp {
     void GenericTransformation<_Options>::impl_jacobian
     (matrixOut_t jacobian, ConfigurationIn_t arg) const throw ()
     {
-      computeError (arg);
-      compute<IsRelative, ComputePosition, ComputeOrientation>::jacobian (d_, jacobian, mask_);
+      matrix_t& Jc (dc_.activeJacobian);
+      if (Jc.rows () != outputDerivativeSize () || Jc.cols () != dc_.cols)
+        Jc.resize (outputDerivativeSize (), dc_.cols);
+      impl_jacobianCompressed (Jc, arg);
+      uncompressJacobian (Jc, jacobian);
 
 #ifdef CHECK_JACOBIANS
       const value_type eps = std::sqrt(Eigen::NumTraits<value_type>::epsilon());
@@ -521,6 +611,120 @@ namespace hpp {
 #endif
     }
 
+    template <int _Options>
+    inline const typename GenericTransformation<_Options>::Data_t&
+    GenericTransformation<_Options>::contextData (EvaluationContext& context,
+        const ConfigurationIn_t& argument, bool jacobians) const
+    {
+      Data_t& d = context.scratch (dScratch_, d_);
+      d.setParameters (d_);
+      context.computeForwardKinematics (robot_, argument, jacobians);
+      setKinematics (d, ContextKinematics (context, robot_), jacobians);
+      return d;
+    }
+
+    template <int _Options>
+    void GenericTransformation<_Options>::impl_compute
+    (LiegroupElement& result, ConfigurationIn_t argument,
+     EvaluationContext& context) const
+    {
+      const Data_t& d = contextData (context, argument, false);
+      compute<IsRelative, ComputePosition, ComputeOrientation>::error (d);
+      setValue (d, result);
+    }
+
+    template <int _Options>
+    void GenericTransformation<_Options>::impl_jacobian
+    (matrixOut_t jacobian, ConfigurationIn_t arg,
+     EvaluationContext& context) const
+    {
+      matrix_t& Jc (context.scratch (dcScratch_, dc_).activeJacobian);
+      if (Jc.rows () != outputDerivativeSize () || Jc.cols () != dc_.cols)
+        Jc.resize (outputDerivativeSize (), dc_.cols);
+      impl_jacobianCompressed (Jc, arg, context);
+      uncompressJacobian (Jc, jacobian);
+    }
+
+    template <int _Options>
+    void GenericTransformation<_Options>::impl_jacobianCompressed
+    (matrixOut_t jacobian, ConfigurationIn_t arg) const
+    {
+      // Set the robot configuration and compute the error.
+      computeError (arg);
+      dc_.setParameters (d_);
+      dc_.setError (d_);
+      setKinematics (dc_, DeviceKinematics (), true);
+      compressKinematics (dc_, activeCols_);
+      compute<IsRelative, ComputePosition, ComputeOrientation>::jacobian (dc_, jacobian, mask_);
+    }
+
+    template <int _Options>
+    inline const typename GenericTransformation<_Options>::Data_t&
+    GenericTransformation<_Options>::compressedContextData
+    (EvaluationContext& context, const ConfigurationIn_t& argument) const
+    {
+      Data_t& d = context.scratch (dcScratch_, dc_);
+      d.setParameters (d_);
+      if (d.cols != dc_.cols) d.resize (dc_.cols);
+      context.computeForwardKinematics (robot_, argument, true);
+      setKinematics (d, ContextKinematics (context, robot_), true);
+      compute<IsRelative, ComputePosition, ComputeOrientation>::error (d);
+      return d;
+    }
+
+    template <int _Options>
+    void GenericTransformation<_Options>::impl_jacobianCompressed
+    (matrixOut_t jacobian, ConfigurationIn_t arg,
+     EvaluationContext& context) const
+    {
+      const Data_t& d = compressedContextData (context, arg);
+      compressKinematics (d, activeCols_);
+      compute<IsRelative, ComputePosition, ComputeOrientation>::jacobian (d, jacobian, mask_);
+    }
+
+    template <int _Options>
+    void GenericTransformation<_Options>::impl_valueAndJacobian
+    (LiegroupElement& result, matrixOut_t jacobian, ConfigurationIn_t arg)
+      const
+    {
+      // The error is computed once by computeError.
+      impl_compute (result, arg);
+      impl_jacobian (jacobian, arg);
+    }
+
+    template <int _Options>
+    void GenericTransformation<_Options>::impl_valueAndJacobianCompressed
+    (LiegroupElement& result, matrixOut_t jacobian, ConfigurationIn_t arg)
+      const
+    {
+      // The error is computed once by computeError.
+      impl_compute (result, arg);
+      impl_jacobianCompressed (jacobian, arg);
+    }
+
+    template <int _Options>
+    void GenericTransformation<_Options>::impl_valueAndJacobian
+    (LiegroupElement& result, matrixOut_t jacobian, ConfigurationIn_t arg,
+     EvaluationContext& context) const
+    {
+      matrix_t& Jc (context.scratch (dcScratch_, dc_).activeJacobian);
+      if (Jc.rows () != outputDerivativeSize () || Jc.cols () != dc_.cols)
+        Jc.resize (outputDerivativeSize (), dc_.cols);
+      impl_valueAndJacobianCompressed (result, Jc, arg, context);
+      uncompressJacobian (Jc, jacobian);
+    }
+
+    template <int _Options>
+    void GenericTransformation<_Options>::impl_valueAndJacobianCompressed
+    (LiegroupElement& result, matrixOut_t jacobian, ConfigurationIn_t arg,
+     EvaluationContext& context) const
+    {
+      const Data_t& d = compressedContextData (context, arg);
+      setValue (d, result);
+      compressKinematics (d, activeCols_);
+      compute<IsRelative, ComputePosition, ComputeOrientation>::jacobian (d, jacobian, mask_);
+    }
+
     /// Force instanciation of relevant classes
     template class GenericTransformation<               PositionBit | OrientationBit >;
     template class GenericTransformation<               PositionBit                  >;
@@ -22,22 +22,101 @@
 
 #include <hpp/constraints/svd.hh>
 #include <hpp/constraints/macros.hh>
+#include <hpp/constraints/generic-transformation.hh>
+#include <hpp/constraints/explicit-relative-transformation.hh>
 
 namespace hpp {
   namespace constraints {
     namespace lineSearch {
-      template bool Constant::operator() (const HybridSolver& solver, vectorOut_t arg, vectorOut_t darg);
+      template bool Constant::operator() (const HybridSolver& solver, SolverWorkspace& ws, vectorOut_t arg, vectorOut_t darg);
 
-      template bool Backtracking::operator() (const HybridSolver& solver, vectorOut_t arg, vectorOut_t darg);
+      template bool Backtracking::operator() (const HybridSolver& solver, SolverWorkspace& ws, vectorOut_t arg, vectorOut_t darg);
 
-      template bool FixedSequence::operator() (const HybridSolver& solver, vectorOut_t arg, vectorOut_t darg);
+      template bool FixedSequence::operator() (const HybridSolver& solver, SolverWorkspace& ws, vectorOut_t arg, vectorOut_t darg);
 
-      template bool ErrorNormBased::operator() (const HybridSolver& solver, vectorOut_t arg, vectorOut_t darg);
+      template bool ErrorNormBased::operator() (const HybridSolver& solver, SolverWorkspace& ws, vectorOut_t arg, vectorOut_t darg);
+
+      template bool LevenbergMarquardt::operator() (const HybridSolver& solver, SolverWorkspace& ws, vectorOut_t arg, vectorOut_t darg);
     }
 
     void HybridSolver::explicitSolverHasChanged()
     {
       reduction(explicit_.freeDers());
+      // The inputs of the explicit solver are free variables.
+      ArrayXb isInput (ArrayXb::Constant (derSize_, false));
+      const segments_t& inDers = explicit_.inDers().indices();
+      for (std::size_t i = 0; i < inDers.size(); ++i)
+        isInput.segment (inDers[i].first, inDers[i].second).setConstant (true);
+      explicitInputs_ = Eigen::ColBlockIndices (BlockIndex::fromLogicalExpression
+          (reduction_.transpose().rview(isInput.matrix()).eval().array()));
+    }
+
+    namespace {
+      /// Explicit formulation of f, if f is a full transformation
+      /// constraint on a free-flyer joint attached to the world.
+      template <typename GenericTransformation_t>
+      ExplicitRelativeTransformationPtr_t explicitTransformation
+      (const DifferentiableFunctionPtr_t& f)
+      {
+        boost::shared_ptr<GenericTransformation_t> t =
+          boost::dynamic_pointer_cast<GenericTransformation_t> (f);
+        if (!t || t->outputSize () != 6)
+          return ExplicitRelativeTransformationPtr_t ();
+        const DevicePtr_t& robot = t->robot ();
+        const std::string name ("Explicit " + f->name ());
+        if (ExplicitRelativeTransformation::isExplicit
+            (robot, t->joint1 (), t->joint2 ()))
+          return ExplicitRelativeTransformation::create (name, robot,
+              t->joint1 (), t->joint2 (),
+              t->frame1InJoint1 (), t->frame2InJoint2 ());
+        if (t->joint1 () && ExplicitRelativeTransformation::isExplicit
+            (robot, t->joint2 (), t->joint1 ()))
+          return ExplicitRelativeTransformation::create (name, robot,
+              t->joint2 (), t->joint1 (),
+              t->frame2InJoint2 (), t->frame1InJoint1 ());
+        return ExplicitRelativeTransformationPtr_t ();
+      }
+    }
+
+    std::size_t HybridSolver::promoteToExplicit ()
+    {
+      // An optional level cannot become mandatory.
+      if (stacks_.empty () || (lastIsOptional_ && stacks_.size () == 1))
+        return 0;
+
+      std::vector<DifferentiableFunctionPtr_t> promoted;
+      const Data& d = datas_[0];
+      const DifferentiableFunctionStack::Functions_t& fs =
+        stacks_[0].functions();
+      size_type row = 0;
+      for (std::size_t i = 0; i < fs.size (); ++i) {
+        const DifferentiableFunctionPtr_t& f = fs[i];
+        const size_type size = f->outputSize ();
+        bool equality = true;
+        for (size_type k = 0; k < size; ++k)
+          equality = equality && (d.comparison[row + k] == Equality ||
+                                  d.comparison[row + k] == EqualToZero);
+        const bool nullRhs =
+          d.rightHandSide.vector ().segment (row, size).isZero ();
+        row += size;
+        if (!equality || !nullRhs) continue;
+
+        ExplicitRelativeTransformationPtr_t e =
+          explicitTransformation<Transformation> (f);
+        if (!e) e = explicitTransformation<RelativeTransformation> (f);
+        if (!e) continue;
+        if (explicit_.add (e, e->inArg (), e->outArg (), e->inDer (),
+                           e->outDer ()) < 0)
+          continue;
+        hppDout (info, "Constraint " << f->name ()
+            << " is solved explicitly.");
+        promoted.push_back (f);
+      }
+
+      for (std::size_t i = 0; i < promoted.size (); ++i)
+        remove (promoted[i]);
+      if (!promoted.empty ()) explicitSolverHasChanged ();
+      return promoted.size ();
     }
 
     segments_t HybridSolver::implicitDof () const
@@ -59,28 +138,53 @@ namespace hpp {
       return BlockIndex::fromLogicalExpression(out.array().cast<bool>());
     }
 
-    void HybridSolver::updateJacobian (vectorIn_t arg) const
+    void HybridSolver::allocate (SolverWorkspace& ws) const
+    {
+      parent_t::allocate (ws);
+      explicit_.allocate (ws.explicitWs);
+      ws.explicitWs.context = ws.context;
+      ws.Je.setZero (explicit_.outDers().nbIndices(),
+                     explicit_.inDers().nbIndices());
+      ws.initArg.resize (argSize_);
+      ws.kernelProjector.resize (reduction_.nbIndices(),
+                                 reduction_.nbIndices());
+      ws.kernelArg.resize (0);
+      for (std::size_t i = 0; i < stacks_.size (); ++i)
+        ws.levels[i].explicitJ.resize (datas_[i].activeRowsOfJ.nbRows(),
+                                       explicit_.outDers().nbIndices());
+    }
+
+    void HybridSolver::updateJacobian (vectorIn_t arg, SolverWorkspace& ws) const
     {
-      if (explicit_.inDers().nbCols() == 0) return;
-      // Compute Je_
-      explicit_.jacobian(JeExpanded_, arg);
-      Je_ = explicit_.viewJacobian(JeExpanded_);
+      // The jacobian of constant explicit functions is zero.
+      if (explicit_.inDers().nbCols() == 0 || explicit_.isConstant ()) return;
+      SolverTelemetry::Timer timer (telemetry_.get (),
+                                    SolverTelemetry::EXPLICIT_JACOBIAN);
+      // Compute Je
+      explicit_.compactJacobian(ws.Je, arg, ws.explicitWs);
+      assert (explicitInputs_.nbIndices() == ws.Je.cols());
 
       hppDnum (info, "Jacobian of explicit system is" << iendl <<
-          setpyformat << pretty_print(Je_));
+          setpyformat << pretty_print(ws.Je));
 
+      // The jacobians with respect to the explicit variables, explicitJ,
+      // are filled by computeValue<true>.
       for (std::size_t i = 0; i < stacks_.size (); ++i) {
-        Data& d = datas_[i];
+        SolverWorkspace::Level& l = ws.levels[i];
         hppDnum (info, "Jacobian of stack " << i << " before update:" << iendl
-            << pretty_print(d.reducedJ) << iendl
+            << pretty_print(l.reducedJ) << iendl
             << "Jacobian of explicit variable of stack " << i << ":" << iendl
-            << pretty_print(explicit_.outDers().transpose().rview(d.jacobian).eval()));
-        d.reducedJ.noalias() +=
-          Eigen::MatrixBlocksRef<> (d.activeRowsOfJ.keepRows(), explicit_.outDers())
-          .rview(d.jacobian).eval()
-          * Je_;
+            << pretty_print(l.explicitJ));
+        // Only the columns of the inputs of the explicit solver change.
+        size_type col = 0;
+        for (std::size_t k = 0; k < explicitInputs_.indices().size(); ++k) {
+          const segment_t& s = explicitInputs_.indices()[k];
+          l.reducedJ.middleCols (s.first, s.second).noalias() +=
+            l.explicitJ * ws.Je.middleCols (col, s.second);
+          col += s.second;
+        }
         hppDnum (info, "Jacobian of stack " << i << " after update:" << iendl
-            << pretty_print(d.reducedJ) << unsetpyformat);
+            << pretty_print(l.reducedJ) << unsetpyformat);
       }
     }
 
@@ -118,22 +222,67 @@ namespace hpp {
       }
       d.activeRowsOfJ = Eigen::MatrixBlocks<false,false> (rows, reduction_.m_cols);
       d.activeRowsOfJ.updateRows<true, true, true>();
+      computeCompressedJacobians (iStack, explicit_.outDers().indices());
+    }
+
+    Eigen::MatrixXi HybridSolver::explicitDependencies () const
+    {
+      if (explicit_.inDers().nbCols() == 0) return Eigen::MatrixXi ();
+      // Columns of inOutDofDependencies are the input variables, which are
+      // a subset of the reduced variables.
+      Eigen::MatrixXi deps (Eigen::MatrixXi::Zero
+                            (explicit_.outDers().nbIndices(), derSize_));
+      explicit_.inDers().lview(deps) = explicit_.inOutDofDependencies();
+      return reduction_.rview(deps).eval();
+    }
+
+    void HybridSolver::computeKernelProjector (vectorIn_t arg,
+                                               SolverWorkspace& ws) const
+    {
+      // Both versions only increase.
+      const std::size_t version = version_ + explicit_.version();
+      if (ws.kernelVersion == version && ws.kernelArg.size() == arg.size()
+          && ws.kernelArg == arg)
+        return;
+
+      computeValue<true> (arg, ws);
+      updateJacobian(arg, ws);
+      getReducedJacobian (ws.reducedJ, ws);
+
+      ws.decomposition.compute (ws.reducedJ);
+      ws.decomposition.projectorOnSpan (ws.kernelProjector);
+      ws.kernelProjector *= -1;
+      ws.kernelProjector.diagonal().array() += 1;
+
+      ws.kernelArg = arg;
+      ws.kernelVersion = version;
     }
 
-    void HybridSolver::projectOnKernel (vectorIn_t arg, vectorIn_t darg, vectorOut_t result) const
+    void HybridSolver::projectOnKernel (vectorIn_t arg, vectorIn_t darg,
+                                        vectorOut_t result,
+                                        SolverWorkspace& ws) const
     {
-      computeValue<true> (arg);
-      updateJacobian(arg);
-      getReducedJacobian (reducedJ_);
+      computeKernelProjector (arg, ws);
 
-      svd_.compute (reducedJ_);
+      reductionPlan_.gather (darg, ws.tmpDqSmall);
+      ws.dqSmall.noalias() = ws.kernelProjector * ws.tmpDqSmall;
 
-      dqSmall_ = reduction_.transpose().rview(darg);
+      reductionPlan_.scatter (ws.dqSmall, result);
+    }
 
-      vector_t tmp (getV1(svd_).adjoint() * dqSmall_);
-      dqSmall_.noalias() -= getV1(svd_) * tmp;
+    void HybridSolver::projectOnKernelBatch (vectorIn_t arg, matrixIn_t dargs,
+                                             matrixOut_t results,
+                                             SolverWorkspace& ws) const
+    {
+      assert (dargs.rows() == derSize_ && results.rows() == derSize_
+              && dargs.cols() == results.cols());
+      computeKernelProjector (arg, ws);
+
+      ws.kernelIn.resize (reduction_.nbIndices(), dargs.cols());
+      ws.kernelIn = reduction_.transpose().rview(dargs);
+      ws.kernelOut.noalias() = ws.kernelProjector * ws.kernelIn;
 
-      reduction_.transpose().lview(result) = dqSmall_;
+      reduction_.transpose().lview(results) = ws.kernelOut;
     }
 
     std::ostream& HybridSolver::print (std::ostream& os) const
@@ -144,9 +293,16 @@ namespace hpp {
       return os;
     }
 
-    template HybridSolver::Status HybridSolver::impl_solve (vectorOut_t arg, lineSearch::Constant       lineSearch) const;
-    template HybridSolver::Status HybridSolver::impl_solve (vectorOut_t arg, lineSearch::Backtracking   lineSearch) const;
-    template HybridSolver::Status HybridSolver::impl_solve (vectorOut_t arg, lineSearch::FixedSequence  lineSearch) const;
-    template HybridSolver::Status HybridSolver::impl_solve (vectorOut_t arg, lineSearch::ErrorNormBased lineSearch) const;
+    template HybridSolver::Status HybridSolver::impl_solve (vectorOut_t arg, SolverWorkspace& ws, lineSearch::Constant       lineSearch) const;
+    template HybridSolver::Status HybridSolver::impl_solve (vectorOut_t arg, SolverWorkspace& ws, lineSearch::Backtracking   lineSearch) const;
+    template HybridSolver::Status HybridSolver::impl_solve (vectorOut_t arg, SolverWorkspace& ws, lineSearch::FixedSequence  lineSearch) const;
+    template HybridSolver::Status HybridSolver::impl_solve (vectorOut_t arg, SolverWorkspace& ws, lineSearch::ErrorNormBased lineSearch) const;
+    template HybridSolver::Status HybridSolver::impl_solve (vectorOut_t arg, SolverWorkspace& ws, lineSearch::LevenbergMarquardt lineSearch) const;
+
+    template void HierarchicalIterativeSolver::impl_solveBatch (const HybridSolver& solver, matrixOut_t configs, std::vector<Status>& status, const lineSearch::Constant      & ls, WorkStealingPool& pool);
+    template void HierarchicalIterativeSolver::impl_solveBatch (const HybridSolver& solver, matrixOut_t configs, std::vector<Status>& status, const lineSearch::Backtracking  & ls, WorkStealingPool& pool);
+    template void HierarchicalIterativeSolver::impl_solveBatch (const HybridSolver& solver, matrixOut_t configs, std::vector<Status>& status, const lineSearch::FixedSequence & ls, WorkStealingPool& pool);
+    template void HierarchicalIterativeSolver::impl_solveBatch (const HybridSolver& solver, matrixOut_t configs, std::vector<Status>& status, const lineSearch::ErrorNormBased& ls, WorkStealingPool& pool);
+    template void HierarchicalIterativeSolver::impl_solveBatch (const HybridSolver& solver, matrixOut_t configs, std::vector<Status>& status, const lineSearch::LevenbergMarquardt& ls, WorkStealingPool& pool);
   } // namespace constraints
 } // namespace hpp
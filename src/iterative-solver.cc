@@ -18,11 +18,13 @@
 #include <hpp/constraints/impl/iterative-solver.hh>
 
 #include <limits>
+#include <boost/bind.hpp>
 #include <hpp/util/debug.hh>
 #include <hpp/util/timer.hh>
 
 #include <hpp/pinocchio/util.hh>
 
+#include <hpp/constraints/evaluation-context.hh>
 #include <hpp/constraints/svd.hh>
 #include <hpp/constraints/macros.hh>
 
@@ -46,7 +48,7 @@ namespace hpp {
 
       template <bool ComputeJac>
       void applyComparison (
-          const ComparisonTypes_t comparison,
+          const ComparisonTypes_t& comparison,
           const std::vector<std::size_t>& indices,
           vector_t& value, matrix_t& jacobian, const value_type& thr)
       {
@@ -59,16 +61,169 @@ namespace hpp {
           }
         }
       }
+
+      /// Copy the compressed jacobian of a function to the active rows of
+      /// out.
+      template <typename CompressedJacobian, typename ColumnCopies_t>
+      void copyColumns (const matrix_t& compressedJ,
+          const CompressedJacobian& cj, const ColumnCopies_t& copies,
+          matrix_t& out)
+      {
+        out.middleRows (cj.activeRow, cj.rows).setZero ();
+        for (std::size_t k = 0; k < copies.size(); ++k)
+          out.block (cj.activeRow, copies[k].to, cj.rows, copies[k].size) =
+            compressedJ.block (cj.row, copies[k].from, cj.rows, copies[k].size);
+      }
+
+      typedef std::vector<SolverWorkspace::Level> Levels_t;
+
+      /// Multiply v by the basis of the common kernel of the levels above
+      /// level.
+      void multiplyByKernelBasis (const Levels_t& levels, std::size_t level,
+                                  vectorOut_t v)
+      {
+        // Z = Q_0 [ 0 ; Q_1 [ 0 ; ... ] ]
+        for (std::size_t j = level; j-- > 0; ) {
+          if (levels[j].reducedJ.rows () == 0) continue;
+          const Decomposition& d = levels[j].decomposition;
+          d.applyKernelQOnTheLeft (v.tail (d.cols()));
+        }
+      }
+
+      /// Solve the levels, each of them in the common kernel of the upper
+      /// levels, for the opposite of the descent direction.
+      /// \return the number of levels taken into account.
+      std::size_t solveLevels (Levels_t& levels, vectorOut_t dqSmall,
+          vectorOut_t tmpDqSmall, value_type& sigma)
+      {
+        // Each level is solved in the common kernel of the upper levels,
+        // of dimension nz. Its basis is never formed: the Householder
+        // reflections of the decompositions of the upper levels are
+        // applied instead.
+        std::size_t solvedLevels = 0;
+        size_type nz = dqSmall.size();
+        bool first = true;
+        dqSmall.setZero ();
+        for (std::size_t i = 0; i < levels.size (); ++i) {
+          SolverWorkspace::Level& l = levels[i];
+
+          if (l.reducedJ.rows () == 0) continue;
+          bool last = (i == levels.size() - 1);
+          if (first) {
+            l.decomposition.compute (l.reducedJ);
+            HPP_DEBUG_SVDCHECK (l.decomposition);
+            l.decomposition.solve (l.reducedError, dqSmall);
+          } else {
+            // Solve J (dq + Z y) = e for y where Z is the basis of the
+            // kernel of the upper levels.
+            l.transformedJ = l.reducedJ;
+            for (std::size_t j = 0; j < i; ++j) {
+              if (levels[j].reducedJ.rows () == 0) continue;
+              const Decomposition& d = levels[j].decomposition;
+              d.applyKernelQOnTheRight (l.transformedJ.rightCols (d.cols()));
+            }
+            l.projectedJ.resize (l.reducedJ.rows(), nz);
+            l.projectedJ = l.transformedJ.rightCols (nz);
+            l.decomposition.compute (l.projectedJ);
+            HPP_DEBUG_SVDCHECK (l.decomposition);
+            l.residual = l.reducedError;
+            l.residual.noalias() -= l.reducedJ * dqSmall;
+            tmpDqSmall.head (dqSmall.size() - nz).setZero ();
+            l.decomposition.solve (l.residual, tmpDqSmall.tail (nz));
+            multiplyByKernelBasis (levels, i, tmpDqSmall);
+            dqSmall += tmpDqSmall;
+          }
+          solvedLevels = i + 1;
+          // Update sigma
+          l.maxRank = std::max(l.maxRank, l.decomposition.rank());
+          if (l.maxRank > 0)
+            sigma = std::min(sigma, l.decomposition.singularValues()[l.maxRank - 1]);
+
+          if (last) break; // No need to compute the kernel for next step.
+          l.residual = l.reducedError;
+          l.residual.noalias() -= l.reducedJ * dqSmall;
+          if (!l.residual.isZero ()) break;
+          nz = l.decomposition.kernelDimension ();
+          if (nz == 0) break;
+          first = false;
+        }
+        return solvedLevels;
+      }
+
+      /// Solve the damped least squares problem of the levels solved by
+      /// solveLevels, for the opposite of the descent direction.
+      void solveDampedLevels (Levels_t& levels, std::size_t solvedLevels,
+          const value_type& lambda, vectorOut_t dqSmall,
+          vectorOut_t tmpDqSmall)
+      {
+        dqSmall.setZero();
+        bool first = true;
+        for (std::size_t i = 0; i < solvedLevels; ++i) {
+          SolverWorkspace::Level& l = levels[i];
+          if (l.reducedJ.rows () == 0) continue;
+          // solveLevels stores J Z in projectedJ, except for the first
+          // level.
+          const matrix_t& J = (first ? l.reducedJ : l.projectedJ);
+
+          // dq += Z (J Z)^T ((J Z) (J Z)^T + lambda I)^-1 (e - J dq)
+          l.residual = l.reducedError;
+          l.residual.noalias() -= l.reducedJ * dqSmall;
+          l.dampedJJt.noalias() = J * J.transpose();
+          l.dampedJJt.diagonal().array() += lambda;
+          l.dampedLLT.compute (l.dampedJJt);
+          l.dampedLLT.solveInPlace (l.residual);
+          if (first)
+            dqSmall.noalias() += J.transpose() * l.residual;
+          else {
+            const size_type nz = J.cols();
+            tmpDqSmall.head (dqSmall.size() - nz).setZero ();
+            tmpDqSmall.tail (nz).noalias() = J.transpose() * l.residual;
+            multiplyByKernelBasis (levels, i, tmpDqSmall);
+            dqSmall += tmpDqSmall;
+          }
+          first = false;
+        }
+      }
+
+      /// Allocate the buffers of the descent direction of a level.
+      void allocateLevel (SolverWorkspace::Level& l, size_type rows,
+          size_type cols, Decomposition::Type type, value_type damping,
+          bool computeKernel)
+      {
+        l.reducedJ.resize(rows, cols);
+        l.reducedError.resize(rows);
+        l.projectedJ.resize(rows, cols);
+        l.residual.resize(rows);
+        l.dampedJJt.resize(rows, rows);
+        l.dampedLLT = Eigen::LLT<matrix_t> (rows);
+        l.transformedJ.resize(rows, cols);
+
+        l.decomposition.damping (damping);
+        l.decomposition.allocate (type, rows, cols, computeKernel);
+        l.decomposition.threshold (SVD_THRESHOLD);
+
+        l.maxRank = 0;
+      }
+
+      /// Compute a - b without temporary when the space is a vector space.
+      void difference (const LiegroupElement& a, const LiegroupElement& b,
+                       vector_t& res)
+      {
+        if (a.space()->nq() == a.space()->nv())
+          res.noalias() = a.vector() - b.vector();
+        else
+          res = a - b;
+      }
     }
 
     namespace lineSearch {
-      template bool Constant::operator() (const HierarchicalIterativeSolver& solver, vectorOut_t arg, vectorOut_t darg);
+      template bool Constant::operator() (const HierarchicalIterativeSolver& solver, SolverWorkspace& ws, vectorOut_t arg, vectorOut_t darg);
 
       Backtracking::Backtracking () : c (0.001), tau (0.7), smallAlpha (0.2) {}
-      template bool Backtracking::operator() (const HierarchicalIterativeSolver& solver, vectorOut_t arg, vectorOut_t darg);
+      template bool Backtracking::operator() (const HierarchicalIterativeSolver& solver, SolverWorkspace& ws, vectorOut_t arg, vectorOut_t darg);
 
       FixedSequence::FixedSequence() : alpha (.2), alphaMax (.95), K (.8) {}
-      template bool FixedSequence::operator() (const HierarchicalIterativeSolver& solver, vectorOut_t arg, vectorOut_t darg);
+      template bool FixedSequence::operator() (const HierarchicalIterativeSolver& solver, SolverWorkspace& ws, vectorOut_t arg, vectorOut_t darg);
 
       ErrorNormBased::ErrorNormBased(value_type alphaMin, value_type _a, value_type _b)
           : C (0.5 + alphaMin / 2), K ((1 - alphaMin) / 2), a (_a), b (_b)
@@ -84,7 +239,13 @@ namespace hpp {
         b = - r_half * a;
       }
 
-      template bool ErrorNormBased::operator() (const HierarchicalIterativeSolver& solver, vectorOut_t arg, vectorOut_t darg);
+      template bool ErrorNormBased::operator() (const HierarchicalIterativeSolver& solver, SolverWorkspace& ws, vectorOut_t arg, vectorOut_t darg);
+
+      LevenbergMarquardt::LevenbergMarquardt (value_type lambda0)
+        : lambda (lambda0), nu (2), lambdaMin (1e-12), lambdaMax (1e8),
+        maxTrials (10)
+      {}
+      template bool LevenbergMarquardt::operator() (const HierarchicalIterativeSolver& solver, SolverWorkspace& ws, vectorOut_t arg, vectorOut_t darg);
     }
 
     HierarchicalIterativeSolver::HierarchicalIterativeSolver (const std::size_t& argSize, const std::size_t derSize)
@@ -92,13 +253,33 @@ namespace hpp {
       argSize_ (argSize),
       derSize_ (derSize),
       dimension_ (0),
+      reducedDimension_ (0),
       lastIsOptional_ (false),
+      decompositionType_ (Decomposition::JACOBI_SVD),
+      decompositionDamping_ (1e-8),
+      maxJacobianReuse_ (0),
+      jacobianReuseRatio_ (0.8),
+      blockDecomposition_ (true),
+      blockPool_ (NULL),
+      telemetry_ (),
       reduction_ (),
-      saturation_ (derSize),
+      reductionPlan_ (),
       datas_(),
+      version_ (0),
       statistics_ ("HierarchicalIterativeSolver")
     {
       reduction_.addCol (0, derSize_);
+      reductionPlan_ = Eigen::IndexPlan (reduction_.indices ());
+      workspace_.saturation.resize (derSize_);
+    }
+
+    SolverWorkspace::SolverWorkspace (const HierarchicalIterativeSolver& solver)
+      : squaredNorm (0), sigma (0), solvedLevels (0),
+      context (new EvaluationContext), kernelVersion (0),
+      jacobianEvaluations (0), jacobianUpdates (0), exactJacobian (true),
+      consecutiveUpdates (0), previousSquaredNorm (0)
+    {
+      solver.allocate (*this);
     }
 
     void HierarchicalIterativeSolver::add (
@@ -132,6 +313,56 @@ namespace hpp {
       update();
     }
 
+    bool HierarchicalIterativeSolver::remove
+    (const DifferentiableFunctionPtr_t& f)
+    {
+      for (std::size_t i = 0; i < stacks_.size (); ++i) {
+        const DifferentiableFunctionStack::Functions_t& fs =
+          stacks_[i].functions();
+        size_type row = 0;
+        std::size_t j = 0;
+        for (; j < fs.size() && fs[j] != f; ++j)
+          row += fs[j]->outputSize();
+        if (j == fs.size()) continue;
+
+        const size_type size = f->outputSize();
+        // update resets the right hand sides.
+        std::vector<vector_t> rhs (stacks_.size ());
+        for (std::size_t k = 0; k < stacks_.size (); ++k)
+          rhs[k] = datas_[k].rightHandSide.vector ();
+        const size_type tail = rhs[i].size() - row - size;
+        rhs[i].segment (row, tail) = rhs[i].tail (tail).eval();
+        rhs[i].conservativeResize (rhs[i].size() - size);
+
+        stacks_[i].remove (f);
+        Data& d = datas_[i];
+        d.comparison.erase (d.comparison.begin() + row,
+                            d.comparison.begin() + row + size);
+        d.inequalityIndices.clear ();
+        d.equalityIndices = Eigen::RowBlockIndices ();
+        for (std::size_t k = 0; k < d.comparison.size(); ++k) {
+          switch (d.comparison[k]) {
+            case Superior:
+            case Inferior:
+              d.inequalityIndices.push_back (k);
+              break;
+            case Equality:
+              d.equalityIndices.addRow(k, 1);
+              break;
+            default:
+              break;
+          }
+        }
+        d.equalityIndices.updateRows<true, true, true>();
+        update();
+
+        for (std::size_t k = 0; k < stacks_.size (); ++k)
+          datas_[k].rightHandSide.vector () = rhs[k];
+        return true;
+      }
+      return false;
+    }
+
     ArrayXb HierarchicalIterativeSolver::activeParameters () const
     {
       ArrayXb ap (ArrayXb::Constant(argSize_, false));
@@ -150,38 +381,117 @@ namespace hpp {
 
     void HierarchicalIterativeSolver::update()
     {
-      // Compute reduced size
-      std::size_t reducedSize = reduction_.nbIndices();
-
       dimension_ = 0;
       reducedDimension_ = 0;
+      reductionPlan_ = Eigen::IndexPlan (reduction_.indices ());
       for (std::size_t i = 0; i < stacks_.size (); ++i) {
         computeActiveRowsOfJ (i);
+        datas_[i].activeRows =
+          Eigen::IndexPlan (datas_[i].activeRowsOfJ.rows ());
+        // Rows of the inequalities among the active rows
+        Data& d = datas_[i];
+        d.activeInequalityRows.clear ();
+        const segments_t& rows = d.activeRowsOfJ.rows ();
+        size_type activeRow = 0;
+        for (std::size_t k = 0; k < rows.size (); ++k) {
+          for (size_type r = rows[k].first; r < rows[k].first + rows[k].second;
+               ++r, ++activeRow) {
+            if (d.comparison[r] == Superior || d.comparison[r] == Inferior)
+              d.activeInequalityRows.push_back (activeRow);
+          }
+        }
 
         const DifferentiableFunctionStack& f = stacks_[i];
         dimension_ += f.outputSize();
         reducedDimension_ += datas_[i].activeRowsOfJ.nbRows();
-        datas_[i].output = LiegroupElement (f.outputSpace ());
         datas_[i].rightHandSide = LiegroupElement (f.outputSpace ());
         datas_[i].rightHandSide.setNeutral ();
-
         assert(derSize_ == f.inputDerivativeSize());
-        datas_[i].jacobian.resize(f.outputDerivativeSize(), f.inputDerivativeSize());
-        datas_[i].jacobian.setZero();
-        datas_[i].reducedJ.resize(datas_[i].activeRowsOfJ.nbRows(), reducedSize);
+      }
+      computeBlocks ();
+      ++version_;
+
+      allocate (workspace_);
+    }
+
+    void HierarchicalIterativeSolver::allocate (SolverWorkspace& ws) const
+    {
+      // Compute reduced size
+      std::size_t reducedSize = reduction_.nbIndices();
+
+      ws.levels.clear ();
+      ws.levels.reserve (stacks_.size ());
+      for (std::size_t i = 0; i < stacks_.size (); ++i) {
+        const DifferentiableFunctionStack& f = stacks_[i];
+        SolverWorkspace::Level l;
+        l.output = LiegroupElement (f.outputSpace ());
+        for (std::size_t j = 0; j < f.functions ().size (); ++j)
+          l.functionOutputs.push_back
+            (LiegroupElement (f.functions ()[j]->outputSpace ()));
 
-        datas_[i].svd = SVD_t (f.outputDerivativeSize(), reducedSize, Eigen::ComputeThinU | Eigen::ComputeThinV);
-        datas_[i].svd.setThreshold (SVD_THRESHOLD);
-        datas_[i].PK.resize (reducedSize, reducedSize);
+        l.compressedJ.resize(f.outputDerivativeSize(), datas_[i].compressedCols);
+        l.compressedJ.setZero();
+        l.error.resize(f.outputDerivativeSize());
+        l.savedError.resize(datas_[i].activeRowsOfJ.nbRows());
+        l.approxJ.resize(datas_[i].activeRowsOfJ.nbRows(), reducedSize);
+        l.previousError.resize(datas_[i].activeRowsOfJ.nbRows());
 
-        datas_[i].maxRank = 0;
+        // The kernel of the last level is not needed.
+        allocateLevel (l, datas_[i].activeRowsOfJ.nbRows(), reducedSize,
+            decompositionType_, decompositionDamping_,
+            i + 1 < stacks_.size());
+        ws.levels.push_back (l);
       }
 
-      dq_ = vector_t::Zero(derSize_);
-      dqSmall_.resize(reducedSize);
-      projector_.resize(reducedSize, reducedSize);
-      reducedJ_.resize(reducedDimension_, reducedSize);
-      svd_ = SVD_t (reducedDimension_, reducedSize, Eigen::ComputeThinU | Eigen::ComputeThinV);
+      ws.blocks.resize (blocks_.size ());
+      for (std::size_t b = 0; b < blocks_.size (); ++b) {
+        const Block& block = blocks_[b];
+        SolverWorkspace::Block& wb = ws.blocks[b];
+        const size_type cols = block.cols.nbIndices ();
+        wb.levels.resize (block.levels.size ());
+        for (std::size_t k = 0; k < block.levels.size (); ++k)
+          allocateLevel (wb.levels[k], block.jacobians[k].nbRows (), cols,
+              decompositionType_, decompositionDamping_,
+              k + 1 < block.levels.size ());
+        wb.dqSmall.resize (cols);
+        wb.tmpDqSmall.resize (cols);
+        wb.sigma = 0;
+        wb.solvedLevels = 0;
+      }
+
+      ws.squaredNorm = 0;
+      ws.sigma = 0;
+      ws.solvedLevels = 0;
+      ws.jacobianEvaluations = 0;
+      ws.jacobianUpdates = 0;
+      ws.exactJacobian = true;
+      ws.consecutiveUpdates = 0;
+      ws.previousSquaredNorm = 0;
+      ws.dq = vector_t::Zero(derSize_);
+      ws.dqSmall.resize(reducedSize);
+      ws.tmpDqSmall.resize(reducedSize);
+      ws.reducedJ.resize(reducedDimension_, reducedSize);
+      ws.saturation.resize(derSize_);
+      ws.reducedSaturation.resize(reducedSize);
+      ws.tmpSat.resize(reducedSize);
+      ws.arg_darg.resize(argSize_);
+      ws.darg.resize(derSize_);
+      ws.df.resize(reducedDimension_);
+      ws.decomposition.damping (decompositionDamping_);
+      ws.decomposition.allocate (decompositionType_, reducedDimension_,
+                                 reducedSize);
+      ws.decomposition.threshold (SVD_THRESHOLD);
+      // Release the scratch data of the functions the solver does not use
+      // anymore.
+      if (ws.context) ws.context->clearScratches ();
+    }
+
+    bool HierarchicalIterativeSolver::isSatisfied (vectorIn_t arg,
+                                                   SolverWorkspace& ws) const
+    {
+      computeValue<false>(arg, ws);
+      computeError(ws);
+      return ws.squaredNorm < squaredErrorThreshold_;
     }
 
     void HierarchicalIterativeSolver::computeActiveRowsOfJ (std::size_t iStack)
@@ -202,6 +512,173 @@ namespace hpp {
       }
       d.activeRowsOfJ = Eigen::MatrixBlocks<false,false> (rows, reduction_.m_cols);
       d.activeRowsOfJ.updateRows<true, true, true>();
+      computeCompressedJacobians (iStack, segments_t ());
+    }
+
+    namespace {
+      /// Add the copies from the active columns of a function to the
+      /// columns cols of a matrix.
+      /// \param rank rank of each active column in the compressed jacobian.
+      template <typename ColumnCopies_t>
+      void columnCopies (const ArrayXb& adp, const std::vector<size_type>& rank,
+          const segments_t& cols, ColumnCopies_t& copies)
+      {
+        typedef typename ColumnCopies_t::value_type ColumnCopy;
+        copies.clear ();
+        size_type to = 0;
+        for (std::size_t k = 0; k < cols.size (); ++k) {
+          for (size_type c = cols[k].first;
+              c < cols[k].first + cols[k].second; ++c, ++to) {
+            if (!adp[c]) continue;
+            if (!copies.empty() &&
+                copies.back().from + copies.back().size == rank[c] &&
+                copies.back().to   + copies.back().size == to) {
+              ++copies.back().size;
+            } else {
+              ColumnCopy copy;
+              copy.from = rank[c]; copy.to = to; copy.size = 1;
+              copies.push_back (copy);
+            }
+          }
+        }
+      }
+    }
+
+    void HierarchicalIterativeSolver::computeCompressedJacobians
+    (std::size_t iStack, const segments_t& explicitCols)
+    {
+      Data& d = datas_[iStack];
+      const DifferentiableFunctionStack::Functions_t& fs =
+        stacks_[iStack].functions();
+      const segments_t& activeRows = d.activeRowsOfJ.rows();
+
+      d.compressedJacobians.clear ();
+      d.compressedCols = 0;
+      std::vector<size_type> rank (derSize_);
+      size_type row = 0, activeRow = 0;
+      for (std::size_t i = 0; i < fs.size (); ++i) {
+        const DifferentiableFunction& f = *fs[i];
+        const size_type rows = f.outputDerivativeSize();
+        // Active rows are either all or none of the rows of a function.
+        bool active = false;
+        for (std::size_t k = 0; k < activeRows.size(); ++k)
+          if (activeRows[k].first <= row &&
+              row < activeRows[k].first + activeRows[k].second)
+            active = true;
+        if (active && rows > 0) {
+          const ArrayXb& adp = f.activeDerivativeParameters();
+          Data::CompressedJacobian cj;
+          cj.function = i;
+          cj.row = row;
+          cj.activeRow = activeRow;
+          cj.rows = rows;
+          cj.cols = 0;
+          for (size_type c = 0; c < adp.size(); ++c)
+            if (adp[c]) rank[c] = cj.cols++;
+          columnCopies (adp, rank, reduction_.indices(), cj.toReducedJ);
+          columnCopies (adp, rank, explicitCols, cj.toExplicitJ);
+          d.compressedCols = std::max (d.compressedCols, cj.cols);
+          d.compressedJacobians.push_back (cj);
+        }
+        if (active) activeRow += rows;
+        row += rows;
+      }
+      assert (activeRow == d.activeRowsOfJ.nbRows());
+    }
+
+    namespace {
+      std::size_t root (std::vector<std::size_t>& parents, std::size_t i)
+      {
+        while (parents[i] != i) i = parents[i] = parents[parents[i]];
+        return i;
+      }
+    }
+
+    void HierarchicalIterativeSolver::computeBlocks ()
+    {
+      blocks_.clear ();
+      if (!blockDecomposition_) return;
+      const std::size_t n = reduction_.nbIndices ();
+      const Eigen::MatrixXi explicitDeps = explicitDependencies ();
+
+      // Connected components of the reduced variables, two variables being
+      // connected if a function with active rows depends on both of them.
+      std::vector<std::size_t> parents (n);
+      for (std::size_t c = 0; c < n; ++c) parents[c] = c;
+      // First column of each compressed jacobian, n if it has none.
+      std::vector<std::vector<std::size_t> > firstCols (stacks_.size ());
+      for (std::size_t i = 0; i < stacks_.size (); ++i) {
+        const Data& d = datas_[i];
+        for (std::size_t j = 0; j < d.compressedJacobians.size (); ++j) {
+          const Data::CompressedJacobian& cj = d.compressedJacobians[j];
+          std::size_t first = n;
+          for (std::size_t k = 0; k < cj.toReducedJ.size (); ++k) {
+            const Data::ColumnCopy& copy = cj.toReducedJ[k];
+            for (size_type c = copy.to; c < copy.to + copy.size; ++c) {
+              if (first == n) first = c;
+              else parents[root (parents, c)] = root (parents, first);
+            }
+          }
+          // The explicit variables depend on reduced variables.
+          for (std::size_t k = 0; k < cj.toExplicitJ.size (); ++k) {
+            const Data::ColumnCopy& copy = cj.toExplicitJ[k];
+            for (size_type o = copy.to; o < copy.to + copy.size; ++o) {
+              for (size_type c = 0; c < explicitDeps.cols (); ++c) {
+                if (explicitDeps (o, c) == 0) continue;
+                if (first == n) first = c;
+                else parents[root (parents, c)] = root (parents, first);
+              }
+            }
+          }
+          firstCols[i].push_back (first);
+        }
+      }
+
+      // Index of the block of each component
+      std::vector<std::size_t> blockOf (n, n);
+      std::vector<segments_t> cols;
+      std::vector<std::vector<segments_t> > rows;
+      for (std::size_t i = 0; i < stacks_.size (); ++i) {
+        const Data& d = datas_[i];
+        for (std::size_t j = 0; j < d.compressedJacobians.size (); ++j) {
+          if (firstCols[i][j] == n) continue;
+          std::size_t& b = blockOf[root (parents, firstCols[i][j])];
+          if (b == n) {
+            b = cols.size ();
+            cols.push_back (segments_t ());
+            rows.push_back (std::vector<segments_t> (stacks_.size ()));
+          }
+          const Data::CompressedJacobian& cj = d.compressedJacobians[j];
+          segments_t& r = rows[b][i];
+          if (!r.empty () && r.back ().first + r.back ().second == cj.activeRow)
+            r.back ().second += cj.rows;
+          else
+            r.push_back (segment_t (cj.activeRow, cj.rows));
+        }
+      }
+      // A single block is the whole problem.
+      if (cols.size () < 2) return;
+      for (std::size_t c = 0; c < n; ++c) {
+        const std::size_t b = blockOf[root (parents, c)];
+        if (b == n) continue;
+        if (!cols[b].empty () &&
+            cols[b].back ().first + cols[b].back ().second == (size_type)c)
+          ++cols[b].back ().second;
+        else
+          cols[b].push_back (segment_t (c, 1));
+      }
+
+      blocks_.resize (cols.size ());
+      for (std::size_t b = 0; b < cols.size (); ++b) {
+        Block& block = blocks_[b];
+        block.cols = Eigen::RowBlockIndices (cols[b]);
+        for (std::size_t i = 0; i < stacks_.size (); ++i) {
+          if (rows[b][i].empty ()) continue;
+          block.levels.push_back (i);
+          block.jacobians.push_back
+            (Eigen::MatrixBlocks<false,false> (rows[b][i], cols[b]));
+        }
+      }
     }
 
     vector_t HierarchicalIterativeSolver::rightHandSideFromInput (vectorIn_t arg)
@@ -209,10 +686,12 @@ namespace hpp {
       for (std::size_t i = 0; i < stacks_.size (); ++i) {
         const DifferentiableFunctionStack& f = stacks_[i];
         Data& d = datas_[i];
-        f.value (d.output, arg);
+        LiegroupElement& output = workspace_.levels[i].output;
+        f.value (output, arg);
         d.equalityIndices.lview(d.rightHandSide.vector ()) =
-          d.equalityIndices.rview(d.output.vector ());
+          d.equalityIndices.rview(output.vector ());
       }
+      ++version_;
       return rightHandSide();
     }
 
@@ -226,12 +705,12 @@ namespace hpp {
           if (f == fs[j]) {
             LiegroupElement tmp (f->outputSpace ());
             f->value (tmp, arg);
-            d.output.vector ().segment(row, f->outputSize()) = tmp.vector ();
             for (size_type k = 0; k < f->outputSize(); ++k) {
               if (d.comparison[row + k] == Equality) {
-                d.rightHandSide.vector () [row + k] = d.output.vector ()[row + k];
+                d.rightHandSide.vector () [row + k] = tmp.vector ()[k];
               }
             }
+            ++version_;
             return true;
           }
           row += fs[j]->outputSize();
@@ -253,6 +732,7 @@ namespace hpp {
                 d.rightHandSide.vector () [row + k] = rhs [k];
               }
             }
+            ++version_;
             return true;
           }
           row += fs[j]->outputSize();
@@ -271,6 +751,7 @@ namespace hpp {
         row += d.equalityIndices.m_nbRows;
       }
       assert (row == rhs.size());
+      ++version_;
     }
 
     vector_t HierarchicalIterativeSolver::rightHandSide () const
@@ -297,159 +778,339 @@ namespace hpp {
     }
 
     template <bool ComputeJac>
-    void HierarchicalIterativeSolver::computeValue (vectorIn_t arg) const
+    void HierarchicalIterativeSolver::computeValue (vectorIn_t arg,
+                                                    SolverWorkspace& ws) const
     {
+      // All the functions are evaluated at arg: the kinematics are computed
+      // once for all of them.
+      if (ws.context) ws.context->lockConfiguration (ComputeJac);
       for (std::size_t i = 0; i < stacks_.size (); ++i) {
         const DifferentiableFunctionStack& f = stacks_[i];
-        Data& d = datas_[i];
+        const Data& d = datas_[i];
+        SolverWorkspace::Level& l = ws.levels[i];
+
+        if (ComputeJac) {
+          // The functions with active rows are evaluated together with
+          // their jacobian.
+          SolverTelemetry::Timer timer (telemetry_.get (),
+                                        SolverTelemetry::JACOBIAN);
+          const DifferentiableFunctionStack::Functions_t& fs = f.functions();
+          std::vector<Data::CompressedJacobian>::const_iterator cj =
+            d.compressedJacobians.begin ();
+          size_type row = 0;
+          for (std::size_t j = 0; j < fs.size(); ++j) {
+            const DifferentiableFunction& fj = *fs[j];
+            LiegroupElement& output = l.functionOutputs[j];
+            if (cj != d.compressedJacobians.end () && cj->function == j) {
+              matrixOut_t J (l.compressedJ.block (cj->row, 0, cj->rows, cj->cols));
+              if (ws.context) fj.valueAndJacobianCompressed (output, J, arg, *ws.context);
+              else            fj.valueAndJacobianCompressed (output, J, arg);
+              ++cj;
+            } else {
+              if (ws.context) fj.value (output, arg, *ws.context);
+              else            fj.value (output, arg);
+            }
+            l.output.vector ().segment (row, fj.outputSize ()) =
+              output.vector ();
+            row += fj.outputSize ();
+          }
+        } else {
+          SolverTelemetry::Timer timer (telemetry_.get (),
+                                        SolverTelemetry::VALUE);
+          if (ws.context) f.value (l.output, arg, *ws.context);
+          else            f.value (l.output, arg);
+        }
+        difference (l.output, d.rightHandSide, l.error);
+        applyComparison<ComputeJac>(d.comparison, d.inequalityIndices, l.error, l.compressedJ, inequalityThreshold_);
+        d.activeRows.gather (l.error, l.reducedError);
+
+        if (ComputeJac) copyCompressedJacobians (i, ws);
+      }
+      if (ws.context) ws.context->unlockConfiguration ();
+      if (ComputeJac) {
+        ++ws.jacobianEvaluations;
+        ws.exactJacobian = true;
+      }
+    }
 
-        f.value   (d.output, arg);
-        if (ComputeJac) f.jacobian(d.jacobian, arg);
-        d.error = d.output - d.rightHandSide;
-        applyComparison<ComputeJac>(d.comparison, d.inequalityIndices, d.error, d.jacobian, inequalityThreshold_);
+    void HierarchicalIterativeSolver::computeJacobian (vectorIn_t arg,
+                                                      SolverWorkspace& ws) const
+    {
+      if (ws.context) ws.context->lockConfiguration (true);
+      for (std::size_t i = 0; i < stacks_.size (); ++i) {
+        const DifferentiableFunctionStack::Functions_t& fs =
+          stacks_[i].functions();
+        const Data& d = datas_[i];
+        SolverWorkspace::Level& l = ws.levels[i];
+
+        SolverTelemetry::Timer timer (telemetry_.get (),
+                                      SolverTelemetry::JACOBIAN);
+        for (std::size_t j = 0; j < d.compressedJacobians.size(); ++j) {
+          const Data::CompressedJacobian& cj = d.compressedJacobians[j];
+          const DifferentiableFunction& f = *fs[cj.function];
+          matrixOut_t J (l.compressedJ.block (cj.row, 0, cj.rows, cj.cols));
+          if (ws.context) f.jacobianCompressed (J, arg, *ws.context);
+          else            f.jacobianCompressed (J, arg);
+        }
+        // As in computeValue<true>, the rows of the satisfied inequalities
+        // are zero. Their error was set to zero by computeValue<false>.
+        for (std::size_t k = 0; k < d.inequalityIndices.size(); ++k) {
+          const std::size_t r = d.inequalityIndices[k];
+          if (l.error[r] == 0) l.compressedJ.row (r).setZero ();
+        }
+        copyCompressedJacobians (i, ws);
+      }
+      if (ws.context) ws.context->unlockConfiguration ();
+      ++ws.jacobianEvaluations;
+      ws.exactJacobian = true;
+    }
 
-        // Copy columns that are not reduced
-        if (ComputeJac) d.reducedJ = d.activeRowsOfJ.rview (d.jacobian);
+    void HierarchicalIterativeSolver::copyCompressedJacobians
+    (std::size_t iStack, SolverWorkspace& ws) const
+    {
+      // Copy the compressed columns that are not reduced.
+      const Data& d = datas_[iStack];
+      SolverWorkspace::Level& l = ws.levels[iStack];
+      const bool hasExplicitJ = (l.explicitJ.cols() > 0);
+      for (std::size_t j = 0; j < d.compressedJacobians.size(); ++j) {
+        const Data::CompressedJacobian& cj = d.compressedJacobians[j];
+        copyColumns (l.compressedJ, cj, cj.toReducedJ, l.reducedJ);
+        if (hasExplicitJ)
+          copyColumns (l.compressedJ, cj, cj.toExplicitJ, l.explicitJ);
       }
     }
 
-    template void HierarchicalIterativeSolver::computeValue<false>(vectorIn_t arg) const;
-    template void HierarchicalIterativeSolver::computeValue<true >(vectorIn_t arg) const;
+    template void HierarchicalIterativeSolver::computeValue<false>(vectorIn_t arg, SolverWorkspace& ws) const;
+    template void HierarchicalIterativeSolver::computeValue<true >(vectorIn_t arg, SolverWorkspace& ws) const;
 
-    void HierarchicalIterativeSolver::computeSaturation (vectorIn_t arg) const
+    void HierarchicalIterativeSolver::computeSaturation (vectorIn_t arg,
+                                                         SolverWorkspace& ws) const
     {
       bool applySaturate;
-      applySaturate = saturate_ (arg, saturation_);
+      applySaturate = saturate_ (arg, ws.saturation);
       if (!applySaturate) return;
 
-      reducedSaturation_ = reduction_.transpose().rview (saturation_);
+      reductionPlan_.gather (ws.saturation, ws.reducedSaturation);
       assert (
-          (    reducedSaturation_.array() == -1
-               || reducedSaturation_.array() ==  0
-               || reducedSaturation_.array() ==  1
+          (    ws.reducedSaturation.array() == -1
+               || ws.reducedSaturation.array() ==  0
+               || ws.reducedSaturation.array() ==  1
           ).all() );
 
       for (std::size_t i = 0; i < stacks_.size (); ++i) {
-        Data& d = datas_[i];
+        SolverWorkspace::Level& l = ws.levels[i];
 
-        vector_t error = d.activeRowsOfJ.keepRows().rview(d.error);
-        tmpSat_ = (reducedSaturation_.cast<value_type>().cwiseProduct (d.reducedJ.transpose() * error).array() < 0);
-        for (size_type j = 0; j < tmpSat_.size(); ++j)
-          if (tmpSat_[j])
-            d.reducedJ.col(j).setZero();
+        ws.tmpDqSmall.noalias() = l.reducedJ.transpose() * l.reducedError;
+        ws.tmpSat = (ws.reducedSaturation.cast<value_type>().cwiseProduct (ws.tmpDqSmall).array() < 0);
+        for (size_type j = 0; j < ws.tmpSat.size(); ++j)
+          if (ws.tmpSat[j])
+            l.reducedJ.col(j).setZero();
       }
     }
 
-    void HierarchicalIterativeSolver::getValue (vectorOut_t v) const
+    void HierarchicalIterativeSolver::getValue (vectorOut_t v,
+                                                const SolverWorkspace& ws) const
     {
       size_type row = 0;
-      for (std::size_t i = 0; i < datas_.size(); ++i) {
-        const Data& d = datas_[i];
-        v.segment(row, d.output.vector ().rows()) = d.output.vector ();
-        row += d.output.vector ().rows();
+      for (std::size_t i = 0; i < ws.levels.size(); ++i) {
+        const SolverWorkspace::Level& l = ws.levels[i];
+        v.segment(row, l.output.vector ().rows()) = l.output.vector ();
+        row += l.output.vector ().rows();
       }
       assert (v.rows() == row);
     }
 
-    void HierarchicalIterativeSolver::getReducedJacobian (matrixOut_t J) const
+    void HierarchicalIterativeSolver::getReducedJacobian
+    (matrixOut_t J, const SolverWorkspace& ws) const
     {
       size_type row = 0;
-      for (std::size_t i = 0; i < datas_.size(); ++i) {
-        const Data& d = datas_[i];
-        J.middleRows(row, d.reducedJ.rows()) = d.reducedJ;
-        row += d.reducedJ.rows();
+      for (std::size_t i = 0; i < ws.levels.size(); ++i) {
+        const SolverWorkspace::Level& l = ws.levels[i];
+        J.middleRows(row, l.reducedJ.rows()) = l.reducedJ;
+        row += l.reducedJ.rows();
       }
       assert (J.rows() == row);
     }
 
-    void HierarchicalIterativeSolver::computeError () const
+    void HierarchicalIterativeSolver::computeError (SolverWorkspace& ws) const
     {
       const std::size_t end = (lastIsOptional_ ? stacks_.size() - 1 : stacks_.size());
-      squaredNorm_ = 0;
+      ws.squaredNorm = 0;
       for (std::size_t i = 0; i < end; ++i) {
         const DifferentiableFunctionStack::Functions_t& fs = stacks_[i].functions();
-        const Data& d = datas_[i];
+        const SolverWorkspace::Level& l = ws.levels[i];
         size_type row = 0;
         for (std::size_t j = 0; j < fs.size(); ++j) {
-          squaredNorm_ = std::max(squaredNorm_,
-            d.error.segment(row, fs[j]->outputSize()).squaredNorm());
+          ws.squaredNorm = std::max(ws.squaredNorm,
+            l.error.segment(row, fs[j]->outputSize()).squaredNorm());
           row += fs[j]->outputSize();
         }
       }
     }
 
-    void HierarchicalIterativeSolver::residualError (vectorOut_t error) const
+    void HierarchicalIterativeSolver::residualError
+    (vectorOut_t error, const SolverWorkspace& ws) const
     {
       size_type row = 0;
-      for (std::size_t i = 0; i < datas_.size(); ++i) {
-        const Data& d = datas_[i]; 
-        error.segment(row, d.error.size()) = d.error;
-        row += d.error.size();
+      for (std::size_t i = 0; i < ws.levels.size(); ++i) {
+        const SolverWorkspace::Level& l = ws.levels[i];
+        error.segment(row, l.error.size()) = l.error;
+        row += l.error.size();
       }
     }
 
-    void HierarchicalIterativeSolver::computeDescentDirection () const
+    void HierarchicalIterativeSolver::computeDescentDirection
+    (SolverWorkspace& ws) const
     {
-      sigma_ = std::numeric_limits<value_type>::max();
+      SolverTelemetry::Timer timer (telemetry_.get (),
+                                    SolverTelemetry::DESCENT_DIRECTION);
+      ws.sigma = std::numeric_limits<value_type>::max();
 
+      ws.solvedLevels = 0;
       if (stacks_.empty()) {
-        dq_.setZero();
+        ws.dq.setZero();
         return;
       }
-      vector_t err;
-      if (stacks_.size() == 1) { // one level only
-        Data& d = datas_[0];
-        d.svd.compute (d.reducedJ);
-        HPP_DEBUG_SVDCHECK (d.svd);
-        // TODO Eigen::JacobiSVD does a dynamic allocation here.
-        err = d.activeRowsOfJ.keepRows().rview(- d.error);
-        dqSmall_ = d.svd.solve (err);
-        d.maxRank = std::max(d.maxRank, d.svd.rank());
-        if (d.maxRank > 0)
-          sigma_ = std::min(sigma_, d.svd.singularValues()[d.maxRank - 1]);
+      // The descent direction is computed for the opposite of the error and
+      // negated at the end.
+      if (blocks_.empty ()) {
+        ws.solvedLevels = solveLevels (ws.levels, ws.dqSmall, ws.tmpDqSmall,
+                                       ws.sigma);
       } else {
-        projector_.setIdentity();
-        for (std::size_t i = 0; i < stacks_.size (); ++i) {
-          const DifferentiableFunctionStack& f = stacks_[i];
-          Data& d = datas_[i];
-
-          // TODO: handle case where this is the first element of the stack and it
-          // has no functions
-          if (f.outputSize () == 0) continue;
-          /// projector is of size numberDof
-          bool first = (i == 0);
-          bool last = (i == stacks_.size() - 1);
-          err = d.activeRowsOfJ.keepRows().rview(- d.error);
-          if (first) {
-            // dq should be zero and projector should be identity
-            d.svd.compute (d.reducedJ);
-            HPP_DEBUG_SVDCHECK (d.svd);
-            // TODO Eigen::JacobiSVD does a dynamic allocation here.
-            dqSmall_ = d.svd.solve (err);
-          } else {
-            d.svd.compute (d.reducedJ * projector_);
-            HPP_DEBUG_SVDCHECK (d.svd);
-            // TODO Eigen::JacobiSVD does a dynamic allocation here.
-            dqSmall_ += d.svd.solve (err - d.reducedJ * dqSmall_);
-          }
-          // Update sigma
-          d.maxRank = std::max(d.maxRank, d.svd.rank());
-          if (d.maxRank > 0)
-            sigma_ = std::min(sigma_, d.svd.singularValues()[d.maxRank - 1]);
-
-          if (last) break; // No need to compute projector for next step.
-          if (!(d.reducedJ * dqSmall_ - err).isZero ()) break;
-          /// compute projector for next step.
-          projectorOnSpan <SVD_t> (d.svd, d.PK);
-          projector_ -= d.PK;
+        if (blockPool_ != NULL)
+          blockPool_->run (blocks_.size (), boost::bind
+              (&HierarchicalIterativeSolver::solveBlock, this, _1,
+               boost::ref (ws)));
+        else
+          for (std::size_t b = 0; b < blocks_.size (); ++b)
+            solveBlock (b, ws);
+        // The variables which are not in a block do not influence the
+        // error.
+        ws.dqSmall.setZero ();
+        for (std::size_t b = 0; b < blocks_.size (); ++b) {
+          const SolverWorkspace::Block& wb = ws.blocks[b];
+          blocks_[b].cols.lview (ws.dqSmall) = wb.dqSmall;
+          ws.sigma = std::min (ws.sigma, wb.sigma);
+          ws.solvedLevels = std::max (ws.solvedLevels,
+              blocks_[b].levels[wb.solvedLevels - 1] + 1);
         }
       }
-      expandDqSmall();
+      ws.dqSmall *= -1;
+      expandDqSmall(ws);
     }
 
-    void HierarchicalIterativeSolver::expandDqSmall () const
+    void HierarchicalIterativeSolver::solveBlock (std::size_t b,
+                                                  SolverWorkspace& ws) const
     {
-      Eigen::MatrixBlockView<vector_t, Eigen::Dynamic, 1, false, true> (dq_, reduction_.nbIndices(), reduction_.indices()) = dqSmall_;
+      const Block& block = blocks_[b];
+      SolverWorkspace::Block& wb = ws.blocks[b];
+      for (std::size_t k = 0; k < block.levels.size (); ++k) {
+        const SolverWorkspace::Level& l = ws.levels[block.levels[k]];
+        SolverWorkspace::Level& bl = wb.levels[k];
+        bl.reducedJ = block.jacobians[k].rview (l.reducedJ);
+        bl.reducedError = block.jacobians[k].keepRows ().rview
+          (l.reducedError);
+      }
+      wb.sigma = std::numeric_limits<value_type>::max();
+      wb.solvedLevels = solveLevels (wb.levels, wb.dqSmall, wb.tmpDqSmall,
+                                     wb.sigma);
+    }
+
+    void HierarchicalIterativeSolver::computeDampedDescentDirection
+    (const value_type& lambda, SolverWorkspace& ws) const
+    {
+      if (blocks_.empty ()) {
+        solveDampedLevels (ws.levels, ws.solvedLevels, lambda, ws.dqSmall,
+                           ws.tmpDqSmall);
+      } else {
+        ws.dqSmall.setZero ();
+        for (std::size_t b = 0; b < blocks_.size (); ++b) {
+          const Block& block = blocks_[b];
+          SolverWorkspace::Block& wb = ws.blocks[b];
+          // The errors may have been modified since computeDescentDirection.
+          for (std::size_t k = 0; k < wb.solvedLevels; ++k)
+            wb.levels[k].reducedError = block.jacobians[k].keepRows ().rview
+              (ws.levels[block.levels[k]].reducedError);
+          solveDampedLevels (wb.levels, wb.solvedLevels, lambda, wb.dqSmall,
+                             wb.tmpDqSmall);
+          block.cols.lview (ws.dqSmall) = wb.dqSmall;
+        }
+      }
+      ws.dqSmall *= -1;
+      expandDqSmall(ws);
+    }
+
+    void HierarchicalIterativeSolver::expandDqSmall (SolverWorkspace& ws) const
+    {
+      reductionPlan_.scatter (ws.dqSmall, ws.dq);
+    }
+
+    void HierarchicalIterativeSolver::multiplyByKernelBasis
+    (std::size_t level, vectorOut_t v, const SolverWorkspace& ws) const
+    {
+      constraints::multiplyByKernelBasis (ws.levels, level, v);
+    }
+
+    void HierarchicalIterativeSolver::saveJacobianAndError
+    (SolverWorkspace& ws) const
+    {
+      if (maxJacobianReuse_ == 0) return;
+      for (std::size_t i = 0; i < stacks_.size (); ++i) {
+        SolverWorkspace::Level& l = ws.levels[i];
+        // Saturation modifies reducedJ so the estimate is kept apart.
+        if (ws.exactJacobian) l.approxJ = l.reducedJ;
+        l.previousError = l.reducedError;
+      }
+      ws.previousSquaredNorm = ws.squaredNorm;
+    }
+
+    void HierarchicalIterativeSolver::computeValueAndJacobian
+    (vectorIn_t arg, SolverWorkspace& ws) const
+    {
+      // Step in the reduced space. The line search stores it in dq.
+      value_type ss = 0;
+      if (maxJacobianReuse_ > 0) {
+        reductionPlan_.gather (ws.dq, ws.tmpDqSmall);
+        ss = ws.tmpDqSmall.squaredNorm ();
+      }
+      if (maxJacobianReuse_ == 0 || ws.consecutiveUpdates >= maxJacobianReuse_
+          || ss == 0) {
+        computeValue<true> (arg, ws);
+        computeError (ws);
+        ws.consecutiveUpdates = 0;
+        return;
+      }
+
+      computeValue<false> (arg, ws);
+      computeError (ws);
+      if (ws.squaredNorm > jacobianReuseRatio_ * ws.previousSquaredNorm) {
+        // The error reduction stalls: evaluate the Jacobians at the
+        // values already computed.
+        computeJacobian (arg, ws);
+        ws.consecutiveUpdates = 0;
+        return;
+      }
+
+      // Broyden update: J += (df - J dq) dq^T / ||dq||^2
+      for (std::size_t i = 0; i < stacks_.size (); ++i) {
+        SolverWorkspace::Level& l = ws.levels[i];
+        l.residual = l.reducedError;
+        l.residual -= l.previousError;
+        l.residual.noalias() -= l.approxJ * ws.tmpDqSmall;
+        l.residual /= ss;
+        l.approxJ.noalias() += l.residual * ws.tmpDqSmall.transpose();
+        l.reducedJ = l.approxJ;
+        // As in computeValue<true>, the rows of the satisfied inequalities
+        // are zero.
+        const Data& d = datas_[i];
+        for (std::size_t k = 0; k < d.activeInequalityRows.size(); ++k) {
+          const size_type r = d.activeInequalityRows[k];
+          if (l.reducedError[r] == 0) l.reducedJ.row (r).setZero ();
+        }
+      }
+      ws.exactJacobian = false;
+      ++ws.consecutiveUpdates;
+      ++ws.jacobianUpdates;
     }
 
     std::ostream& HierarchicalIterativeSolver::print (std::ostream& os) const
@@ -481,9 +1142,16 @@ namespace hpp {
       return os << decindent;
     }
 
-    template HierarchicalIterativeSolver::Status HierarchicalIterativeSolver::solve (vectorOut_t arg, lineSearch::Constant       lineSearch) const;
-    template HierarchicalIterativeSolver::Status HierarchicalIterativeSolver::solve (vectorOut_t arg, lineSearch::Backtracking   lineSearch) const;
-    template HierarchicalIterativeSolver::Status HierarchicalIterativeSolver::solve (vectorOut_t arg, lineSearch::FixedSequence  lineSearch) const;
-    template HierarchicalIterativeSolver::Status HierarchicalIterativeSolver::solve (vectorOut_t arg, lineSearch::ErrorNormBased lineSearch) const;
+    template HierarchicalIterativeSolver::Status HierarchicalIterativeSolver::solve (vectorOut_t arg, SolverWorkspace& ws, lineSearch::Constant       lineSearch) const;
+    template HierarchicalIterativeSolver::Status HierarchicalIterativeSolver::solve (vectorOut_t arg, SolverWorkspace& ws, lineSearch::Backtracking   lineSearch) const;
+    template HierarchicalIterativeSolver::Status HierarchicalIterativeSolver::solve (vectorOut_t arg, SolverWorkspace& ws, lineSearch::FixedSequence  lineSearch) const;
+    template HierarchicalIterativeSolver::Status HierarchicalIterativeSolver::solve (vectorOut_t arg, SolverWorkspace& ws, lineSearch::ErrorNormBased lineSearch) const;
+    template HierarchicalIterativeSolver::Status HierarchicalIterativeSolver::solve (vectorOut_t arg, SolverWorkspace& ws, lineSearch::LevenbergMarquardt lineSearch) const;
+
+    template void HierarchicalIterativeSolver::impl_solveBatch (const HierarchicalIterativeSolver& solver, matrixOut_t configs, std::vector<Status>& status, const lineSearch::Constant      & ls, WorkStealingPool& pool);
+    template void HierarchicalIterativeSolver::impl_solveBatch (const HierarchicalIterativeSolver& solver, matrixOut_t configs, std::vector<Status>& status, const lineSearch::Backtracking  & ls, WorkStealingPool& pool);
+    template void HierarchicalIterativeSolver::impl_solveBatch (const HierarchicalIterativeSolver& solver, matrixOut_t configs, std::vector<Status>& status, const lineSearch::FixedSequence & ls, WorkStealingPool& pool);
+    template void HierarchicalIterativeSolver::impl_solveBatch (const HierarchicalIterativeSolver& solver, matrixOut_t configs, std::vector<Status>& status, const lineSearch::ErrorNormBased& ls, WorkStealingPool& pool);
+    template void HierarchicalIterativeSolver::impl_solveBatch (const HierarchicalIterativeSolver& solver, matrixOut_t configs, std::vector<Status>& status, const lineSearch::LevenbergMarquardt& ls, WorkStealingPool& pool);
   } // namespace constraints
 } // namespace hpp
@@ -16,6 +16,8 @@
 
 #include <hpp/constraints/matrix-view.hh>
 
+#include <iterator>
+
 namespace Eigen {
   typedef hpp::constraints::size_type size_type;
 
@@ -37,6 +39,39 @@ namespace Eigen {
     };
   }
 
+  const size_type IndexPlan::longRun;
+
+  IndexPlan::IndexPlan (const BlockIndex::segments_t& segments)
+    : size (0)
+  {
+    // Merge adjacent segments
+    BlockIndex::segments_t merged;
+    for (std::size_t i = 0; i < segments.size (); ++i) {
+      if (segments[i].second == 0) continue;
+      if (!merged.empty () &&
+          merged.back ().first + merged.back ().second == segments[i].first)
+        merged.back ().second += segments[i].second;
+      else
+        merged.push_back (segments[i]);
+    }
+    for (std::size_t i = 0; i < merged.size (); ++i) {
+      const BlockIndex::segment_t& s = merged[i];
+      if (s.second >= longRun) {
+        Run run;
+        run.in = s.first;
+        run.out = size;
+        run.size = s.second;
+        runs.push_back (run);
+      } else {
+        for (size_type j = 0; j < s.second; ++j) {
+          in.push_back (s.first + j);
+          out.push_back (size + j);
+        }
+      }
+      size += s.second;
+    }
+  }
+
   void BlockIndex::sort (segments_t& a)
   {
     std::sort (a.begin(), a.end(), internal::BlockIndexCompFull ());
@@ -45,19 +80,17 @@ namespace Eigen {
   void BlockIndex::shrink (segments_t& a)
   {
     if (a.size() < 2) return;
-    // Find consecutive element which overlap
-    typename segments_t::iterator e2 = a.begin();
-    typename segments_t::iterator e1 = e2++;
+    // Merge consecutive elements which overlap in place, and erase the
+    // remaining elements at once.
+    segments_t::iterator e1 = a.begin();
     internal::BlockIndexComp<false, true> lend_before_rstart;
-    while (e2 != a.end()) {
-      if (!lend_before_rstart(*e1, *e2)) {
+    for (segments_t::iterator e2 = e1 + 1; e2 != a.end(); ++e2) {
+      if (!lend_before_rstart(*e1, *e2))
         e1->second = std::max(e1->second, e2->first + e2->second - e1->first);
-        e2 = a.erase(e2);
-      } else {
-        e1 = e2;
-        ++e2;
-      }
+      else
+        *(++e1) = *e2;
     }
+    a.erase (++e1, a.end());
   }
 
   bool BlockIndex::overlap (const segment_t& a, const segment_t& b)
@@ -111,12 +144,11 @@ namespace Eigen {
       a = b;
       return;
     }
-    segments_t::iterator _a = a.begin();
-    for (segments_t::const_iterator _b = b.begin(); _b != b.end(); ++_b) {
-      _a = std::upper_bound (_a, a.end(), *_b, internal::BlockIndexCompFull ());
-      _a = a.insert (_a, *_b);
-      ++_a;
-    }
+    segments_t c;
+    c.reserve (a.size() + b.size());
+    std::merge (a.begin(), a.end(), b.begin(), b.end(),
+                std::back_inserter (c), internal::BlockIndexCompFull ());
+    a.swap (c);
   }
 
   BlockIndex::segments_t BlockIndex::difference (const segment_t& a,
@@ -164,21 +196,29 @@ namespace Eigen {
   BlockIndex::segments_t BlockIndex::difference (const segment_t& a,
                                                   const segments_t& b)
   {
-    segments_t diff (1, a);
-    for (typename segments_t::const_iterator _b = b.begin(); _b != b.end();
-         ++_b)
-      diff = difference (diff, *_b);
-    return diff;
+    return difference (segments_t (1, a), b);
   }
 
   BlockIndex::segments_t BlockIndex::difference (const segments_t& a,
                                                   const segments_t& b)
   {
+    // Sweep both sorted sets of segments at once.
     segments_t diff;
-    for (typename segments_t::const_iterator _a = a.begin(); _a != a.end();
-         ++_a) {
-      segments_t d = difference(*_a, b);
-      diff.insert(diff.end(), d.begin(), d.end());
+    diff.reserve (a.size() + b.size());
+    segments_t::const_iterator first = b.begin();
+    for (segments_t::const_iterator _a = a.begin(); _a != a.end(); ++_a) {
+      size_type cur = _a->first;
+      const size_type end = _a->first + _a->second;
+      // Segments of b ending before _a also end before the next segments.
+      while (first != b.end() && first->first + first->second <= cur)
+        ++first;
+      for (segments_t::const_iterator _b = first;
+           _b != b.end() && _b->first < end; ++_b) {
+        if (_b->second == 0) continue;
+        if (_b->first > cur) diff.push_back (segment_t (cur, _b->first - cur));
+        cur = std::max (cur, _b->first + _b->second);
+      }
+      if (cur < end) diff.push_back (segment_t (cur, end - cur));
     }
     return diff;
   }
@@ -191,22 +231,22 @@ namespace Eigen {
     segments_t result;
     size_type remaining = cardinal;
     segments_t::iterator it (segments.begin ());
-    while (it != segments.end ()) {
+    for (; it != segments.end (); ++it) {
       if (it->second > remaining) {
         result.push_back (segment_t (it->first, remaining));
         it->first += remaining;
         it->second -= remaining;
-        return result;
-      } else if (it->second == remaining) {
-        result.push_back (*it);
-        it = segments.erase (it);
-        return result;
-      } else {
-        remaining -= it->second;
-        result.push_back (*it);
-        it = segments.erase (it);
+        break;
+      }
+      result.push_back (*it);
+      remaining -= it->second;
+      if (remaining == 0) {
+        ++it;
+        break;
       }
     }
+    // Erase the segments moved to result at once.
+    segments.erase (segments.begin (), it);
     return result;
   }
 
@@ -257,4 +297,93 @@ namespace Eigen {
     // Avoid compilation warning
     return segments_t();
   }
+
+  IntervalSet::IntervalSet (const segments_t& segments) : cardinal_ (0)
+  {
+    insert (segments);
+  }
+
+  void IntervalSet::insert (const segment_t& segment)
+  {
+    if (segment.second <= 0) return;
+    size_type first = segment.first, end = segment.first + segment.second;
+    // First interval which overlaps or touches segment
+    Intervals_t::iterator it = intervals_.upper_bound (first);
+    if (it != intervals_.begin ()) {
+      Intervals_t::iterator prev = it; --prev;
+      if (prev->second >= first) it = prev;
+    }
+    // Merge the intervals which overlap or touch segment
+    while (it != intervals_.end () && it->first <= end) {
+      first = std::min (first, it->first);
+      end = std::max (end, it->second);
+      cardinal_ -= it->second - it->first;
+      intervals_.erase (it++);
+    }
+    intervals_.insert (it, Intervals_t::value_type (first, end));
+    cardinal_ += end - first;
+  }
+
+  void IntervalSet::insert (const segments_t& segments)
+  {
+    for (std::size_t i = 0; i < segments.size (); ++i)
+      insert (segments[i]);
+  }
+
+  void IntervalSet::erase (const segment_t& segment)
+  {
+    if (segment.second <= 0) return;
+    const size_type first = segment.first,
+          end = segment.first + segment.second;
+    // First interval which overlaps segment
+    Intervals_t::iterator it = intervals_.upper_bound (first);
+    if (it != intervals_.begin ()) {
+      Intervals_t::iterator prev = it; --prev;
+      if (prev->second > first) it = prev;
+    }
+    while (it != intervals_.end () && it->first < end) {
+      const size_type ifirst = it->first, iend = it->second;
+      cardinal_ -= iend - ifirst;
+      intervals_.erase (it++);
+      // Keep the parts of the interval outside of segment.
+      if (ifirst < first) {
+        intervals_.insert (it, Intervals_t::value_type (ifirst, first));
+        cardinal_ += first - ifirst;
+      }
+      if (end < iend) {
+        intervals_.insert (it, Intervals_t::value_type (end, iend));
+        cardinal_ += iend - end;
+        break;
+      }
+    }
+  }
+
+  bool IntervalSet::contains (size_type i) const
+  {
+    Intervals_t::const_iterator it = intervals_.upper_bound (i);
+    if (it == intervals_.begin ()) return false;
+    --it;
+    return i < it->second;
+  }
+
+  IntervalSet::segments_t IntervalSet::segments () const
+  {
+    segments_t s;
+    s.reserve (intervals_.size ());
+    for (Intervals_t::const_iterator it = intervals_.begin ();
+         it != intervals_.end (); ++it)
+      s.push_back (segment_t (it->first, it->second - it->first));
+    return s;
+  }
+
+  IntervalSet::segments_t IntervalSet::unite (const segments_t& a,
+                                              const segments_t& b)
+  {
+    segments_t u;
+    u.reserve (a.size() + b.size());
+    std::merge (a.begin(), a.end(), b.begin(), b.end(),
+                std::back_inserter (u), internal::BlockIndexCompFull ());
+    BlockIndex::shrink (u);
+    return u;
+  }
 } // namespace Eigen
@@ -134,39 +134,45 @@ namespace hpp {
     void QPStaticStability::impl_compute (LiegroupElement& result,
                                           ConfigurationIn_t argument) const
     {
-      robot_->currentConfiguration (argument);
-      robot_->computeForwardKinematics ();
+      computeQP (result.vector (), argument, false);
+    }
 
-      phi_.invalidate ();
-      phi_.computeValue ();
-      // phi_.computeSVD ();
+    void QPStaticStability::impl_jacobian (matrixOut_t jacobian, ConfigurationIn_t argument) const
+    {
+      vector_t res(1);
+      computeQP (res, argument, true);
+      computeJacobian (jacobian);
+    }
 
-      qpOASES::returnValue ret = solveQP (result.vector ());
-      if (ret != qpOASES::SUCCESSFUL_RETURN) {
-        hppDout (error, "QP could not be solved. Error is " << ret);
-      }
-      if (!checkQPSol ()) {
-        hppDout (error, "QP solution does not satisfies the constraints");
-      }
+    void QPStaticStability::impl_valueAndJacobian (LiegroupElement& result,
+        matrixOut_t jacobian, ConfigurationIn_t argument) const
+    {
+      computeQP (result.vector (), argument, true);
+      computeJacobian (jacobian);
     }
 
-    void QPStaticStability::impl_jacobian (matrixOut_t jacobian, ConfigurationIn_t argument) const
+    void QPStaticStability::computeQP (vectorOut_t result,
+        ConfigurationIn_t argument, bool jacobian) const
     {
       robot_->currentConfiguration (argument);
       robot_->computeForwardKinematics ();
 
       phi_.invalidate ();
       // phi_.computeSVD ();
-      phi_.computeJacobian ();
+      if (jacobian) phi_.computeJacobian ();
+      else          phi_.computeValue ();
 
-      vector_t res(1);
-      qpOASES::returnValue ret = solveQP (res);
+      qpOASES::returnValue ret = solveQP (result);
       if (ret != qpOASES::SUCCESSFUL_RETURN) {
         hppDout (error, "QP could not be solved. Error is " << ret);
       }
       if (!checkQPSol ()) {
         hppDout (error, "QP solution does not satisfies the constraints");
       }
+    }
+
+    void QPStaticStability::computeJacobian (matrixOut_t jacobian) const
+    {
       if (!checkStrictComplementarity ()) {
         hppDout (error, "Strict complementary slackness does not hold. "
             "Jacobian WILL be wrong.");
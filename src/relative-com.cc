@@ -97,6 +97,31 @@ namespace hpp {
       robot_->currentConfiguration (argument);
       robot_->computeForwardKinematics ();
       comc_->compute (Device::COM);
+      computeValue (result);
+    }
+
+    void RelativeCom::impl_jacobian (matrixOut_t jacobian,
+				     ConfigurationIn_t arg) const throw ()
+    {
+      robot_->currentConfiguration (arg);
+      robot_->computeForwardKinematics ();
+      comc_->compute (Device::ALL);
+      computeJacobian (jacobian);
+    }
+
+    void RelativeCom::impl_valueAndJacobian (LiegroupElement& result,
+                                             matrixOut_t jacobian,
+                                             ConfigurationIn_t arg) const
+    {
+      robot_->currentConfiguration (arg);
+      robot_->computeForwardKinematics ();
+      comc_->compute (Device::ALL);
+      computeValue (result);
+      computeJacobian (jacobian);
+    }
+
+    void RelativeCom::computeValue (LiegroupElement& result) const
+    {
       const Transform3f& M = joint_->currentTransformation ();
       const vector3_t& x = comc_->com ();
       const matrix3_t& R = M.rotation ();
@@ -115,12 +140,8 @@ namespace hpp {
       }
     }
 
-    void RelativeCom::impl_jacobian (matrixOut_t jacobian,
-				     ConfigurationIn_t arg) const throw ()
+    void RelativeCom::computeJacobian (matrixOut_t jacobian) const
     {
-      robot_->currentConfiguration (arg);
-      robot_->computeForwardKinematics ();
-      comc_->compute (Device::ALL);
       const ComJacobian_t& Jcom = comc_->jacobian ();
       const JointJacobian_t& Jjoint (joint_->jacobian ());
       const Transform3f& M = joint_->currentTransformation ();
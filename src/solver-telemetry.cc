@@ -0,0 +1,138 @@
+// Copyright (c) 2018, Joseph Mirabel
+// Authors: Joseph Mirabel (joseph.mirabel@laas.fr)
+//
+// This file is part of hpp-constraints.
+// hpp-constraints is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-constraints is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-constraints. If not, see <http://www.gnu.org/licenses/>.
+
+#include <hpp/constraints/solver-telemetry.hh>
+
+#include <algorithm>
+#include <boost/static_assert.hpp>
+
+#include <hpp/util/indent.hh>
+
+#include <hpp/constraints/iterative-solver.hh>
+
+namespace hpp {
+  namespace constraints {
+    BOOST_STATIC_ASSERT (HierarchicalIterativeSolver::SUCCESS + 1 ==
+                         (int) SolverTelemetry::NB_STATUS);
+
+    namespace {
+      const char* statusNames[SolverTelemetry::NB_STATUS] = {
+        "ERROR_INCREASED", "MAX_ITERATION_REACHED", "INFEASIBLE", "SUCCESS"
+      };
+    }
+
+    SolverTelemetry::SolverTelemetry ()
+    {
+      reset ();
+    }
+
+    void SolverTelemetry::reset ()
+    {
+      for (std::size_t i = 0; i < NB_PHASES; ++i) {
+        time_ [i].store (0, boost::memory_order_relaxed);
+        calls_[i].store (0, boost::memory_order_relaxed);
+      }
+      for (std::size_t i = 0; i < NB_STATUS; ++i)
+        status_[i].store (0, boost::memory_order_relaxed);
+      for (std::size_t i = 0; i < NB_ITERATION_BINS; ++i)
+        iterationBins_[i].store (0, boost::memory_order_relaxed);
+      iterations_.store (0, boost::memory_order_relaxed);
+    }
+
+    void SolverTelemetry::addResolution (std::size_t status,
+                                         size_type iterations)
+    {
+      assert (status < NB_STATUS);
+      assert (iterations >= 0);
+      const std::size_t bin = std::min (std::size_t (iterations),
+                                        NB_ITERATION_BINS - 1);
+      status_[status].fetch_add (1, boost::memory_order_relaxed);
+      iterationBins_[bin].fetch_add (1, boost::memory_order_relaxed);
+      iterations_.fetch_add (iterations, boost::memory_order_relaxed);
+    }
+
+    value_type SolverTelemetry::time (Phase phase) const
+    {
+      return 1e-9 * (value_type)time_[phase].load (boost::memory_order_relaxed);
+    }
+
+    std::size_t SolverTelemetry::calls (Phase phase) const
+    {
+      return calls_[phase].load (boost::memory_order_relaxed);
+    }
+
+    std::size_t SolverTelemetry::resolutions () const
+    {
+      std::size_t res = 0;
+      for (std::size_t i = 0; i < NB_STATUS; ++i) res += resolutions (i);
+      return res;
+    }
+
+    std::size_t SolverTelemetry::resolutions (std::size_t status) const
+    {
+      assert (status < NB_STATUS);
+      return status_[status].load (boost::memory_order_relaxed);
+    }
+
+    std::vector<std::size_t> SolverTelemetry::iterationHistogram () const
+    {
+      std::vector<std::size_t> res (NB_ITERATION_BINS);
+      for (std::size_t i = 0; i < NB_ITERATION_BINS; ++i)
+        res[i] = iterationBins_[i].load (boost::memory_order_relaxed);
+      return res;
+    }
+
+    std::size_t SolverTelemetry::iterations () const
+    {
+      return iterations_.load (boost::memory_order_relaxed);
+    }
+
+    const char* SolverTelemetry::phaseName (Phase phase)
+    {
+      switch (phase) {
+        case VALUE            : return "value";
+        case JACOBIAN         : return "jacobian";
+        case EXPLICIT_JACOBIAN: return "explicit jacobian";
+        case DESCENT_DIRECTION: return "descent direction";
+        case LINE_SEARCH      : return "line search";
+        case EXPLICIT_SOLVE   : return "explicit solve";
+        default               : return "unknown";
+      }
+    }
+
+    std::ostream& SolverTelemetry::print (std::ostream& os) const
+    {
+      os << "SolverTelemetry, " << resolutions () << " resolutions, "
+        << iterations () << " iterations" << incindent;
+      for (std::size_t i = 0; i < NB_PHASES; ++i) {
+        const Phase p = (Phase) i;
+        os << iendl << phaseName (p) << ": " << time (p) << " s, "
+          << calls (p) << " calls";
+      }
+      for (std::size_t i = 0; i < NB_STATUS; ++i)
+        os << iendl << statusNames[i] << ": " << resolutions (i);
+      os << iendl << "iterations:";
+      std::vector<std::size_t> histogram (iterationHistogram ());
+      for (std::size_t i = 0; i < histogram.size (); ++i) {
+        if (histogram[i] == 0) continue;
+        os << ' ' << i;
+        if (i + 1 == histogram.size ()) os << '+';
+        os << ':' << histogram[i];
+      }
+      return os << decindent;
+    }
+  } // namespace constraints
+} // namespace hpp
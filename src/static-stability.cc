@@ -45,7 +45,7 @@ namespace hpp {
       uDot_ (contacts.size(), robot->numberDof()),
       uMinusDot_ (contacts.size(), robot->numberDof()),
       vDot_ (contacts.size(), robot->numberDof()),
-      lambdaDot_ (robot->numberDof())
+      lambdaDot_ (robot->numberDof()), hasUminus_ (false)
     {
       phi_.setSize (2,contacts.size());
       Traits<PointCom>::Ptr_t OG = PointCom::create (com);
@@ -76,6 +76,27 @@ namespace hpp {
 
     void StaticStability::impl_compute (LiegroupElement& result,
                                         ConfigurationIn_t argument) const
+    {
+      computeU (argument, false);
+      computeValue (result);
+    }
+
+    void StaticStability::impl_jacobian (matrixOut_t jacobian, ConfigurationIn_t argument) const
+    {
+      computeU (argument, true);
+      computeJacobian (jacobian);
+    }
+
+    void StaticStability::impl_valueAndJacobian (LiegroupElement& result,
+        matrixOut_t jacobian, ConfigurationIn_t argument) const
+    {
+      computeU (argument, true);
+      computeValue (result);
+      computeJacobian (jacobian);
+    }
+
+    void StaticStability::computeU (ConfigurationIn_t argument,
+                                    bool jacobian) const
     {
       robot_->currentConfiguration (argument);
       robot_->computeForwardKinematics ();
@@ -83,11 +104,19 @@ namespace hpp {
       phi_.invalidate ();
 
       phi_.computeSVD ();
+      if (jacobian) {
+        phi_.computeJacobian ();
+        phi_.computePseudoInverse ();
+      }
 
       const Eigen::Matrix <value_type, 6, 1> G = - 1 * Gravity;
       u_.noalias() = phi_.svd().solve (G);
+      hasUminus_ = computeUminusAndV (u_, uMinus_, v_);
+    }
 
-      if (computeUminusAndV (u_, uMinus_, v_)) {
+    void StaticStability::computeValue (LiegroupElement& result) const
+    {
+      if (hasUminus_) {
         // value_type lambda, unused_lMax; size_type iMax, iMin;
         // findBoundIndex (u_, v_, lambda, &iMin, unused_lMax, &iMax);
         value_type lambda = 1;
@@ -100,26 +129,16 @@ namespace hpp {
         Gravity + phi_.value() * u_;
     }
 
-    void StaticStability::impl_jacobian (matrixOut_t jacobian, ConfigurationIn_t argument) const
+    void StaticStability::computeJacobian (matrixOut_t jacobian) const
     {
-      robot_->currentConfiguration (argument);
-      robot_->computeForwardKinematics ();
-
-      phi_.invalidate ();
-
-      phi_.computeSVD ();
-      phi_.computeJacobian ();
-      phi_.computePseudoInverse ();
-
       const Eigen::Matrix <value_type, 6, 1> G = - 1 * Gravity;
-      u_.noalias() = phi_.svd().solve (G);
       phi_.computePseudoInverseJacobian (G);
       uDot_.noalias () = phi_.pinvJacobian ();
 
       jacobian.block (0, 0, contacts_.size(), robot_->numberDof()).noalias ()
         = uDot_;
 
-      if (computeUminusAndV (u_, uMinus_, v_)) {
+      if (hasUminus_) {
         matrix_t S = - matrix_t::Identity (u_.size(), u_.size());
         S.diagonal () = 1 * (u_.array () >= 0).select
           (0, - vector_t::Ones (u_.size()));
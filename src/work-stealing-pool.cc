@@ -0,0 +1,210 @@
+// Copyright (c) 2018, Joseph Mirabel
+// Authors: Joseph Mirabel (joseph.mirabel@laas.fr)
+//
+// This file is part of hpp-constraints.
+// hpp-constraints is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-constraints is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-constraints. If not, see <http://www.gnu.org/licenses/>.
+
+#include <hpp/constraints/work-stealing-pool.hh>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+namespace hpp {
+  namespace constraints {
+    struct WorkStealingPool::Impl
+    {
+      /// Tasks [begin, end) remaining for one thread.
+      struct Range
+      {
+        Range () : begin (0), end (0) {}
+        boost::mutex mutex;
+        std::size_t begin, end;
+      };
+      typedef boost::shared_ptr<Range> RangePtr_t;
+
+      Impl () : generation (0), active (0), stop (false), task (NULL),
+        failed (false)
+      {}
+
+      /// Take the next task of thread w.
+      bool pop (std::size_t w, std::size_t& t)
+      {
+        Range& r = *ranges[w];
+        boost::mutex::scoped_lock lock (r.mutex);
+        if (r.begin == r.end) return false;
+        t = r.begin++;
+        return true;
+      }
+
+      /// Move half of the tasks of another thread to thread w.
+      /// \return false if there is no task left.
+      bool steal (std::size_t w)
+      {
+        const std::size_t n = ranges.size();
+        for (std::size_t k = 1; k < n; ++k) {
+          Range& victim = *ranges[(w + k) % n];
+          std::size_t b, e;
+          {
+            boost::mutex::scoped_lock lock (victim.mutex);
+            const std::size_t remaining = victim.end - victim.begin;
+            if (remaining == 0) continue;
+            e = victim.end;
+            b = victim.end - (remaining + 1) / 2;
+            victim.end = b;
+          }
+          Range& own = *ranges[w];
+          boost::mutex::scoped_lock lock (own.mutex);
+          own.begin = b;
+          own.end   = e;
+          return true;
+        }
+        return false;
+      }
+
+      void work (std::size_t w)
+      {
+        std::size_t seen = 0;
+        while (true) {
+          {
+            boost::mutex::scoped_lock lock (mutex);
+            while (!stop && generation == seen) start.wait (lock);
+            if (stop) return;
+            seen = generation;
+          }
+          std::size_t t;
+          while (true) {
+            if (pop (w, t)) {
+              try {
+                (*task) (t, w);
+              } catch (const std::exception& exc) {
+                fail (exc.what());
+              } catch (...) {
+                fail ("unknown exception");
+              }
+            } else if (!steal (w))
+              break;
+          }
+          boost::mutex::scoped_lock lock (mutex);
+          if (--active == 0) done.notify_all ();
+        }
+      }
+
+      void fail (const char* what)
+      {
+        boost::mutex::scoped_lock lock (mutex);
+        if (!failed) error = what;
+        failed = true;
+      }
+
+      std::vector<RangePtr_t> ranges;
+      boost::thread_group threads;
+      /// Identifiers of the threads, in the order of the ranges.
+      std::vector<boost::thread::id> ids;
+
+      /// Protects generation, active, stop, task and the error.
+      boost::mutex mutex;
+      boost::condition_variable start, done;
+      /// Incremented by each call to WorkStealingPool::run
+      std::size_t generation;
+      /// Number of threads working on the current generation
+      std::size_t active;
+      bool stop;
+      const Task_t* task;
+      bool failed;
+      std::string error;
+
+      /// Serializes the calls to WorkStealingPool::run
+      boost::mutex runMutex;
+    };
+
+    WorkStealingPool::WorkStealingPool (std::size_t nbThreads)
+      : impl_ (new Impl)
+    {
+      if (nbThreads == 0)
+        nbThreads = std::max (1u, boost::thread::hardware_concurrency ());
+      impl_->ranges.resize (nbThreads);
+      for (std::size_t i = 0; i < nbThreads; ++i)
+        impl_->ranges[i].reset (new Impl::Range);
+      impl_->ids.resize (nbThreads);
+      for (std::size_t i = 0; i < nbThreads; ++i)
+        impl_->ids[i] = impl_->threads.create_thread
+          (boost::bind (&Impl::work, impl_, i))->get_id ();
+    }
+
+    WorkStealingPool::~WorkStealingPool ()
+    {
+      {
+        boost::mutex::scoped_lock lock (impl_->mutex);
+        impl_->stop = true;
+        impl_->start.notify_all ();
+      }
+      impl_->threads.join_all ();
+      delete impl_;
+    }
+
+    std::size_t WorkStealingPool::size () const
+    {
+      return impl_->ranges.size();
+    }
+
+    void WorkStealingPool::run (std::size_t nbTasks, const Task_t& task)
+    {
+      // A task running run would wait for itself to complete: the tasks
+      // of a nested call are run by the calling thread.
+      const boost::thread::id self = boost::this_thread::get_id ();
+      for (std::size_t w = 0; w < impl_->ids.size(); ++w) {
+        if (impl_->ids[w] == self) {
+          for (std::size_t t = 0; t < nbTasks; ++t) task (t, w);
+          return;
+        }
+      }
+
+      boost::mutex::scoped_lock runLock (impl_->runMutex);
+      if (nbTasks == 0) return;
+
+      const std::size_t n = size();
+      for (std::size_t w = 0; w < n; ++w) {
+        Impl::Range& r = *impl_->ranges[w];
+        boost::mutex::scoped_lock lock (r.mutex);
+        r.begin = (w    * nbTasks) / n;
+        r.end   = ((w+1) * nbTasks) / n;
+      }
+
+      boost::mutex::scoped_lock lock (impl_->mutex);
+      impl_->task = &task;
+      impl_->active = n;
+      impl_->failed = false;
+      ++impl_->generation;
+      impl_->start.notify_all ();
+      while (impl_->active > 0) impl_->done.wait (lock);
+      impl_->task = NULL;
+      if (impl_->failed)
+        throw std::runtime_error ("A task of WorkStealingPool failed: "
+                                  + impl_->error);
+    }
+
+    WorkStealingPool& WorkStealingPool::global ()
+    {
+      static WorkStealingPool pool;
+      return pool;
+    }
+  } // namespace constraints
+} // namespace hpp
@@ -17,8 +17,13 @@
 #define BOOST_TEST_MODULE EXPLICIT_SOLVER
 #include <boost/test/unit_test.hpp>
 #include <boost/assign/list_of.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <limits>
 
 #include <hpp/constraints/explicit-solver.hh>
+#include <hpp/constraints/evaluation-context.hh>
+#include <hpp/constraints/work-stealing-pool.hh>
 
 #include <pinocchio/algorithm/joint-configuration.hpp>
 
@@ -135,6 +140,61 @@ class TestFunction : public AffineFunction
     }
 };
 
+/// Linear function counting its evaluations
+class CountingFunction : public DifferentiableFunction
+{
+  public:
+    mutable int values, jacobians;
+
+    CountingFunction (const matrix_t& J)
+      : DifferentiableFunction (J.cols(), J.cols(),
+                                LiegroupSpace::Rn (J.rows()), "Counting"),
+        values (0), jacobians (0), J_ (J)
+    {}
+
+  protected:
+    void impl_compute (LiegroupElement& y, vectorIn_t x) const throw ()
+    {
+      ++values;
+      y.vector () = J_ * x;
+    }
+
+    void impl_jacobian (matrixOut_t jacobian, vectorIn_t) const throw ()
+    {
+      ++jacobians;
+      jacobian = J_;
+    }
+
+  private:
+    matrix_t J_;
+};
+typedef boost::shared_ptr<CountingFunction> CountingFunctionPtr_t;
+
+/// Solve each configuration and compute its jacobian in a workspace owned
+/// by the calling thread.
+struct SolveInWorkspace
+{
+  SolveInWorkspace (const ExplicitSolver& s, matrix_t& c,
+                    std::vector<matrix_t>& J)
+    : solver (s), configs (c), jacobians (J)
+  {}
+
+  void operator() () const
+  {
+    ExplicitSolver::Workspace ws;
+    ws.context.reset (new EvaluationContext);
+    solver.allocate (ws);
+    for (size_type i = 0; i < configs.cols (); ++i) {
+      solver.solve (configs.col (i), ws);
+      solver.jacobian (jacobians[i], configs.col (i), ws);
+    }
+  }
+
+  const ExplicitSolver& solver;
+  matrix_t& configs;
+  std::vector<matrix_t>& jacobians;
+};
+
 matrix3_t exponential (const vector3_t& aa)
 {
   matrix3_t R, xCross;
@@ -332,6 +392,297 @@ BOOST_AUTO_TEST_CASE(jacobian1)
   matrix_t jacobian (solver.derSize(), solver.derSize());
   solver.jacobian (jacobian, xres);
   BOOST_CHECK_EQUAL (jacobian, expjac);
+
+  // The compact jacobian is the block of the output wrt the input.
+  matrix_t compact (solver.outDers().nbIndices(), solver.inDers().nbIndices());
+  solver.compactJacobian (compact, xres);
+  BOOST_CHECK_EQUAL (compact, expjac.bottomRows<3> ().leftCols<1> ());
+}
+
+BOOST_AUTO_TEST_CASE(incremental)
+{
+  matrix_t J (1, 1); J (0, 0) = 2;
+  // dof     :  0 -> 1 -> 2    3 -> 4
+  // function:    f0   f1        f2
+  CountingFunctionPtr_t f[] = {
+    CountingFunctionPtr_t (new CountingFunction (J)),
+    CountingFunctionPtr_t (new CountingFunction (J)),
+    CountingFunctionPtr_t (new CountingFunction (J))
+  };
+  segment_t in[] = { segment_t (0, 1), segment_t (1, 1), segment_t (3, 1) };
+  segment_t out[] = { segment_t (1, 1), segment_t (2, 1), segment_t (4, 1) };
+
+  ExplicitSolver solver (5, 5);
+  for (int i = 0; i < 3; ++i)
+    BOOST_CHECK (solver.add(f[i], in[i], out[i], in[i], out[i],
+          ComparisonTypes_t (1, Equality)) >= 0);
+
+  vector_t x (5), expected (5);
+  x << 1, 0, 0, 3, 0;
+  expected << 1, 2, 4, 3, 6;
+
+  BOOST_CHECK (solver.solve (x));
+  BOOST_CHECK_EQUAL (x, expected);
+  for (int i = 0; i < 3; ++i) BOOST_CHECK_EQUAL (f[i]->values, 1);
+
+  // The outputs are restored without evaluating the functions.
+  x[2] = 10;
+  BOOST_CHECK (solver.solve (x));
+  BOOST_CHECK_EQUAL (x, expected);
+  for (int i = 0; i < 3; ++i) BOOST_CHECK_EQUAL (f[i]->values, 1);
+
+  // Only the functions downstream of the modified input are evaluated.
+  x[3] = 1; expected.tail<2>() << 1, 2;
+  BOOST_CHECK (solver.solve (x));
+  BOOST_CHECK_EQUAL (x, expected);
+  BOOST_CHECK_EQUAL (f[0]->values, 1);
+  BOOST_CHECK_EQUAL (f[1]->values, 1);
+  BOOST_CHECK_EQUAL (f[2]->values, 2);
+
+  x[0] = 2; expected.head<3>() << 2, 4, 8;
+  BOOST_CHECK (solver.solve (x));
+  BOOST_CHECK_EQUAL (x, expected);
+  BOOST_CHECK_EQUAL (f[0]->values, 2);
+  BOOST_CHECK_EQUAL (f[1]->values, 2);
+  BOOST_CHECK_EQUAL (f[2]->values, 2);
+
+  // Modifying the right hand side invalidates the outputs.
+  vector_t rhs (vector_t::Ones (1));
+  solver.rightHandSide (f[2], rhs);
+  expected[4] = 3;
+  BOOST_CHECK (solver.solve (x));
+  BOOST_CHECK_EQUAL (x, expected);
+  for (int i = 0; i < 3; ++i) BOOST_CHECK_EQUAL (f[i]->values, 3);
+
+  matrix_t jacobian (5, 5), expjac (matrix_t::Zero (5, 5));
+  expjac.col (0) << 1, 2, 4, 0, 0;
+  expjac.col (3) << 0, 0, 0, 1, 2;
+  for (int k = 0; k < 2; ++k) {
+    solver.jacobian (jacobian, x);
+    BOOST_CHECK_EQUAL (jacobian, expjac);
+    for (int i = 0; i < 3; ++i) BOOST_CHECK_EQUAL (f[i]->jacobians, 1);
+  }
+
+  solver.invalidate ();
+  BOOST_CHECK (solver.solve (x));
+  solver.jacobian (jacobian, x);
+  BOOST_CHECK_EQUAL (jacobian, expjac);
+  for (int i = 0; i < 3; ++i) {
+    BOOST_CHECK_EQUAL (f[i]->values, 4);
+    BOOST_CHECK_EQUAL (f[i]->jacobians, 2);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(parallel)
+{
+  // 8 independent chains: (4k, 4k+1) -> 4k+2 -> 4k+3, where dof 4k is
+  // locked for even k. The functions implement the evaluation in a context,
+  // except the last chain which uses the legacy evaluation.
+  const std::size_t nChains = 8;
+  const size_type n = 4 * nChains;
+  ExplicitSolver serial (n, n), parallel (n, n);
+  for (std::size_t k = 0; k < nChains; ++k) {
+    const size_type i = 4 * k;
+    if (k % 2 == 0) {
+      DifferentiableFunctionPtr_t c (new ConstantFunction
+                                     (vector_t::Constant (1, value_type (k)),
+                                      0, 0));
+      BOOST_CHECK (serial  .add (c, segments_t (), segment_t (i, 1),
+                                 segments_t (), segment_t (i, 1)) >= 0);
+      BOOST_CHECK (parallel.add (c, segments_t (), segment_t (i, 1),
+                                 segments_t (), segment_t (i, 1)) >= 0);
+    }
+    matrix_t J1 (matrix_t::Random (1, 2)), J2 (matrix_t::Random (1, 1));
+    DifferentiableFunctionPtr_t f1, f2;
+    if (k + 1 < nChains) {
+      f1.reset (new AffineFunction (J1));
+      f2.reset (new AffineFunction (J2));
+    } else {
+      f1.reset (new CountingFunction (J1));
+      f2.reset (new CountingFunction (J2));
+    }
+    segment_t in1 (i, 2), out1 (i + 2, 1), out2 (i + 3, 1);
+    BOOST_CHECK (serial  .add (f1, in1 , out1, in1 , out1) >= 0);
+    BOOST_CHECK (parallel.add (f1, in1 , out1, in1 , out1) >= 0);
+    BOOST_CHECK (serial  .add (f2, out1, out2, out1, out2) >= 0);
+    BOOST_CHECK (parallel.add (f2, out1, out2, out1, out2) >= 0);
+  }
+  // The constant functions belong to no wavefront.
+  BOOST_REQUIRE_EQUAL (parallel.wavefronts ().size (), 2);
+  BOOST_CHECK_EQUAL (parallel.wavefronts ()[0].size (), nChains);
+  BOOST_CHECK_EQUAL (parallel.wavefronts ()[1].size (), nChains);
+
+  WorkStealingPool pool (4);
+  parallel.parallel (&pool, 1);
+  BOOST_CHECK_EQUAL (parallel.pool (), &pool);
+
+  matrix_t Js (n, n), Jp (n, n);
+  for (int k = 0; k < 3; ++k) {
+    vector_t xs (vector_t::Random (n)), xp (xs);
+    BOOST_CHECK (serial  .solve (xs));
+    BOOST_CHECK (parallel.solve (xp));
+    BOOST_CHECK_EQUAL (xs, xp);
+    for (std::size_t c = 0; c < nChains; c += 2)
+      BOOST_CHECK_EQUAL (xp[4 * c], value_type (c));
+    serial  .jacobian (Js, xs);
+    parallel.jacobian (Jp, xp);
+    BOOST_CHECK_EQUAL (Js, Jp);
+  }
+
+  // Two threads use the solver at the same time, each with its own
+  // workspace.
+  const size_type nConfigs = 20;
+  matrix_t configs (matrix_t::Random (n, nConfigs)), c0 (configs),
+           c1 (configs);
+  std::vector<matrix_t> J0 (nConfigs, matrix_t (n, n)), J1 (J0);
+  boost::thread t0 (SolveInWorkspace (parallel, c0, J0)),
+                t1 (SolveInWorkspace (parallel, c1, J1));
+  t0.join ();
+  t1.join ();
+  for (size_type i = 0; i < nConfigs; ++i) {
+    vector_t xs (configs.col (i));
+    BOOST_CHECK (serial.solve (xs));
+    serial.jacobian (Js, xs);
+    BOOST_CHECK_EQUAL (c0.col (i), xs);
+    BOOST_CHECK_EQUAL (c1.col (i), xs);
+    BOOST_CHECK_EQUAL (J0[i], Js);
+    BOOST_CHECK_EQUAL (J1[i], Js);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(parallel_constant)
+{
+  // 6 chains: c -> 4k, (4k, 4k+1) -> 4k+2 -> 4k+3, where 4k is locked
+  // for even k only.
+  const std::size_t nChains = 6;
+  const size_type n = 4 * nChains;
+  ExplicitSolver serial (n, n), parallel (n, n);
+  for (std::size_t k = 0; k < nChains; ++k) {
+    const size_type i = 4 * k;
+    if (k % 2 == 0) {
+      DifferentiableFunctionPtr_t c (new ConstantFunction
+                                     (vector_t::Constant (1, value_type (k)),
+                                      0, 0));
+      BOOST_CHECK (serial  .add (c, segments_t (), segment_t (i, 1),
+                                 segments_t (), segment_t (i, 1)) >= 0);
+      BOOST_CHECK (parallel.add (c, segments_t (), segment_t (i, 1),
+                                 segments_t (), segment_t (i, 1)) >= 0);
+    }
+    AffineFunctionPtr_t f (new AffineFunction (matrix_t::Random (1, 2))),
+      g (new AffineFunction (matrix_t::Random (1, 1)));
+    BOOST_CHECK (serial  .add (f, segment_t (i, 2), segment_t (i + 2, 1),
+                               segment_t (i, 2), segment_t (i + 2, 1)) >= 0);
+    BOOST_CHECK (parallel.add (f, segment_t (i, 2), segment_t (i + 2, 1),
+                               segment_t (i, 2), segment_t (i + 2, 1)) >= 0);
+    BOOST_CHECK (serial  .add (g, segment_t (i + 2, 1), segment_t (i + 3, 1),
+                               segment_t (i + 2, 1), segment_t (i + 3, 1))
+                 >= 0);
+    BOOST_CHECK (parallel.add (g, segment_t (i + 2, 1), segment_t (i + 3, 1),
+                               segment_t (i + 2, 1), segment_t (i + 3, 1))
+                 >= 0);
+  }
+  BOOST_REQUIRE_EQUAL (parallel.wavefronts ().size (), 2);
+
+  WorkStealingPool pool (4);
+  parallel.parallel (&pool, 1);
+
+  const size_type rows = serial.outDers ().nbIndices (),
+        cols = serial.inDers ().nbIndices ();
+  for (int k = 0; k < 3; ++k) {
+    vector_t xs (vector_t::Random (n)), xp (xs);
+    BOOST_CHECK (serial  .solve (xs));
+    BOOST_CHECK (parallel.solve (xp));
+    BOOST_CHECK_EQUAL (xs, xp);
+    // Every coefficient of the compact jacobian must be written.
+    matrix_t Js (matrix_t::Constant
+                 (rows, cols, std::numeric_limits<value_type>::quiet_NaN ())),
+             Jp (Js);
+    serial  .compactJacobian (Js, xs);
+    parallel.compactJacobian (Jp, xp);
+    BOOST_CHECK (!Js.hasNaN ());
+    BOOST_CHECK_EQUAL (Js, Jp);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(bulk_add)
+{
+  // dof     :  0 -> 1 -> ... -> n-1, functions added in reverse order.
+  const size_type n = 1000;
+  Eigen::Matrix<value_type,1,1> M; M(0,0) = 1;
+  std::vector<ExplicitSolver::Explicit> functions (n - 1);
+  ExplicitSolver solver (n, n), bulk (n, n);
+  for (size_type i = n - 2; i >= 0; --i) {
+    ExplicitSolver::Explicit& e = functions[n - 2 - i];
+    e.f = AffineFunctionPtr_t (new AffineFunction (M));
+    e.inArg .addRow (i    , 1); e.inDer .addCol (i    , 1);
+    e.outArg.addRow (i + 1, 1); e.outDer.addRow (i + 1, 1);
+    BOOST_CHECK_EQUAL (solver.add (e.f, e.inArg, e.outArg, e.inDer,
+                                   e.outDer), n - 2 - i);
+  }
+  // The output of the last function is already computed.
+  functions.push_back (functions.back ());
+
+  std::vector<size_type> indices = bulk.add (functions);
+  BOOST_REQUIRE_EQUAL (indices.size (), (std::size_t)n);
+  for (size_type i = 0; i < n - 1; ++i) BOOST_CHECK_EQUAL (indices[i], i);
+  BOOST_CHECK_EQUAL (indices[n - 1], -1);
+
+  BOOST_CHECK_EQUAL (bulk.wavefronts ().size (), (std::size_t)n - 1);
+  BOOST_CHECK_EQUAL (bulk.freeArgs ().rows (), solver.freeArgs ().rows ());
+  BOOST_CHECK_EQUAL (bulk.inDers ().cols (), solver.inDers ().cols ());
+  BOOST_CHECK_EQUAL (bulk.outDers ().rows (), solver.outDers ().rows ());
+  BOOST_CHECK_EQUAL (bulk.inOutDofDependencies (),
+                     solver.inOutDofDependencies ());
+
+  vector_t x (vector_t::Random (n)), y (x);
+  BOOST_CHECK (solver.solve (x));
+  BOOST_CHECK (bulk  .solve (y));
+  BOOST_CHECK_EQUAL (x, vector_t::Constant (n, x[0]));
+  BOOST_CHECK_EQUAL (x, y);
+}
+
+BOOST_AUTO_TEST_CASE(constant)
+{
+  // dof     :  0 -> 1   c -> 2   c -> 3 4   5
+  // function:    f0     f1       f2
+  Eigen::Matrix<value_type,1,1> M; M(0,0) = 2;
+  DifferentiableFunctionPtr_t f[] = {
+    AffineFunctionPtr_t (new AffineFunction (M)),
+    DifferentiableFunctionPtr_t (new ConstantFunction
+                                 (vector_t::Constant (1, 1), 0, 0)),
+    DifferentiableFunctionPtr_t (new ConstantFunction
+                                 ((vector_t(2) << 2, 3).finished(), 0, 0))
+  };
+  segment_t s[] = { segment_t (0, 1), segment_t (1, 1), segment_t (2, 1),
+                    segment_t (3, 2) };
+
+  ExplicitSolver solver (6, 6);
+  BOOST_CHECK_EQUAL (solver.add (f[1], segments_t (), s[2], segments_t (),
+                                 s[2]), 0);
+  BOOST_CHECK_EQUAL (solver.add (f[2], segments_t (), s[3], segments_t (),
+                                 s[3], ComparisonTypes_t (2, Equality)), 1);
+  BOOST_CHECK (solver.isConstant ());
+  BOOST_CHECK (solver.wavefronts ().empty ());
+  BOOST_CHECK_EQUAL (solver.add (f[0], s[0], s[1], s[0], s[1]), 2);
+  BOOST_CHECK (!solver.isConstant ());
+  BOOST_CHECK_EQUAL (solver.wavefronts ().size (), (std::size_t)1);
+
+  vector_t x (vector_t::Zero (6)); x[0] = 1; x[5] = 5;
+  BOOST_CHECK (solver.solve (x));
+  BOOST_CHECK_EQUAL (x, (vector_t(6) << 1, 2, 1, 2, 3, 5).finished());
+
+  // The rows of the constant outputs of the jacobian are zero.
+  matrix_t expjac (matrix_t::Zero (4, 2));
+  expjac (0, 0) = 2;
+  matrix_t jacobian (6, 6);
+  solver.jacobian (jacobian, x);
+  BOOST_CHECK_EQUAL (solver.viewJacobian (jacobian).eval (), expjac);
+
+  // The right hand side is added to the constant outputs.
+  solver.rightHandSide (1, (vector_t(2) << 1, -1).finished());
+  BOOST_CHECK (solver.solve (x));
+  BOOST_CHECK_EQUAL (x, (vector_t(6) << 1, 2, 1, 3, 2, 5).finished());
+  BOOST_CHECK (solver.isSatisfied (x));
 }
 
 BOOST_AUTO_TEST_CASE(jacobian2)
@@ -25,6 +25,8 @@
 #include <hpp/pinocchio/configuration.hh>
 #include <hpp/pinocchio/simple-device.hh>
 
+#include "hpp/constraints/differentiable-function-stack.hh"
+#include "hpp/constraints/evaluation-context.hh"
 #include "hpp/constraints/tools.hh"
 
 #define BOOST_TEST_MODULE hpp_constraints
@@ -131,3 +133,196 @@ BOOST_AUTO_TEST_CASE (print) {
   not_ap2 = (ap2 == false);
   BOOST_CHECK ((ap12 == ((not_ap1 && ap2) || (ap1 && not_ap2))).all());
 }
+
+BOOST_AUTO_TEST_CASE (evaluation_context) {
+  DevicePtr_t device = hpp::pinocchio::humanoidSimple ("test");
+  JointPtr_t ee1 = device->getJointByName ("lleg5_joint"),
+             ee2 = device->getJointByName ("rleg5_joint");
+  BOOST_REQUIRE (device);
+  BasicConfigurationShooter cs (device);
+
+  device->currentConfiguration (*cs.shoot ());
+  device->computeForwardKinematics ();
+  Transform3f tf1 (ee1->currentTransformation ());
+  Transform3f tf2 (ee2->currentTransformation ());
+
+  std::vector<DifferentiableFunctionPtr_t> functions;
+  functions.push_back(Orientation::create            ("Orientation"           , device, ee2, tf2)          );
+  functions.push_back(Position::create               ("Position"              , device, ee2, tf2, tf1)     );
+  functions.push_back(Transformation::create         ("Transformation"        , device, ee1, tf1)          );
+  functions.push_back(RelativeOrientation::create    ("RelativeOrientation"   , device, ee1, ee2, tf1)     );
+  functions.push_back(RelativePosition::create       ("RelativePosition"      , device, ee1, ee2, tf1, tf2));
+  functions.push_back(RelativeTransformation::create ("RelativeTransformation", device, ee1, ee2, tf1, tf2));
+
+  EvaluationContext ctx1, ctx2;
+  Configuration_t q0 = device->currentConfiguration (),
+                  q1 = *cs.shoot(),
+                  q2 = *cs.shoot();
+  for (int i = 0; i < functions.size(); ++i) {
+    DifferentiableFunctionPtr_t f = functions[i];
+
+    LiegroupElement v (f->outputSpace()), v1 (f->outputSpace()),
+                    v2 (f->outputSpace());
+    matrix_t J  (f->outputDerivativeSize(), f->inputDerivativeSize()),
+             J1 (f->outputDerivativeSize(), f->inputDerivativeSize()),
+             J2 (f->outputDerivativeSize(), f->inputDerivativeSize());
+
+    // Interleave the evaluations in both contexts.
+    f->value    (v1, q1, ctx1);
+    f->value    (v2, q2, ctx2);
+    f->jacobian (J1, q1, ctx1);
+    f->jacobian (J2, q2, ctx2);
+    // The robot is left unchanged.
+    BOOST_CHECK (device->currentConfiguration () == q0);
+
+    f->value    (v, q1);
+    f->jacobian (J, q1);
+    BOOST_CHECK (v.vector ().isApprox (v1.vector ()));
+    BOOST_CHECK (J.isApprox (J1));
+    f->value    (v, q2);
+    f->jacobian (J, q2);
+    BOOST_CHECK (v.vector ().isApprox (v2.vector ()));
+    BOOST_CHECK (J.isApprox (J2));
+    device->currentConfiguration (q0);
+  }
+}
+
+BOOST_AUTO_TEST_CASE (locked_configuration) {
+  DevicePtr_t device = hpp::pinocchio::humanoidSimple ("test");
+  BOOST_REQUIRE (device);
+  JointPtr_t ee1 = device->getJointByName ("lleg5_joint"),
+             ee2 = device->getJointByName ("rleg5_joint");
+  BasicConfigurationShooter cs (device);
+
+  device->currentConfiguration (*cs.shoot ());
+  device->computeForwardKinematics ();
+  Transform3f tf1 (ee1->currentTransformation ());
+  Transform3f tf2 (ee2->currentTransformation ());
+
+  std::vector<DifferentiableFunctionPtr_t> functions;
+  functions.push_back(Orientation::create            ("Orientation"           , device, ee2, tf2)          );
+  functions.push_back(Position::create               ("Position"              , device, ee2, tf2, tf1)     );
+  functions.push_back(RelativeTransformation::create ("RelativeTransformation", device, ee1, ee2, tf1, tf2));
+
+  EvaluationContext ctx1, ctx2;
+  for (int k = 0; k < 3; ++k) {
+    Configuration_t q = *cs.shoot();
+    const std::size_t count = ctx1.forwardKinematicsCount ();
+    // The kinematics and the joint Jacobians are computed once for all the
+    // functions.
+    ctx1.lockConfiguration (true);
+    for (std::size_t i = 0; i < functions.size(); ++i) {
+      DifferentiableFunctionPtr_t f = functions[i];
+      LiegroupElement v1 (f->outputSpace()), v2 (f->outputSpace());
+      matrix_t J1 (f->outputDerivativeSize(), f->inputDerivativeSize()),
+               J2 (f->outputDerivativeSize(), f->inputDerivativeSize());
+      f->value    (v1, q, ctx1);
+      f->jacobian (J1, q, ctx1);
+      f->value    (v2, q, ctx2);
+      f->jacobian (J2, q, ctx2);
+      BOOST_CHECK (v1.vector ().isApprox (v2.vector ()));
+      BOOST_CHECK (J1.isApprox (J2));
+    }
+    ctx1.unlockConfiguration ();
+    BOOST_CHECK_EQUAL (ctx1.forwardKinematicsCount (), count + 1);
+  }
+}
+
+BOOST_AUTO_TEST_CASE (ancestor_chain) {
+  DevicePtr_t device = hpp::pinocchio::humanoidSimple ("test");
+  BOOST_REQUIRE (device);
+  JointPtr_t ee1 = device->getJointByName ("lleg5_joint"),
+             ee2 = device->getJointByName ("rleg5_joint"),
+             root = device->rootJoint ();
+  BasicConfigurationShooter cs (device);
+
+  device->currentConfiguration (*cs.shoot ());
+  device->computeForwardKinematics ();
+  Transform3f tf1 (ee1->currentTransformation ());
+  Transform3f tf2 (ee2->currentTransformation ());
+
+  std::vector<DifferentiableFunctionPtr_t> functions;
+  functions.push_back(Transformation::create         ("Transformation"        , device, ee1, tf1)          );
+  functions.push_back(RelativeTransformation::create ("RelativeTransformation", device, ee1, ee2, tf1, tf2));
+
+  // The root joint is a common ancestor of both feet.
+  BOOST_CHECK ( functions[0]->activeDerivativeParameters ()
+      .segment (root->rankInVelocity (), root->numberDof ()).all ());
+  BOOST_CHECK (!functions[1]->activeDerivativeParameters ()
+      .segment (root->rankInVelocity (), root->numberDof ()).any ());
+
+  EvaluationContext ctx;
+  for (int k = 0; k < 3; ++k) {
+    Configuration_t q = *cs.shoot();
+    for (std::size_t i = 0; i < functions.size(); ++i) {
+      DifferentiableFunctionPtr_t f = functions[i];
+      const Eigen::ColBlockIndices cols (BlockIndex::fromLogicalExpression
+          (f->activeDerivativeParameters ()));
+      BOOST_CHECK_EQUAL (cols.nbIndices (), f->activeDerivativeSize ());
+
+      matrix_t J  (f->outputDerivativeSize(), f->inputDerivativeSize()),
+               J1 (f->outputDerivativeSize(), f->inputDerivativeSize()),
+               Jc (f->outputDerivativeSize(), f->activeDerivativeSize());
+      f->jacobian (J, q);
+      f->jacobian (J1, q, ctx);
+      f->jacobianCompressed (Jc, q);
+      BOOST_CHECK (J.isApprox (J1));
+      BOOST_CHECK (matrix_t (cols.rview (J)).isApprox (Jc));
+      // The columns of the other degrees of freedom are exactly zero.
+      matrix_t Jinactive (J);
+      cols.lview (Jinactive) = matrix_t::Zero (Jc.rows (), Jc.cols ());
+      BOOST_CHECK (Jinactive.isZero (0));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE (value_and_jacobian) {
+  DevicePtr_t device = hpp::pinocchio::humanoidSimple ("test");
+  BOOST_REQUIRE (device);
+  JointPtr_t ee1 = device->getJointByName ("lleg5_joint"),
+             ee2 = device->getJointByName ("rleg5_joint");
+  BasicConfigurationShooter cs (device);
+
+  device->currentConfiguration (*cs.shoot ());
+  device->computeForwardKinematics ();
+  Transform3f tf1 (ee1->currentTransformation ());
+  Transform3f tf2 (ee2->currentTransformation ());
+
+  DifferentiableFunctionStackPtr_t stack =
+    DifferentiableFunctionStack::create ("stack");
+  stack->add (Orientation::create            ("Orientation"           , device, ee2, tf2)          );
+  stack->add (Position::create               ("Position"              , device, ee2, tf2, tf1)     );
+  stack->add (RelativeTransformation::create ("RelativeTransformation", device, ee1, ee2, tf1, tf2));
+
+  std::vector<DifferentiableFunctionPtr_t> functions (stack->functions ());
+  functions.push_back (stack);
+
+  EvaluationContext ctx;
+  for (int k = 0; k < 3; ++k) {
+    Configuration_t q = *cs.shoot();
+    for (std::size_t i = 0; i < functions.size(); ++i) {
+      DifferentiableFunctionPtr_t f = functions[i];
+      LiegroupElement v (f->outputSpace()), v1 (f->outputSpace());
+      matrix_t J  (f->outputDerivativeSize(), f->inputDerivativeSize()),
+               J1 (f->outputDerivativeSize(), f->inputDerivativeSize()),
+               Jc (f->outputDerivativeSize(), f->activeDerivativeSize()),
+               Jc1 (f->outputDerivativeSize(), f->activeDerivativeSize());
+      f->value (v, q);
+      f->jacobian (J, q);
+      f->jacobianCompressed (Jc, q);
+
+      f->valueAndJacobian (v1, J1, q);
+      BOOST_CHECK (v.vector ().isApprox (v1.vector ()));
+      BOOST_CHECK (J.isApprox (J1));
+      f->valueAndJacobian (v1, J1, q, ctx);
+      BOOST_CHECK (v.vector ().isApprox (v1.vector ()));
+      BOOST_CHECK (J.isApprox (J1));
+      f->valueAndJacobianCompressed (v1, Jc1, q);
+      BOOST_CHECK (v.vector ().isApprox (v1.vector ()));
+      BOOST_CHECK (Jc.isApprox (Jc1));
+      f->valueAndJacobianCompressed (v1, Jc1, q, ctx);
+      BOOST_CHECK (v.vector ().isApprox (v1.vector ()));
+      BOOST_CHECK (Jc.isApprox (Jc1));
+    }
+  }
+}
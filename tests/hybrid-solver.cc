@@ -17,10 +17,12 @@
 #define BOOST_TEST_MODULE HYBRID_SOLVER
 #include <boost/test/unit_test.hpp>
 #include <boost/assign/list_of.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 
 #include <hpp/constraints/hybrid-solver.hh>
 
 #include <pinocchio/algorithm/joint-configuration.hpp>
+#include <pinocchio/multibody/joint/joint-free-flyer.hpp>
 
 #include <hpp/pinocchio/device.hh>
 #include <hpp/pinocchio/joint.hh>
@@ -29,6 +31,8 @@
 
 #include <hpp/constraints/affine-function.hh>
 #include <hpp/constraints/generic-transformation.hh>
+#include <hpp/constraints/explicit-relative-transformation.hh>
+#include <hpp/constraints/evaluation-context.hh>
 #include <hpp/pinocchio/liegroup-element.hh>
 
 #include <../tests/util.hh>
@@ -435,6 +439,46 @@ class ExplicitTransformation : public DifferentiableFunction
 typedef boost::shared_ptr<LockedJoint> LockedJointPtr_t;
 typedef boost::shared_ptr<ExplicitTransformation> ExplicitTransformationPtr_t;
 
+BOOST_AUTO_TEST_CASE(constant_explicit)
+{
+  // x[4] and x[5] are locked, J x + b = 0
+  const int N = 6;
+  AffineFunctionPtr_t affine (new AffineFunction
+                               (matrix_t::Random (2, N),
+                                0.1 * vector_t::Random (2)));
+  vector_t c (vector_t::Random (2));
+  ConstantFunctionPtr_t locked (new ConstantFunction (c, 0, 0));
+
+  HybridSolver solver (N, N);
+  solver.maxIterations(20);
+  solver.errorThreshold(test_precision);
+  solver.integration(simpleIntegration<-1,1>);
+  solver.saturation(simpleSaturation<-1,1>);
+  solver.add (affine, 0);
+  solver.explicitSolver().add (locked, segments_t (), segment_t (4, 2),
+                               segments_t (), segment_t (4, 2));
+  solver.explicitSolverHasChanged();
+  BOOST_CHECK (solver.explicitSolver().isConstant ());
+
+  vector_t x (vector_t::Random (N));
+  SOLVER_CHECK_SOLVE (solver.solve<lineSearch::Backtracking>(x), SUCCESS);
+  BOOST_CHECK_EQUAL (x.tail<2> (), c);
+  BOOST_CHECK (solver.isSatisfied (x));
+
+  // integrate always solves the explicit system.
+  vector_t dx (vector_t::Random (N)), y (N), z (N);
+  solver.integrate (x, dx, y);
+  simpleIntegration<-1,1> (x, dx, z);
+  BOOST_CHECK_EQUAL (y.head<4> (), z.head<4> ());
+  BOOST_CHECK_EQUAL (y.tail<2> (), c);
+
+  // oneStep applies the constant explicit system.
+  x.setRandom ();
+  lineSearch::Constant ls;
+  solver.oneStep (x, ls);
+  BOOST_CHECK_EQUAL (x.tail<2> (), c);
+}
+
 BOOST_AUTO_TEST_CASE(functions1)
 {
   HybridSolver solver(3, 3);
@@ -519,6 +563,231 @@ BOOST_AUTO_TEST_CASE(functions2)
   BOOST_CHECK_EQUAL(solver.implicitDof(), impDof);
 }
 
+BOOST_AUTO_TEST_CASE(workspace)
+{
+  const int N = 6;
+  matrix_t A (randomPositiveDefiniteMatrix(N));
+  Quadratic::Ptr_t quad (new Quadratic (A, -1));
+  matrix_t B (matrix_t::Random (2, 2));
+  AffineFunctionPtr_t expl (new AffineFunction (B));
+
+  HybridSolver solver (N, N);
+  solver.maxIterations(20);
+  solver.errorThreshold(test_precision);
+  solver.integration(simpleIntegration<-1,1>);
+  solver.saturation(simpleSaturation<-1,1>);
+
+  solver.add (quad, 0);
+  solver.explicitSolver().add (expl, segment_t (4, 2), segment_t (2, 2),
+                                     segment_t (4, 2), segment_t (2, 2));
+  solver.explicitSolverHasChanged();
+
+  // Two independent problems, solved step by step in an interleaved manner
+  // with the same solver, must give the same result as when solved
+  // separately.
+  vector_t x1 (vector_t::Random(N)), x2 (vector_t::Random(N));
+  vector_t y1 (x1), y2 (x2);
+
+  SolverWorkspace ws1 (solver), ws2 (solver);
+  lineSearch::Constant ls;
+  for (int i = 0; i < 5; ++i) {
+    solver.oneStep (x1, ls, ws1);
+    solver.oneStep (x2, ls, ws2);
+  }
+  for (int i = 0; i < 5; ++i) solver.oneStep (y1, ls);
+  for (int i = 0; i < 5; ++i) solver.oneStep (y2, ls);
+  EIGEN_VECTOR_IS_APPROX (x1, y1);
+  EIGEN_VECTOR_IS_APPROX (x2, y2);
+
+  // Full resolution
+  x1.setRandom(); y1 = x1;
+  x2.setRandom(); y2 = x2;
+  HybridSolver::Status s1 = solver.solve (x1, ws1, lineSearch::Backtracking()),
+                       s2 = solver.solve (x2, ws2, lineSearch::Backtracking());
+  BOOST_CHECK_EQUAL (solver.solve<lineSearch::Backtracking> (y1), s1);
+  BOOST_CHECK_EQUAL (solver.solve<lineSearch::Backtracking> (y2), s2);
+  EIGEN_VECTOR_IS_APPROX (x1, y1);
+  EIGEN_VECTOR_IS_APPROX (x2, y2);
+  BOOST_CHECK_EQUAL (solver.isSatisfied (x1, ws1), solver.isSatisfied (y1));
+  BOOST_CHECK_EQUAL (solver.isSatisfied (x2, ws2), solver.isSatisfied (y2));
+}
+
+BOOST_AUTO_TEST_CASE(decompositions)
+{
+  // Problem of the size of a humanoid robot, with two levels of priority
+  // and an explicit constraint.
+  const int N = 36;
+  matrix_t J0 (matrix_t::Random (12, N));
+  AffineFunctionPtr_t affine (new AffineFunction (J0, 0.1 * vector_t::Random (12)));
+  matrix_t A (randomPositiveDefiniteMatrix(N));
+  Quadratic::Ptr_t quad (new Quadratic (A, -1));
+  matrix_t B (matrix_t::Random (6, 6));
+  AffineFunctionPtr_t expl (new AffineFunction (B));
+
+  const Decomposition::Type types[] = {
+    Decomposition::JACOBI_SVD,
+    Decomposition::BDC_SVD,
+    Decomposition::COMPLETE_ORTHOGONAL_DECOMPOSITION,
+    Decomposition::COL_PIV_HOUSEHOLDER_QR,
+    Decomposition::DAMPED_LLT
+  };
+  const char* names[] = { "JacobiSVD", "BDCSVD",
+    "CompleteOrthogonalDecomposition", "ColPivHouseholderQR", "damped LLT" };
+
+  const size_type M = 200;
+  const matrix_t configs (0.5 * matrix_t::Random (N, M));
+  vector_t dq (vector_t::Random (N)), x (N), refProj (N), proj (N);
+  std::size_t refSuccess = 0;
+
+  for (std::size_t i = 0; i < 5; ++i) {
+    HybridSolver solver (N, N);
+    solver.maxIterations(40);
+    solver.errorThreshold(test_precision);
+    solver.integration(simpleIntegration<-1,1>);
+    solver.saturation(simpleSaturation<-1,1>);
+    solver.decomposition (types[i]);
+
+    solver.add (affine, 0);
+    solver.add (quad, 1);
+    solver.explicitSolver().add (expl, segment_t (N - 6, 6), segment_t (N - 12, 6),
+                                       segment_t (N - 6, 6), segment_t (N - 12, 6));
+    solver.explicitSolverHasChanged();
+
+    std::size_t success = 0;
+    boost::posix_time::ptime start =
+      boost::posix_time::microsec_clock::universal_time();
+    for (size_type j = 0; j < M; ++j) {
+      x = configs.col(j);
+      if (solver.solve<lineSearch::Backtracking> (x) == HybridSolver::SUCCESS)
+        ++success;
+    }
+    boost::posix_time::time_duration d =
+      boost::posix_time::microsec_clock::universal_time() - start;
+    std::cout << names[i] << ": " << success << " / " << M << " succeeded, "
+      << (value_type) d.total_microseconds() / (value_type) M
+      << " us per projection" << std::endl;
+
+    x = configs.col(0);
+    proj.setZero ();
+    solver.projectOnKernel (x, dq, proj);
+    if (i == 0) {
+      refSuccess = success;
+      refProj = proj;
+    } else {
+      BOOST_CHECK_GE (success, refSuccess * 9 / 10);
+      EIGEN_VECTOR_IS_APPROX (proj, refProj);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(project_on_kernel)
+{
+  const int N = 12;
+  matrix_t J0 (matrix_t::Random (4, N));
+  AffineFunctionPtr_t affine (new AffineFunction (J0, 0.1 * vector_t::Random (4)));
+  Quadratic::Ptr_t quad (new Quadratic (randomPositiveDefiniteMatrix(N), -1));
+  AffineFunctionPtr_t expl (new AffineFunction (matrix_t::Random (2, 2)));
+
+  HybridSolver solver (N, N);
+  solver.add (affine, 0);
+  solver.add (quad, 1);
+  solver.explicitSolver().add (expl, segment_t (N - 2, 2), segment_t (N - 4, 2),
+                                     segment_t (N - 2, 2), segment_t (N - 4, 2));
+  solver.explicitSolverHasChanged();
+
+  const size_type M = 5;
+  const matrix_t dqs (matrix_t::Random (N, M));
+  matrix_t projs (N, M), projs2 (N, M);
+  vector_t proj (N);
+  SolverWorkspace ws (solver);
+
+  // The projector computed at the first configuration must not be used at
+  // the second one.
+  for (int i = 0; i < 2; ++i) {
+    const vector_t x (vector_t::Random (N));
+    projs.setZero ();
+    solver.projectOnKernelBatch (x, dqs, projs, ws);
+    for (size_type k = 0; k < M; ++k) {
+      SolverWorkspace fresh (solver);
+      proj.setZero ();
+      solver.projectOnKernel (x, dqs.col (k), proj, fresh);
+      EIGEN_VECTOR_IS_APPROX (proj, projs.col (k));
+      proj.setZero ();
+      solver.projectOnKernel (x, dqs.col (k), proj, ws);
+      EIGEN_VECTOR_IS_APPROX (proj, projs.col (k));
+    }
+    // The projection of a vector of the kernel is itself.
+    projs2.setZero ();
+    solver.projectOnKernelBatch (x, projs, projs2, ws);
+    EIGEN_IS_APPROX (projs2, projs);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(telemetry)
+{
+  const int N = 12;
+  matrix_t J0 (matrix_t::Random (4, N));
+  AffineFunctionPtr_t affine (new AffineFunction (J0, 0.1 * vector_t::Random (4)));
+  Quadratic::Ptr_t quad (new Quadratic (randomPositiveDefiniteMatrix(N), -1));
+  AffineFunctionPtr_t expl (new AffineFunction (matrix_t::Random (2, 2)));
+
+  HybridSolver solver (N, N);
+  solver.maxIterations(40);
+  solver.errorThreshold(test_precision);
+  solver.integration(simpleIntegration<-1,1>);
+  solver.saturation(simpleSaturation<-1,1>);
+  solver.add (affine, 0);
+  solver.add (quad, 1);
+  solver.explicitSolver().add (expl, segment_t (N - 2, 2), segment_t (N - 4, 2),
+                                     segment_t (N - 2, 2), segment_t (N - 4, 2));
+  solver.explicitSolverHasChanged();
+
+  SolverTelemetryPtr_t telemetry (new SolverTelemetry);
+  solver.telemetry (telemetry);
+
+  // The resolutions of the threads are aggregated.
+  const size_type M = 100;
+  matrix_t configs (0.5 * matrix_t::Random (N, M));
+  std::vector<HybridSolver::Status> status;
+  WorkStealingPool pool (4);
+  solver.solveBatch (configs, status, lineSearch::Backtracking (), pool);
+
+  std::size_t counts[SolverTelemetry::NB_STATUS] = { 0, 0, 0, 0 };
+  for (std::size_t i = 0; i < status.size(); ++i) ++counts[status[i]];
+  BOOST_CHECK_EQUAL (telemetry->resolutions (), M);
+  for (std::size_t i = 0; i < SolverTelemetry::NB_STATUS; ++i)
+    BOOST_CHECK_EQUAL (telemetry->resolutions (i), counts[i]);
+
+  std::vector<std::size_t> histogram (telemetry->iterationHistogram ());
+  std::size_t resolutions = 0, iterations = 0;
+  for (std::size_t i = 0; i < histogram.size(); ++i) {
+    resolutions += histogram[i];
+    iterations += i * histogram[i];
+  }
+  BOOST_CHECK_EQUAL (resolutions, M);
+  BOOST_CHECK_EQUAL (telemetry->iterations (), iterations);
+
+  // One descent direction and one line search per iteration.
+  BOOST_CHECK_EQUAL (telemetry->calls (SolverTelemetry::DESCENT_DIRECTION), iterations);
+  BOOST_CHECK_EQUAL (telemetry->calls (SolverTelemetry::LINE_SEARCH), iterations);
+  // The explicit system is solved once before the iterations, and then
+  // within the line search.
+  BOOST_CHECK_EQUAL (telemetry->calls (SolverTelemetry::EXPLICIT_SOLVE), M);
+  BOOST_CHECK_GT (telemetry->time (SolverTelemetry::VALUE), 0);
+  BOOST_CHECK_GT (telemetry->time (SolverTelemetry::JACOBIAN), 0);
+  BOOST_TEST_MESSAGE (*telemetry);
+
+  telemetry->reset ();
+  BOOST_CHECK_EQUAL (telemetry->resolutions (), 0);
+  BOOST_CHECK_EQUAL (telemetry->calls (SolverTelemetry::VALUE), 0);
+
+  // Nothing is recorded once the telemetry is removed.
+  solver.telemetry (SolverTelemetryPtr_t ());
+  vector_t x (configs.col(0));
+  solver.solve<lineSearch::Backtracking> (x);
+  BOOST_CHECK_EQUAL (telemetry->resolutions (), 0);
+}
+
 BOOST_AUTO_TEST_CASE(hybrid_solver)
 {
   DevicePtr_t device = hpp::pinocchio::unittest::makeDevice (hpp::pinocchio::unittest::HumanoidRomeo);
@@ -589,3 +858,216 @@ BOOST_AUTO_TEST_CASE(hybrid_solver)
   qrand = tmp;
   solver.projectOnKernel (qrand, dq, tmp);
 }
+
+BOOST_AUTO_TEST_CASE(promote_to_explicit)
+{
+  DevicePtr_t device = hpp::pinocchio::unittest::makeDevice (hpp::pinocchio::unittest::HumanoidRomeo);
+  BOOST_REQUIRE (device);
+  JointPtr_t root = device->rootJoint(),
+             ee = device->getJointByName ("LWristPitch");
+
+  Configuration_t q = device->currentConfiguration (),
+                  qrand = se3::randomConfiguration(device->model());
+
+  HybridSolver solver(device->configSize(), device->numberDof());
+  solver.maxIterations(20);
+  solver.errorThreshold(1e-3);
+  solver.integration(boost::bind(hpp::pinocchio::integrate<true, se3::LieGroupTpl>, device, _1, _2, _3));
+  solver.saturation(boost::bind(saturate, device, _1, _2));
+
+  device->currentConfiguration (q);
+  device->computeForwardKinematics ();
+  Transform3f tfRoot (root->currentTransformation ());
+  Transform3f tfEe (ee->currentTransformation ());
+
+  solver.add(Transformation::create ("Transformation root", device, root, tfRoot), 0);
+  solver.add(Orientation::create ("Orientation LWristPitch", device, ee, tfEe), 0);
+  // The relative transformation is not promoted: it is in level 1 and
+  // only level 0 is scanned.
+  solver.add(RelativeTransformation::create ("RelativeTransformation",
+        device, ee, root, Transform3f::Identity()), 1);
+
+  BOOST_CHECK_EQUAL(solver.dimension(), 15);
+  BOOST_CHECK_EQUAL(solver.promoteToExplicit(), 1);
+  BOOST_CHECK_EQUAL(solver.numberStacks(), 2);
+  BOOST_CHECK_EQUAL(solver.dimension(), 9);
+  BOOST_CHECK_EQUAL(solver.explicitSolver().outDers().nbIndices(), 6);
+  BOOST_CHECK_EQUAL(solver.promoteToExplicit(), 0);
+
+  solver.lastIsOptional(true);
+  BOOST_CHECK_EQUAL(solver.solve<lineSearch::Backtracking>(qrand),
+                    HybridSolver::SUCCESS);
+  device->currentConfiguration (qrand);
+  device->computeForwardKinematics ();
+  BOOST_CHECK(root->currentTransformation ().isApprox (tfRoot, 1e-3));
+}
+
+/// Romeo and a free-flying object attached to the world.
+DevicePtr_t makeRomeoAndObject ()
+{
+  DevicePtr_t device = hpp::pinocchio::unittest::makeDevice (hpp::pinocchio::unittest::HumanoidRomeo);
+  if (!device) return device;
+  device->model ().addJoint (0, se3::JointModelFreeFlyer (),
+                             se3::SE3::Identity (), "object");
+  device->createData ();
+  JointPtr_t joints[] = { device->rootJoint (),
+                          device->getJointByName ("object") };
+  for (std::size_t i = 0; i < 2; ++i) {
+    for (size_type j = 0; j < 3; ++j) {
+      joints[i]->lowerBound (j, -1);
+      joints[i]->upperBound (j,  1);
+    }
+  }
+  return device;
+}
+
+/// Explicit function of the configuration parameters it depends on,
+/// as a function of the robot configuration.
+class ExplicitOfConfiguration : public DifferentiableFunction
+{
+  public:
+    ExplicitOfConfiguration (const DevicePtr_t& robot,
+                             const ExplicitRelativeTransformationPtr_t& f) :
+      DifferentiableFunction (robot->configSize (), robot->numberDof (),
+                              f->outputSpace (), "ExplicitOfConfiguration"),
+      f_ (f), J_ (f->outputDerivativeSize (), f->inputDerivativeSize ())
+    {}
+
+  protected:
+    void impl_compute (LiegroupElement& result, vectorIn_t q) const
+    {
+      f_->value (result, f_->inArg ().rview (q).eval ());
+    }
+
+    void impl_jacobian (matrixOut_t jacobian, vectorIn_t q) const
+    {
+      f_->jacobian (J_, f_->inArg ().rview (q).eval ());
+      jacobian.setZero ();
+      f_->inDer ().lview (jacobian) = J_;
+    }
+
+  private:
+    ExplicitRelativeTransformationPtr_t f_;
+    mutable matrix_t J_;
+};
+
+BOOST_AUTO_TEST_CASE(promote_relative_to_explicit)
+{
+  DevicePtr_t device = makeRomeoAndObject ();
+  BOOST_REQUIRE (device);
+  JointPtr_t ee = device->getJointByName ("LWristPitch"),
+             object = device->getJointByName ("object");
+  BOOST_REQUIRE (object);
+  BOOST_CHECK (ExplicitRelativeTransformation::isExplicit (device, ee,
+                                                           object));
+  BOOST_CHECK (!ExplicitRelativeTransformation::isExplicit (device, object,
+                                                            ee));
+
+  // The object is held by the gripper.
+  const Transform3f gripper (Transform3f::Random ()),
+        handle (Transform3f::Random ());
+  DifferentiableFunctionPtr_t grasp (RelativeTransformation::create
+      ("Grasp", device, ee, object, gripper, handle));
+  ExplicitRelativeTransformationPtr_t explicitGrasp
+    (ExplicitRelativeTransformation::create ("Explicit Grasp", device, ee,
+                                             object, gripper, handle));
+
+  // The explicit function solves the grasp and its jacobian matches
+  // finite differences.
+  ExplicitOfConfiguration f (device, explicitGrasp);
+  LiegroupElement value (f.outputSpace ()),
+                  error (grasp->outputSpace ());
+  matrix_t J (f.outputDerivativeSize (), f.inputDerivativeSize ()),
+           fdJ (f.outputDerivativeSize (), f.inputDerivativeSize ());
+  for (int i = 0; i < 10; ++i) {
+    Configuration_t q = se3::randomConfiguration (device->model ());
+    f.value (value, q);
+    explicitGrasp->outArg ().lview (q) = value.vector ();
+    grasp->value (error, q);
+    BOOST_CHECK_SMALL (error.vector ().norm (), 1e-10);
+
+    f.jacobian (J, q);
+    f.finiteDifferenceCentral (fdJ, q, device);
+    BOOST_CHECK_SMALL ((J - fdJ).norm (), 1e-5);
+  }
+
+  device->currentConfiguration (device->neutralConfiguration ());
+  device->computeForwardKinematics ();
+  Transform3f tfEe (ee->currentTransformation ());
+
+  HybridSolver solver(device->configSize(), device->numberDof());
+  solver.maxIterations(20);
+  solver.errorThreshold(1e-3);
+  solver.integration(boost::bind(hpp::pinocchio::integrate<true, se3::LieGroupTpl>, device, _1, _2, _3));
+  solver.saturation(boost::bind(saturate, device, _1, _2));
+
+  solver.add(grasp, 0);
+  solver.add(Orientation::create ("Orientation LWristPitch", device, ee, tfEe), 0);
+  BOOST_CHECK_EQUAL(solver.dimension(), 9);
+  BOOST_CHECK_EQUAL(solver.reducedDimension(), 9);
+
+  BOOST_CHECK_EQUAL(solver.promoteToExplicit(), 1);
+  BOOST_CHECK_EQUAL(solver.numberStacks(), 1);
+  BOOST_CHECK_EQUAL(solver.dimension(), 3);
+  BOOST_CHECK_EQUAL(solver.reducedDimension(), 3);
+  BOOST_CHECK_EQUAL(solver.explicitSolver().outDers().nbIndices(), 6);
+  BOOST_CHECK_EQUAL(solver.explicitSolver().outArgs().nbIndices(), 7);
+
+  for (int i = 0; i < 10; ++i) {
+    Configuration_t q = se3::randomConfiguration (device->model ());
+    BOOST_CHECK_EQUAL(solver.solve<lineSearch::Backtracking>(q),
+                      HybridSolver::SUCCESS);
+    grasp->value (error, q);
+    BOOST_CHECK_SMALL (error.vector ().norm (), 1e-8);
+    BOOST_CHECK (solver.isSatisfied (q));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(explicit_relative_keeps_robot)
+{
+  DevicePtr_t device = makeRomeoAndObject ();
+  BOOST_REQUIRE (device);
+  JointPtr_t ee = device->getJointByName ("LWristPitch"),
+             other = device->getJointByName ("RWristPitch"),
+             object = device->getJointByName ("object");
+  BOOST_REQUIRE (object);
+
+  const Transform3f gripper (Transform3f::Random ()),
+        handle (Transform3f::Random ());
+  DifferentiableFunctionPtr_t grasp (RelativeTransformation::create
+      ("Grasp", device, ee, object, gripper, handle));
+
+  device->currentConfiguration (device->neutralConfiguration ());
+  device->computeForwardKinematics ();
+  // The implicit constraint depends on joints that are not an input of the
+  // explicit grasp, and caches the last configuration of the robot.
+  DifferentiableFunctionPtr_t orientation (Orientation::create
+      ("Orientation RWristPitch", device, other,
+       other->currentTransformation ()));
+
+  HybridSolver solver(device->configSize(), device->numberDof());
+  solver.maxIterations(20);
+  solver.errorThreshold(1e-3);
+  solver.integration(boost::bind(hpp::pinocchio::integrate<true, se3::LieGroupTpl>, device, _1, _2, _3));
+  solver.saturation(boost::bind(saturate, device, _1, _2));
+  solver.add(grasp, 0);
+  solver.add(orientation, 0);
+  BOOST_CHECK_EQUAL(solver.promoteToExplicit(), 1);
+
+  // The solver workspace has no context: the explicit grasp is evaluated
+  // without context and must not modify the robot behind the cache of the
+  // orientation.
+  LiegroupElement error (orientation->outputSpace ()),
+                  graspError (grasp->outputSpace ());
+  EvaluationContext context;
+  for (int i = 0; i < 10; ++i) {
+    Configuration_t q = se3::randomConfiguration (device->model ());
+    solver.isSatisfied (q);
+    BOOST_CHECK_EQUAL(solver.solve<lineSearch::Backtracking>(q),
+                      HybridSolver::SUCCESS);
+    orientation->value (error, q, context);
+    BOOST_CHECK_SMALL (error.vector ().norm (), 1e-3);
+    grasp->value (graspError, q, context);
+    BOOST_CHECK_SMALL (graspError.vector ().norm (), 1e-3);
+  }
+}
@@ -18,6 +18,10 @@
 #include <boost/test/unit_test.hpp>
 
 #include <hpp/constraints/iterative-solver.hh>
+#include <hpp/constraints/affine-function.hh>
+#include <hpp/constraints/differentiable-function-stack.hh>
+#include <hpp/constraints/evaluation-context.hh>
+#include <hpp/constraints/work-stealing-pool.hh>
 
 #include <functional>
 
@@ -77,6 +81,259 @@ struct test_quadratic
   }
 };
 
+/// Position of the end effector of a planar arm with two links of length 1,
+/// relatively to a target.
+class PlanarArm : public DifferentiableFunction
+{
+  public:
+    PlanarArm (const vector_t& target)
+      : DifferentiableFunction (2, 2, 2, "PlanarArm"), target_ (target),
+      nbValues (0), nbJacobians (0)
+    {}
+
+    void impl_compute (LiegroupElement& y, vectorIn_t q) const
+    {
+      ++nbValues;
+      y.vector()[0] = cos (q[0]) + cos (q[0] + q[1]) - target_[0];
+      y.vector()[1] = sin (q[0]) + sin (q[0] + q[1]) - target_[1];
+    }
+
+    void impl_jacobian (matrixOut_t J, vectorIn_t q) const
+    {
+      ++nbJacobians;
+      J(0,1) = - sin (q[0] + q[1]);
+      J(1,1) =   cos (q[0] + q[1]);
+      J(0,0) = - sin (q[0]) + J(0,1);
+      J(1,0) =   cos (q[0]) + J(1,1);
+    }
+
+    vector_t target_;
+    mutable std::size_t nbValues, nbJacobians;
+};
+
+template <typename LineSearch>
+void solvePlanarArm (const vector_t& target, const matrix_t& starts,
+                     const char* name, std::size_t& success,
+                     std::size_t& iterations)
+{
+  boost::shared_ptr<PlanarArm> f (new PlanarArm (target));
+  HierarchicalIterativeSolver solver (2, 2);
+  solver.maxIterations(40);
+  solver.errorThreshold(test_precision);
+  solver.integration(simpleIntegration<-1000,1000>);
+  solver.saturation(simpleSaturation<-1000,1000>);
+  solver.add(f, 0);
+
+  success = iterations = 0;
+  for (size_type i = 0; i < starts.cols(); ++i) {
+    vector_t q (starts.col(i));
+    f->nbJacobians = 0;
+    if (solver.solve (q, LineSearch()) == HierarchicalIterativeSolver::SUCCESS) {
+      ++success;
+      iterations += f->nbJacobians;
+    }
+  }
+  BOOST_TEST_MESSAGE (name << ": " << success << " / " << starts.cols()
+      << " succeeded, " << value_type(iterations) / value_type(success)
+      << " iterations per success");
+}
+
+BOOST_AUTO_TEST_CASE(levenberg_marquardt)
+{
+  // The target is close to the boundary of the workspace, where the
+  // Jacobian is singular.
+  vector_t target (VECTOR2(1.9999 * cos(0.3), 1.9999 * sin(0.3)));
+  matrix_t starts (M_PI * matrix_t::Random (2, 100));
+
+  std::size_t sBT, iBT, sFS, iFS, sLM, iLM;
+  solvePlanarArm<lineSearch::Backtracking      > (target, starts, "Backtracking"      , sBT, iBT);
+  solvePlanarArm<lineSearch::FixedSequence     > (target, starts, "FixedSequence"     , sFS, iFS);
+  solvePlanarArm<lineSearch::LevenbergMarquardt> (target, starts, "LevenbergMarquardt", sLM, iLM);
+
+  BOOST_CHECK_GE (sLM, sBT);
+  BOOST_CHECK_GE (sLM, sFS);
+}
+
+BOOST_AUTO_TEST_CASE(jacobian_reuse)
+{
+  boost::shared_ptr<PlanarArm> f (new PlanarArm (VECTOR2(1.2, 0.5)));
+  HierarchicalIterativeSolver solver (2, 2);
+  solver.maxIterations(40);
+  solver.errorThreshold(test_precision);
+  solver.integration(simpleIntegration<-1000,1000>);
+  solver.saturation(simpleSaturation<-1000,1000>);
+  solver.add(f, 0);
+
+  matrix_t starts (0.5 * matrix_t::Random (2, 50));
+  starts.row(0).array() += 0.2;
+  starts.row(1).array() += 1.2;
+  std::size_t exact = 0, reuse = 0, updates = 0;
+  SolverWorkspace ws (solver);
+  for (size_type i = 0; i < starts.cols(); ++i) {
+    vector_t q (starts.col(i));
+
+    solver.maxJacobianReuse (0);
+    f->nbJacobians = 0;
+    BOOST_CHECK_EQUAL (solver.solve<lineSearch::Backtracking> (q, ws),
+                       HierarchicalIterativeSolver::SUCCESS);
+    BOOST_CHECK_EQUAL (ws.jacobianEvaluations, (size_type)f->nbJacobians);
+    BOOST_CHECK_EQUAL (ws.jacobianUpdates, 0);
+    exact += f->nbJacobians;
+
+    q = starts.col(i);
+    solver.maxJacobianReuse (3);
+    f->nbJacobians = 0;
+    BOOST_CHECK_EQUAL (solver.solve<lineSearch::Backtracking> (q, ws),
+                       HierarchicalIterativeSolver::SUCCESS);
+    BOOST_CHECK_EQUAL (ws.jacobianEvaluations, (size_type)f->nbJacobians);
+    BOOST_CHECK_SMALL ((*f) (q).vector().norm(), test_precision);
+    reuse += f->nbJacobians;
+    updates += ws.jacobianUpdates;
+  }
+  BOOST_TEST_MESSAGE ("Jacobian evaluations: " << exact << " without reuse, "
+      << reuse << " with reuse (" << updates << " Broyden updates)");
+  BOOST_CHECK_LT (reuse, exact);
+}
+
+BOOST_AUTO_TEST_CASE(jacobian_reuse_inequality)
+{
+  // The arm with the inequality q0 >= 0.
+  boost::shared_ptr<PlanarArm> f (new PlanarArm (VECTOR2(1.2, 0.5)));
+  matrix_t A (1, 2);
+  A << 1, 0;
+  AffineFunctionPtr_t g (new AffineFunction (A));
+  HierarchicalIterativeSolver solver (2, 2);
+  solver.maxIterations(40);
+  solver.errorThreshold(test_precision);
+  solver.integration(simpleIntegration<-1000,1000>);
+  solver.saturation(simpleSaturation<-1000,1000>);
+  solver.add(f, 0);
+  solver.add(g, 0, ComparisonTypes_t (1, Superior));
+  solver.maxJacobianReuse (3);
+
+  matrix_t starts (matrix_t::Random (2, 50));
+  starts.row(1).array() += 1.2;
+  size_type updates = 0;
+  SolverWorkspace ws (solver);
+  for (size_type i = 0; i < starts.cols(); ++i) {
+    vector_t q (starts.col(i));
+    f->nbValues = 0;
+    solver.solve<lineSearch::Constant> (q, ws);
+    // The values are computed once per evaluation or update of the
+    // Jacobians.
+    BOOST_CHECK_EQUAL ((size_type)f->nbValues,
+                       ws.jacobianEvaluations + ws.jacobianUpdates);
+    updates += ws.jacobianUpdates;
+    // The row of the inequality is zero when it is satisfied, even after
+    // a Broyden update.
+    const SolverWorkspace::Level& l = ws.levels[0];
+    if (l.reducedError[2] == 0)
+      BOOST_CHECK (l.reducedJ.row (2).isZero ());
+  }
+  BOOST_CHECK_GT (updates, 0);
+}
+
+/// PlanarArm of a third unused variable, which evaluates the value and the
+/// jacobian together.
+class FusedPlanarArm : public DifferentiableFunction
+{
+  public:
+    FusedPlanarArm (const vector_t& target)
+      : DifferentiableFunction (3, 3, 2, "FusedPlanarArm"), arm_ (target),
+      nbJacobians (0), nbFused (0)
+    {
+      activeParameters_[2] = activeDerivativeParameters_[2] = false;
+    }
+
+    void impl_compute (LiegroupElement& y, vectorIn_t q) const
+    {
+      arm_.value (y, q.head (2));
+    }
+
+    void impl_jacobian (matrixOut_t J, vectorIn_t q) const
+    {
+      ++nbJacobians;
+      arm_.jacobian (J.leftCols (2), q.head (2));
+      J.col (2).setZero ();
+    }
+
+    void impl_valueAndJacobian (LiegroupElement& y, matrixOut_t J,
+                                vectorIn_t q) const
+    {
+      ++nbFused;
+      arm_.value (y, q.head (2));
+      arm_.jacobian (J.leftCols (2), q.head (2));
+      J.col (2).setZero ();
+    }
+
+    void impl_valueAndJacobian (LiegroupElement& y, matrixOut_t J,
+                                vectorIn_t q, EvaluationContext& context) const
+    {
+      legacyValueAndJacobian (y, J, q, &context);
+    }
+
+    void impl_valueAndJacobianCompressed (LiegroupElement& y, matrixOut_t J,
+                                          vectorIn_t q) const
+    {
+      legacyValueAndJacobian (y, J, q, NULL);
+    }
+
+    void impl_valueAndJacobianCompressed (LiegroupElement& y, matrixOut_t J,
+                                          vectorIn_t q,
+                                          EvaluationContext& context) const
+    {
+      legacyValueAndJacobian (y, J, q, &context);
+    }
+
+    PlanarArm arm_;
+    mutable std::size_t nbJacobians, nbFused;
+};
+
+BOOST_AUTO_TEST_CASE(fused_evaluation)
+{
+  boost::shared_ptr<FusedPlanarArm> f
+    (new FusedPlanarArm (VECTOR2(1.2, 0.5)));
+  HierarchicalIterativeSolver solver (3, 3);
+  solver.maxIterations(40);
+  solver.errorThreshold(test_precision);
+  solver.integration(simpleIntegration<-1000,1000>);
+  solver.saturation(simpleSaturation<-1000,1000>);
+  solver.add(f, 0);
+
+  // The solver only computes the active column of the jacobian.
+  SolverWorkspace ws (solver);
+  BOOST_REQUIRE (ws.context);
+  BOOST_CHECK_EQUAL (ws.levels[0].compressedJ.cols (), 2);
+  matrix_t starts (0.5 * matrix_t::Random (3, 20));
+  starts.row(0).array() += 0.2;
+  starts.row(1).array() += 1.2;
+  for (size_type i = 0; i < starts.cols(); ++i) {
+    vector_t q (starts.col(i));
+    f->nbJacobians = f->nbFused = 0;
+    BOOST_CHECK_EQUAL (solver.solve<lineSearch::Backtracking> (q, ws),
+                       HierarchicalIterativeSolver::SUCCESS);
+    // One fused evaluation per jacobian of the solver.
+    BOOST_CHECK_EQUAL (f->nbJacobians, 0);
+    BOOST_CHECK_EQUAL (ws.jacobianEvaluations, (size_type)f->nbFused);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(context_scratch)
+{
+  std::size_t id1 = EvaluationContext::newScratchId (),
+              id2 = EvaluationContext::newScratchId ();
+  BOOST_CHECK (id1 != id2);
+
+  EvaluationContext context;
+  context.scratch (id1, vector_t (vector_t::Zero (2)))[0] = 1;
+  BOOST_CHECK_EQUAL (context.scratch (id1, vector_t ())[0], 1);
+  BOOST_CHECK_EQUAL (context.scratch (id2, vector_t ()).size (), 0);
+
+  // The scratch data are initialized again once deleted.
+  context.clearScratches ();
+  BOOST_CHECK_EQUAL (context.scratch (id1, vector_t ()).size (), 0);
+}
+
 BOOST_AUTO_TEST_CASE(quadratic)
 {
   matrix_t A(2,2);
@@ -117,6 +374,247 @@ BOOST_AUTO_TEST_CASE(quadratic)
   EIGEN_VECTOR_IS_APPROX (test1.success (0, 1), VECTOR2(0.,1/sqrt(2)));
 }
 
+BOOST_AUTO_TEST_CASE(decomposition_kernel)
+{
+  const size_type n = 8;
+  // A matrix of rank 3.
+  matrix_t J (matrix_t::Random (5, 3) * matrix_t::Random (3, n)), basis (n, n);
+  vector_t x (n);
+
+  const Decomposition::Type types[] = {
+    Decomposition::JACOBI_SVD,
+    Decomposition::BDC_SVD,
+    Decomposition::COMPLETE_ORTHOGONAL_DECOMPOSITION,
+    Decomposition::COL_PIV_HOUSEHOLDER_QR,
+    Decomposition::DAMPED_LLT
+  };
+  for (std::size_t i = 0; i < 5; ++i) {
+    Decomposition decomposition;
+    decomposition.allocate (types[i], J.rows(), J.cols(), true);
+    decomposition.threshold (1e-8);
+    decomposition.compute (J);
+    basis.setIdentity ();
+    decomposition.applyKernelQOnTheRight (basis);
+    const size_type d = decomposition.kernelDimension ();
+    BOOST_CHECK_EQUAL (d, n - 3);
+    BOOST_CHECK_SMALL ((J * basis.rightCols (d)).norm(), test_precision);
+    BOOST_CHECK ((basis.transpose() * basis).isIdentity (test_precision));
+
+    x.setRandom ();
+    const vector_t Qx (basis * x);
+    decomposition.applyKernelQOnTheLeft (x);
+    EIGEN_VECTOR_IS_APPROX (x, Qx);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(hierarchy)
+{
+  // Three compatible levels of linear equations. Without line search, the
+  // solver finds the solution in one iteration if the levels are solved
+  // in the kernel of the upper ones.
+  const size_type n = 12;
+  AffineFunctionPtr_t f0 (new AffineFunction (matrix_t::Random (3, n), vector_t::Random (3))),
+                      f1 (new AffineFunction (matrix_t::Random (4, n), vector_t::Random (4))),
+                      f2 (new AffineFunction (matrix_t::Random (3, n), vector_t::Random (3)));
+
+  const Decomposition::Type types[] = {
+    Decomposition::JACOBI_SVD,
+    Decomposition::BDC_SVD,
+    Decomposition::COMPLETE_ORTHOGONAL_DECOMPOSITION,
+    Decomposition::COL_PIV_HOUSEHOLDER_QR,
+    Decomposition::DAMPED_LLT
+  };
+  for (std::size_t i = 0; i < 5; ++i) {
+    HierarchicalIterativeSolver solver (n, n);
+    solver.maxIterations(2);
+    solver.errorThreshold(test_precision);
+    solver.integration(simpleIntegration<-100,100>);
+    solver.saturation(simpleSaturation<-100,100>);
+    solver.decomposition (types[i]);
+    solver.decompositionDamping (1e-12);
+    solver.add (f0, 0);
+    solver.add (f1, 1);
+    solver.add (f2, 2);
+
+    vector_t x (vector_t::Random (n));
+    BOOST_CHECK_EQUAL (solver.solve<lineSearch::Constant> (x),
+                       HierarchicalIterativeSolver::SUCCESS);
+    BOOST_CHECK_SMALL ((*f0) (x).vector().norm(), test_precision);
+    BOOST_CHECK_SMALL ((*f1) (x).vector().norm(), test_precision);
+    BOOST_CHECK_SMALL ((*f2) (x).vector().norm(), test_precision);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(compressed_jacobian)
+{
+  const size_type n = 10;
+  matrix_t J0 (matrix_t::Random (3, n)), J1 (matrix_t::Random (4, n)),
+           J2 (matrix_t::Random (2, n)), J3 (matrix_t::Zero (2, n));
+  J0.leftCols (4).setZero ();
+  J1.rightCols (4).setZero ();
+  J3.col (0).setRandom ();
+  J3.col (6).setRandom ();
+  AffineFunctionPtr_t f0 (new AffineFunction (J0)), f1 (new AffineFunction (J1)),
+                      f2 (new AffineFunction (J2)), f3 (new AffineFunction (J3));
+
+  // The compressed jacobian contains the active columns.
+  matrix_t Jc (f1->outputDerivativeSize(), f1->activeDerivativeSize());
+  BOOST_CHECK_EQUAL (Jc.cols(), 6);
+  vector_t x (vector_t::Random (n));
+  f1->jacobianCompressed (Jc, x);
+  BOOST_CHECK_EQUAL (Jc, J1.leftCols (6));
+
+  // f3 only depends on variables which are not reduced.
+  HierarchicalIterativeSolver solver (n, n);
+  solver.add (f0, 0);
+  solver.add (f3, 0);
+  solver.add (f1, 0);
+  solver.add (f2, 1);
+  segments_t reduction;
+  reduction.push_back (segment_t (1, 5));
+  reduction.push_back (segment_t (7, 3));
+  solver.reduction (reduction);
+  BOOST_CHECK_EQUAL (solver.reducedDimension (), 9);
+
+  matrix_t expected (9, n);
+  expected << J0, J1, J2;
+  Eigen::ColBlockIndices cols (reduction);
+  matrix_t reducedJ (9, 8);
+  for (int k = 0; k < 2; ++k) {
+    // Computing a second time checks that the jacobians are overwritten.
+    solver.computeValue<true> (x);
+    solver.getReducedJacobian (reducedJ);
+    BOOST_CHECK_EQUAL (reducedJ, cols.rview (expected).eval());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(block_decomposition)
+{
+  // Two robots, of 5 variables each, with two levels of constraints.
+  const size_type n = 10;
+  matrix_t J0 (matrix_t::Zero (2, n)), J1 (matrix_t::Zero (2, n)),
+           J2 (matrix_t::Zero (2, n)), J3 (matrix_t::Zero (1, n));
+  J0.leftCols  (5).setRandom ();
+  J1.rightCols (5).setRandom ();
+  J2.leftCols  (5).setRandom ();
+  J3.rightCols (5).setRandom ();
+  AffineFunctionPtr_t f0 (new AffineFunction (J0, vector_t::Random (2))),
+                      f1 (new AffineFunction (J1, vector_t::Random (2))),
+                      f2 (new AffineFunction (J2, vector_t::Random (2))),
+                      f3 (new AffineFunction (J3, vector_t::Random (1)));
+
+  WorkStealingPool pool (2);
+  HierarchicalIterativeSolver solvers[3] = {
+    HierarchicalIterativeSolver (n, n), HierarchicalIterativeSolver (n, n),
+    HierarchicalIterativeSolver (n, n) };
+  for (std::size_t i = 0; i < 3; ++i) {
+    HierarchicalIterativeSolver& solver = solvers[i];
+    solver.maxIterations(2);
+    solver.errorThreshold(test_precision);
+    solver.integration(simpleIntegration<-100,100>);
+    solver.saturation(simpleSaturation<-100,100>);
+    solver.add (f0, 0);
+    solver.add (f1, 0);
+    solver.add (f2, 1);
+    solver.add (f3, 1);
+  }
+  solvers[0].blockDecomposition (false);
+  solvers[2].blockPool (&pool);
+  BOOST_CHECK_EQUAL (solvers[0].numberBlocks (), 0);
+  BOOST_CHECK_EQUAL (solvers[1].numberBlocks (), 2);
+
+  // The blocks give the descent direction of the whole problem.
+  const vector_t x0 (vector_t::Random (n));
+  vector_t x[3];
+  for (std::size_t i = 0; i < 3; ++i) {
+    x[i] = x0;
+    BOOST_CHECK_EQUAL (solvers[i].solve<lineSearch::Constant> (x[i]),
+                       HierarchicalIterativeSolver::SUCCESS);
+  }
+  EIGEN_VECTOR_IS_APPROX (x[1], x[0]);
+  EIGEN_VECTOR_IS_APPROX (x[2], x[0]);
+  for (std::size_t i = 0; i < 3; ++i) {
+    x[i] = x0;
+    solvers[i].solve<lineSearch::LevenbergMarquardt> (x[i]);
+  }
+  EIGEN_VECTOR_IS_APPROX (x[1], x[0]);
+  EIGEN_VECTOR_IS_APPROX (x[2], x[0]);
+
+  // Enabling the decomposition keeps the right hand side.
+  const vector_t rhs (vector_t::Random (solvers[0].rightHandSideSize ()));
+  solvers[0].rightHandSide (rhs);
+  solvers[0].blockDecomposition (true);
+  BOOST_CHECK_EQUAL (solvers[0].numberBlocks (), 2);
+  EIGEN_VECTOR_IS_APPROX (solvers[0].rightHandSide (), rhs);
+
+  // A function coupling both robots merges the blocks.
+  AffineFunctionPtr_t f4 (new AffineFunction (matrix_t::Random (1, n)));
+  solvers[1].add (f4, 1);
+  BOOST_CHECK_EQUAL (solvers[1].numberBlocks (), 0);
+}
+
+BOOST_AUTO_TEST_CASE(parallel_stack)
+{
+  const size_type n = 10;
+  DifferentiableFunctionStackPtr_t serial
+    (DifferentiableFunctionStack::create ("serial")),
+    parallel (DifferentiableFunctionStack::create ("parallel"));
+  for (size_type i = 0; i < 20; ++i) {
+    const size_type m = 1 + i % 4;
+    AffineFunctionPtr_t f (new AffineFunction
+        (matrix_t::Random (m, n), vector_t::Random (m)));
+    serial->add (f);
+    parallel->add (f);
+  }
+  WorkStealingPool pool (3);
+  parallel->parallel (&pool, 8);
+  BOOST_CHECK_EQUAL (parallel->pool (), &pool);
+
+  EvaluationContext context;
+  LiegroupElement v0 (serial->outputSpace ()), v1 (parallel->outputSpace ());
+  matrix_t J0 (serial->outputDerivativeSize (), n),
+           J1 (parallel->outputDerivativeSize (), n);
+  for (int k = 0; k < 3; ++k) {
+    vector_t x (vector_t::Random (n));
+    serial->valueAndJacobian (v0, J0, x);
+
+    parallel->value (v1, x);
+    BOOST_CHECK_EQUAL (v1.vector (), v0.vector ());
+    parallel->jacobian (J1, x);
+    BOOST_CHECK_EQUAL (J1, J0);
+
+    v1.vector ().setZero (); J1.setZero ();
+    parallel->valueAndJacobian (v1, J1, x);
+    BOOST_CHECK_EQUAL (v1.vector (), v0.vector ());
+    BOOST_CHECK_EQUAL (J1, J0);
+
+    v1.vector ().setZero (); J1.setZero ();
+    parallel->valueAndJacobian (v1, J1, x, context);
+    BOOST_CHECK_EQUAL (v1.vector (), v0.vector ());
+    BOOST_CHECK_EQUAL (J1, J0);
+  }
+
+  // Small stacks are evaluated sequentially.
+  parallel->parallel (&pool, 32);
+  vector_t x (vector_t::Random (n));
+  serial->value (v0, x);
+  parallel->value (v1, x);
+  BOOST_CHECK_EQUAL (v1.vector (), v0.vector ());
+
+  // The result does not depend on the number of threads.
+  serial->valueAndJacobian (v0, J0, x);
+  for (std::size_t t = 1; t <= 8; t *= 2) {
+    WorkStealingPool threads (t);
+    parallel->parallel (&threads, 1);
+    v1.vector ().setZero (); J1.setZero ();
+    parallel->valueAndJacobian (v1, J1, x);
+    BOOST_CHECK_EQUAL (v1.vector (), v0.vector ());
+    BOOST_CHECK_EQUAL (J1, J0);
+    parallel->parallel (NULL);
+  }
+  BOOST_CHECK (parallel->pool () == NULL);
+}
+
 BOOST_AUTO_TEST_CASE(one_layer)
 {
   DevicePtr_t device = hpp::pinocchio::unittest::makeDevice (hpp::pinocchio::unittest::HumanoidRomeo);
@@ -157,5 +655,7 @@ BOOST_AUTO_TEST_CASE(one_layer)
   BOOST_CHECK_EQUAL(solver.solve<lineSearch::ErrorNormBased>(qrand), HierarchicalIterativeSolver::SUCCESS);
   qrand = tmp;
   BOOST_CHECK_EQUAL(solver.solve<lineSearch::FixedSequence >(qrand), HierarchicalIterativeSolver::SUCCESS);
+  qrand = tmp;
+  BOOST_CHECK_EQUAL(solver.solve<lineSearch::LevenbergMarquardt>(qrand), HierarchicalIterativeSolver::SUCCESS);
 }
 
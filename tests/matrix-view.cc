@@ -280,6 +280,62 @@ template <typename MatrixBlocks_t> void checkMatrixBlocks
    */
 }
 
+BOOST_AUTO_TEST_CASE(interval_set)
+{
+  typedef BlockIndex::segment_t segment_t;
+  typedef BlockIndex::segments_t segments_t;
+
+  IntervalSet s;
+  s.insert (segment_t (10, 2));
+  s.insert (segment_t (0, 3));
+  s.insert (segment_t (5, 0));
+  s.insert (segment_t (3, 2));
+  // 0 1 2 3 4 10 11
+  segments_t expected = list_of (segment_t (0, 5))(segment_t (10, 2));
+  BOOST_CHECK (s.segments () == expected);
+  BOOST_CHECK_EQUAL (s.cardinal (), 7);
+
+  s.insert (segment_t (4, 7));
+  expected = list_of (segment_t (0, 12));
+  BOOST_CHECK (s.segments () == expected);
+  BOOST_CHECK_EQUAL (s.cardinal (), 12);
+
+  s.erase (segment_t (2, 3));
+  s.erase (segment_t (8, 1));
+  s.erase (segment_t (11, 5));
+  expected = list_of (segment_t (0, 2))(segment_t (5, 3))(segment_t (9, 2));
+  BOOST_CHECK (s.segments () == expected);
+  BOOST_CHECK_EQUAL (s.cardinal (), 7);
+  BOOST_CHECK ( s.contains (0));
+  BOOST_CHECK (!s.contains (2));
+  BOOST_CHECK ( s.contains (7));
+  BOOST_CHECK (!s.contains (8));
+  BOOST_CHECK (!s.contains (11));
+
+  s.erase (segment_t (0, 20));
+  BOOST_CHECK (s.empty ());
+  BOOST_CHECK_EQUAL (s.cardinal (), 0);
+
+  // Compare with BlockIndex on random segments.
+  segments_t v;
+  for (int i = 0; i < 200; ++i)
+    v.push_back (segment_t (std::rand () % 1000, std::rand () % 5));
+  IntervalSet r (v);
+  segments_t w (v);
+  BlockIndex::sort (w);
+  BlockIndex::shrink (w);
+  segments_t nonEmpty;
+  for (std::size_t i = 0; i < w.size (); ++i)
+    if (w[i].second > 0) nonEmpty.push_back (w[i]);
+  BOOST_CHECK (r.segments () == nonEmpty);
+  BOOST_CHECK_EQUAL (r.cardinal (), BlockIndex::cardinal (w));
+
+  segments_t a (v.begin (), v.begin () + 100), b (v.begin () + 100, v.end ());
+  BlockIndex::sort (a);
+  BlockIndex::sort (b);
+  BOOST_CHECK (IntervalSet::unite (a, b) == w);
+}
+
 BOOST_AUTO_TEST_CASE(matrix_block_view)
 {
   typedef MatrixBlocks<false, true> RowsIndices;
@@ -325,3 +381,93 @@ BOOST_AUTO_TEST_CASE(matrix_block_view)
   checkMatrixBlocks (blocks.keepRows(), m);
   checkMatrixBlocks (blocks.keepCols(), m);
 }
+
+BOOST_AUTO_TEST_CASE(compiled_matrix_blocks)
+{
+  typedef MatrixBlocks<false, true> RowsIndices;
+  typedef MatrixBlocks<true, false> ColsIndices;
+  typedef MatrixBlocks<false, false> MatrixBlocks_t;
+
+  MatrixXd m (MatrixXd::Random (30, 25));
+
+  // Short and long runs, and two adjacent segments which are merged.
+  RowsIndices rows;
+  rows.addRow (1, 1);
+  rows.addRow (3, 2);
+  rows.addRow (5, 1);
+  rows.addRow (10, 12);
+  rows.addRow (25, 3);
+  ColsIndices cols;
+  cols.addCol (0, 2);
+  cols.addCol (4, 9);
+  cols.addCol (20, 1);
+  MatrixBlocks_t blocks (rows.rows(), cols.cols());
+
+  IndexPlan plan (rows.rows());
+  BOOST_CHECK_EQUAL (plan.size, rows.nbRows());
+  BOOST_CHECK_EQUAL (plan.runs.size(), 1);
+  BOOST_CHECK_EQUAL (plan.in.size(), 7);
+
+  MatrixXd small, res;
+  // Rows
+  small.resize (rows.nbRows(), m.cols());
+  rows.compile().gather (m, small);
+  BOOST_CHECK_EQUAL (small, rows.rview(m).eval());
+  res = m;
+  rows.compile().scatter (2 * small, res);
+  MatrixXd expected (m);
+  rows.lview (expected) = 2 * small;
+  BOOST_CHECK_EQUAL (res, expected);
+
+  // Columns
+  small.resize (m.rows(), cols.nbCols());
+  cols.compile().gather (m, small);
+  BOOST_CHECK_EQUAL (small, cols.rview(m).eval());
+  res = m;
+  cols.compile().scatter (2 * small, res);
+  expected = m;
+  cols.lview (expected) = 2 * small;
+  BOOST_CHECK_EQUAL (res, expected);
+
+  // Rows and columns
+  small.resize (blocks.nbRows(), blocks.nbCols());
+  blocks.compile().gather (m, small);
+  BOOST_CHECK_EQUAL (small, blocks.rview(m).eval());
+  res = m;
+  blocks.compile().scatter (2 * small, res);
+  expected = m;
+  blocks.lview (expected) = 2 * small;
+  BOOST_CHECK_EQUAL (res, expected);
+
+  // Vectors
+  VectorXd v (VectorXd::Random (30)), vs (rows.nbRows());
+  plan.gather (v, vs);
+  BOOST_CHECK_EQUAL (vs, rows.rview(v).eval());
+  VectorXd w (v), expectedW (v);
+  plan.scatter (2 * vs, w);
+  rows.lview (expectedW) = 2 * vs;
+  BOOST_CHECK_EQUAL (w, expectedW);
+}
+
+BOOST_AUTO_TEST_CASE(compiled_matrix_blocks_segments)
+{
+  // Many short segments, as for locked joints interleaved with free
+  // joints, and a few long ones.
+  const MatrixXd::Index N = 400;
+  MatrixBlocks<false, true> rows;
+  for (MatrixXd::Index i = 0; i < N / 2; i += 4) rows.addRow (i, 2);
+  for (MatrixXd::Index i = N / 2; i < N; i += 40) rows.addRow (i, 30);
+
+  const MatrixBlocksPlan<false, true> plan (rows.compile());
+  VectorXd vs (rows.nbRows());
+  for (int k = 0; k < 10; ++k) {
+    VectorXd v (VectorXd::Random (N));
+    plan.gather (v, vs);
+    BOOST_CHECK_EQUAL (vs, rows.rview(v).eval());
+
+    VectorXd w (VectorXd::Random (N)), expected (w);
+    plan.scatter (vs, w);
+    rows.lview (expected) = vs;
+    BOOST_CHECK_EQUAL (w, expected);
+  }
+}
@@ -0,0 +1,148 @@
+// Copyright (c) 2018, Joseph Mirabel
+// Authors: Joseph Mirabel (joseph.mirabel@laas.fr)
+//
+// This file is part of hpp-constraints.
+// hpp-constraints is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-constraints is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-constraints. If not, see <http://www.gnu.org/licenses/>.
+
+#define BOOST_TEST_MODULE SOLVE_BATCH
+#include <boost/test/unit_test.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <hpp/constraints/hybrid-solver.hh>
+
+#include <pinocchio/algorithm/joint-configuration.hpp>
+
+#include <hpp/pinocchio/device.hh>
+#include <hpp/pinocchio/joint.hh>
+#include <hpp/pinocchio/configuration.hh>
+#include <hpp/pinocchio/simple-device.hh>
+
+#include <hpp/constraints/generic-transformation.hh>
+#include <hpp/constraints/work-stealing-pool.hh>
+
+#include <../tests/util.hh>
+
+using namespace hpp::constraints;
+using hpp::pinocchio::Transform3f;
+
+const value_type test_precision = 1e-6;
+
+typedef HierarchicalIterativeSolver::Status Status;
+
+/// Constrain the placement of three joints of the robot.
+void setup (HybridSolver& solver, const DevicePtr_t& device,
+            const char* j1, const char* j2, const char* j3)
+{
+  device->rootJoint()->lowerBound (0, -1);
+  device->rootJoint()->lowerBound (1, -1);
+  device->rootJoint()->lowerBound (2, -1);
+  device->rootJoint()->upperBound (0,  1);
+  device->rootJoint()->upperBound (1,  1);
+  device->rootJoint()->upperBound (2,  1);
+  JointPtr_t ee1 = device->getJointByName (j1),
+             ee2 = device->getJointByName (j2),
+             ee3 = device->getJointByName (j3);
+
+  solver.maxIterations(40);
+  solver.errorThreshold(1e-4);
+  solver.integration(boost::bind(hpp::pinocchio::integrate<true, se3::LieGroupTpl>, device, _1, _2, _3));
+  solver.saturation(boost::bind(saturate, device, _1, _2));
+
+  device->computeForwardKinematics ();
+  Transform3f tf1 (ee1->currentTransformation ());
+  Transform3f tf2 (ee2->currentTransformation ());
+  Transform3f tf3 (ee3->currentTransformation ());
+
+  solver.add(Position::create    (std::string ("Position ") + j1, device, ee1, tf1), 0);
+  solver.add(Orientation::create (std::string ("Orientation ") + j2, device, ee2, tf2), 0);
+  solver.add(Orientation::create (std::string ("Orientation ") + j3, device, ee3, tf3), 0);
+}
+
+matrix_t randomConfigurations (const DevicePtr_t& device, size_type n)
+{
+  matrix_t configs (device->configSize(), n);
+  for (size_type i = 0; i < n; ++i)
+    configs.col(i) = se3::randomConfiguration(device->model());
+  return configs;
+}
+
+BOOST_AUTO_TEST_CASE(consistency)
+{
+  DevicePtr_t device = hpp::pinocchio::unittest::makeDevice (hpp::pinocchio::unittest::HumanoidRomeo);
+  BOOST_REQUIRE (device);
+  HybridSolver solver(device->configSize(), device->numberDof());
+  setup (solver, device, "LAnkleRoll", "RAnkleRoll", "LWristPitch");
+
+  matrix_t configs = randomConfigurations (device, 64),
+           expected = configs;
+  std::vector<Status> status;
+  WorkStealingPool pool (4);
+  solver.solveBatch (configs, status, lineSearch::Backtracking (), pool);
+  BOOST_REQUIRE_EQUAL (status.size(), 64);
+
+  SolverWorkspace workspace (solver);
+  for (size_type i = 0; i < expected.cols(); ++i) {
+    Status s = solver.solve (expected.col(i), workspace,
+                             lineSearch::Backtracking ());
+    BOOST_CHECK_EQUAL (status[i], s);
+    EIGEN_VECTOR_IS_APPROX (configs.col(i), expected.col(i));
+  }
+}
+
+/// Check that the result of solveBatch does not depend on the number of
+/// threads.
+void checkThreads (const DevicePtr_t& device,
+                   const char* j1, const char* j2, const char* j3)
+{
+  HybridSolver solver(device->configSize(), device->numberDof());
+  setup (solver, device, j1, j2, j3);
+
+  const size_type N = 200;
+  const matrix_t configs = randomConfigurations (device, N);
+
+  WorkStealingPool pool1 (1);
+  matrix_t expected (configs);
+  std::vector<Status> expectedStatus;
+  solver.solveBatch (expected, expectedStatus, lineSearch::FixedSequence (),
+                     pool1);
+  BOOST_REQUIRE_EQUAL (expectedStatus.size(), (std::size_t) N);
+  std::size_t success = 0;
+  for (std::size_t i = 0; i < expectedStatus.size(); ++i)
+    if (expectedStatus[i] == HierarchicalIterativeSolver::SUCCESS) ++success;
+  BOOST_CHECK_GT (success, 0);
+
+  const std::size_t maxThreads =
+    std::max (4u, boost::thread::hardware_concurrency ());
+  for (std::size_t n = 2; n <= maxThreads; n *= 2) {
+    WorkStealingPool pool (n);
+    matrix_t q (configs);
+    std::vector<Status> status;
+    solver.solveBatch (q, status, lineSearch::FixedSequence (), pool);
+    BOOST_REQUIRE_EQUAL (status.size(), (std::size_t) N);
+    for (size_type i = 0; i < N; ++i) {
+      BOOST_CHECK_EQUAL (status[i], expectedStatus[i]);
+      EIGEN_VECTOR_IS_APPROX (q.col(i), expected.col(i));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(thread_counts)
+{
+  DevicePtr_t simple = hpp::pinocchio::humanoidSimple ("test");
+  BOOST_REQUIRE (simple);
+  checkThreads (simple, "lleg5_joint", "rleg5_joint", "rleg5_joint");
+
+  DevicePtr_t romeo = hpp::pinocchio::unittest::makeDevice (hpp::pinocchio::unittest::HumanoidRomeo);
+  BOOST_REQUIRE (romeo);
+  checkThreads (romeo, "LAnkleRoll", "RAnkleRoll", "LWristPitch");
+}
@@ -0,0 +1,219 @@
+// Copyright (c) 2018, Joseph Mirabel
+// Authors: Joseph Mirabel (joseph.mirabel@laas.fr)
+//
+// This file is part of hpp-constraints.
+// hpp-constraints is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-constraints is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-constraints. If not, see <http://www.gnu.org/licenses/>.
+
+#define BOOST_TEST_MODULE SOLVER_ALLOCATION
+#include <boost/test/unit_test.hpp>
+
+#include <cstdlib>
+#include <new>
+
+#include <hpp/constraints/hybrid-solver.hh>
+#include <hpp/constraints/affine-function.hh>
+
+#include <../tests/util.hh>
+
+using namespace hpp::constraints;
+
+const value_type test_precision = 1e-6;
+
+// Count the dynamic allocations with an operator new hook. Eigen allocates
+// with std::malloc so, with the GNU C library, malloc is hooked as well.
+namespace {
+  bool countAllocations = false;
+  std::size_t allocations = 0;
+
+  /// Count the allocations during the lifetime of the object.
+  struct AllocationCounter
+  {
+    AllocationCounter ()
+    {
+      allocations = 0;
+      countAllocations = true;
+    }
+
+    ~AllocationCounter ()
+    {
+      stop ();
+    }
+
+    std::size_t stop ()
+    {
+      countAllocations = false;
+      return allocations;
+    }
+  };
+}
+
+#if __cplusplus >= 201103L
+# define HPP_CONSTRAINTS_NEW_THROW_SPEC
+#else
+# define HPP_CONSTRAINTS_NEW_THROW_SPEC throw (std::bad_alloc)
+#endif
+
+void* operator new (std::size_t size) HPP_CONSTRAINTS_NEW_THROW_SPEC
+{
+  if (countAllocations) ++allocations;
+  void* p = std::malloc (size);
+  if (p == NULL) throw std::bad_alloc ();
+  return p;
+}
+
+void operator delete (void* p) throw ()
+{
+  std::free (p);
+}
+
+#ifdef __GLIBC__
+extern "C" {
+  void* __libc_malloc (std::size_t size);
+  void* __libc_calloc (std::size_t n, std::size_t size);
+  void* __libc_realloc (void* p, std::size_t size);
+
+  void* malloc (std::size_t size) __THROW
+  {
+    if (countAllocations) ++allocations;
+    return __libc_malloc (size);
+  }
+
+  void* calloc (std::size_t n, std::size_t size) __THROW
+  {
+    if (countAllocations) ++allocations;
+    return __libc_calloc (n, size);
+  }
+
+  void* realloc (void* p, std::size_t size) __THROW
+  {
+    if (countAllocations) ++allocations;
+    return __libc_realloc (p, size);
+  }
+}
+#endif // __GLIBC__
+
+matrix_t randomPositiveDefiniteMatrix (int N)
+{
+  matrix_t A (matrix_t::Random(N,N));
+  A = (A + A.transpose()) / 2;
+  A += N * matrix_t::Identity (N, N);
+  A /= N;
+  return A;
+}
+
+/// Solve once to warm up, then count the allocations of a second resolution
+/// starting close to the solution.
+template <typename SolverType, typename LineSearchType>
+void checkNoAllocation (const SolverType& solver, SolverWorkspace& ws,
+                        size_type N, const char* name)
+{
+  vector_t x (N);
+  for (int i = 0; i < 10; ++i) {
+    x = 0.5 * vector_t::Random (N);
+    if (solver.solve (x, ws, LineSearchType ())
+        == HierarchicalIterativeSolver::SUCCESS) break;
+  }
+  vector_t y (x + 0.05 * vector_t::Random (N));
+
+  std::size_t n;
+  HierarchicalIterativeSolver::Status status;
+  {
+    AllocationCounter counter;
+    status = solver.solve (y, ws, LineSearchType ());
+    n = counter.stop ();
+  }
+  BOOST_CHECK_EQUAL (status, HierarchicalIterativeSolver::SUCCESS);
+  BOOST_CHECK_MESSAGE (n == 0, name << ": " << n << " allocations");
+}
+
+template <typename SolverType>
+void checkNoAllocation (const SolverType& solver, SolverWorkspace& ws,
+                        size_type N)
+{
+  checkNoAllocation <SolverType, lineSearch::Constant      > (solver, ws, N, "Constant");
+  checkNoAllocation <SolverType, lineSearch::Backtracking  > (solver, ws, N, "Backtracking");
+  checkNoAllocation <SolverType, lineSearch::FixedSequence > (solver, ws, N, "FixedSequence");
+  checkNoAllocation <SolverType, lineSearch::ErrorNormBased> (solver, ws, N, "ErrorNormBased");
+  checkNoAllocation <SolverType, lineSearch::LevenbergMarquardt> (solver, ws, N, "LevenbergMarquardt");
+}
+
+BOOST_AUTO_TEST_CASE(iterative_solver)
+{
+  const int N = 10;
+  matrix_t J (matrix_t::Random (3, N));
+  AffineFunctionPtr_t affine (new AffineFunction (J, 0.1 * vector_t::Random (3)));
+  Quadratic::Ptr_t quad (new Quadratic (randomPositiveDefiniteMatrix (N), -1));
+
+  const Decomposition::Type types[] = {
+    Decomposition::JACOBI_SVD,
+    Decomposition::COL_PIV_HOUSEHOLDER_QR,
+    Decomposition::DAMPED_LLT
+  };
+  for (std::size_t i = 0; i < 3; ++i) {
+    HierarchicalIterativeSolver solver (N, N);
+    solver.maxIterations(40);
+    solver.errorThreshold(test_precision);
+    solver.integration(simpleIntegration<-1,1>);
+    solver.saturation(simpleSaturation<-1,1>);
+    solver.decomposition (types[i]);
+    solver.add (affine, 0);
+    solver.add (quad, 1);
+
+    BOOST_TEST_MESSAGE ("Decomposition " << types[i]);
+    // With and without evaluation context.
+    SolverWorkspace ws (solver), ws2;
+    solver.allocate (ws2);
+    checkNoAllocation (solver, ws, N);
+    checkNoAllocation (solver, ws2, N);
+
+    // With Broyden updates of the Jacobians.
+    solver.maxJacobianReuse (3);
+    checkNoAllocation (solver, ws, N);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(hybrid_solver)
+{
+  const int N = 10;
+  matrix_t J (matrix_t::Random (3, N));
+  AffineFunctionPtr_t affine (new AffineFunction (J, 0.1 * vector_t::Random (3)));
+  Quadratic::Ptr_t quad (new Quadratic (randomPositiveDefiniteMatrix (N), -1));
+  // x[6:8] = B * x[8:10]
+  AffineFunctionPtr_t expl (new AffineFunction (0.5 * matrix_t::Random (2, 2)));
+
+  HybridSolver solver (N, N);
+  solver.maxIterations(40);
+  solver.errorThreshold(test_precision);
+  solver.integration(simpleIntegration<-1,1>);
+  solver.saturation(simpleSaturation<-1,1>);
+  solver.add (affine, 0);
+  solver.add (quad, 1);
+  solver.explicitSolver().add (expl, segment_t (8, 2), segment_t (6, 2),
+                                     segment_t (8, 2), segment_t (6, 2));
+  solver.explicitSolverHasChanged();
+
+  SolverWorkspace ws (solver);
+  checkNoAllocation (solver, ws, N);
+
+  // Iterations of the solver, with a line search.
+  vector_t x (0.5 * vector_t::Random (N));
+  lineSearch::Backtracking ls;
+  solver.oneStep (x, ls, ws);
+  std::size_t n;
+  {
+    AllocationCounter counter;
+    for (int i = 0; i < 5; ++i) solver.oneStep (x, ls, ws);
+    n = counter.stop ();
+  }
+  BOOST_CHECK_EQUAL (n, 0);
+}
@@ -146,14 +146,14 @@ class Quadratic : public hpp::constraints::DifferentiableFunction
 
     Quadratic (const matrix_t& _A, const vector_t& _b, const value_type& _c)
       : hpp::constraints::DifferentiableFunction (_A.cols(), _A.cols(), 1, "Quadratic"),
-      A (_A), b (_b), c(_c)
+      A (_A), b (_b), c(_c), Ax (_A.rows())
     {
       check();
     }
 
     Quadratic (const matrix_t& _A, const value_type& _c = 0)
       : hpp::constraints::DifferentiableFunction (_A.cols(), _A.cols(), 1, "Quadratic"),
-      A (_A), b (vector_t::Zero(_A.rows())), c(_c)
+      A (_A), b (vector_t::Zero(_A.rows())), c(_c), Ax (_A.rows())
     {
       check();
     }
@@ -166,17 +166,20 @@ class Quadratic : public hpp::constraints::DifferentiableFunction
 
     void impl_compute (LiegroupElement& y, vectorIn_t x) const
     {
-      y.vector()[0] = x.transpose() * A * x + b.dot(x) + c;
+      Ax.noalias() = A * x;
+      y.vector()[0] = x.dot(Ax) + b.dot(x) + c;
     }
 
     void impl_jacobian (matrixOut_t J, vectorIn_t x) const
     {
-      J.noalias() = 2 * x.transpose() * A + b.transpose();
+      Ax.noalias() = A.transpose() * x;
+      J = 2 * Ax.transpose() + b.transpose();
     }
 
     matrix_t A;
     vector_t b;
     value_type c;
+    mutable vector_t Ax;
 };
 
 #endif // TEST_UTIL_HH